@@ -0,0 +1,42 @@
+#ifndef ANALYSIS_WORKER_H
+#define ANALYSIS_WORKER_H
+
+#include "stats_engine.h"
+
+// ==================== 后台分析任务 ====================
+// 页面只提交请求并轮询状态，数据库查询与统计在独立线程中完成，结果整体发布
+
+typedef enum {
+    ANALYSIS_JOB_SUMMARY = 0, // 全部历史的 stats_result_t（数据分析页）
+    ANALYSIS_JOB_REPORT,      // 高级分析文本报告
+    ANALYSIS_JOB_FORECAST,    // 未来 24 小时预测（完成后同时发布到 MQTT）
+    ANALYSIS_JOB_COUNT
+} analysis_job_t;
+
+typedef enum {
+    ANALYSIS_IDLE = 0,
+    ANALYSIS_PENDING, // 已排队
+    ANALYSIS_RUNNING,
+    ANALYSIS_DONE,
+    ANALYSIS_FAILED
+} analysis_state_t;
+
+#define ANALYSIS_REPORT_SIZE 2048
+#define ANALYSIS_FORECAST_TOPIC "sensor/forecast"
+
+// 启动工作线程（重复调用无副作用）
+void analysis_worker_init(void);
+
+// 提交任务，返回票据（>0）
+// 同类任务已在排队或执行中时直接合并，返回该任务的票据，不会重复排队
+unsigned analysis_submit(analysis_job_t job);
+
+// 查询票据状态，progress 可为 NULL（0~100）
+analysis_state_t analysis_poll(analysis_job_t job, unsigned ticket, int *progress);
+
+// 读取最近一次发布的结果，返回 0 成功，无结果返回 -1
+int analysis_get_summary(stats_result_t *out);
+int analysis_get_report(char *buffer, int buf_size);
+int analysis_get_forecast(stats_forecast_t *out);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+// ==================== 在线异常检测（单通道） ====================
+// 每个样本同时过两张图，两者都越限才判为异常，单一统计量的误报被互相抵消：
+//   EWMA/EWMV 控制图：指数加权均值与方差，对缓慢漂移之后的突变敏感
+//   滑动 MAD 稳健 z 分数：最近 ANOMALY_WINDOW 个样本的中位数与 MAD，不受离群点拖动
+// 打分只用样本到来之前的状态，因此异常在当前样本即可发现
+// 状态大小固定，每个样本的代价与运行时长无关（窗口内有序插入/删除为 O(ANOMALY_WINDOW)）
+
+#define ANOMALY_WINDOW 64        // 滑动中位数/MAD 窗口（样本数），未填满前只学习不报警
+#define ANOMALY_EWMA_ALPHA 0.05  // EWMA 平滑系数（约 20 个样本的记忆）
+#define ANOMALY_EWMA_Z 4.0       // 控制图阈值
+#define ANOMALY_ROBUST_Z 3.5     // 稳健 z 阈值（Iglewicz-Hoaglin 推荐值）
+#define ANOMALY_CLEAR_RATIO 0.5  // 两个分数都回落到阈值的该比例以下才解除，避免在阈值附近反复翻转
+
+typedef struct
+{
+    double floor; // 分数分母的下限（传感器分辨率），平稳信号 MAD 为 0 时不至于无穷大
+
+    // EWMA / EWMV
+    double mean, var;
+    unsigned long n;
+
+    // 滑动窗口：ring 按到达顺序，sorted 保持升序
+    double ring[ANOMALY_WINDOW];
+    double sorted[ANOMALY_WINDOW];
+    int head, count;
+
+    int active; // 当前是否处于异常
+} anomaly_detector_t;
+
+typedef struct
+{
+    double value;
+    double z_ewma;   // (x - EWMA) / EWMSD
+    double z_robust; // 0.6745 * (x - 中位数) / MAD
+    int active;      // 本样本后的异常状态
+} anomaly_score_t;
+
+// floor 为该通道的最小可分辨变化（如温度 0.1）
+void anomaly_init(anomaly_detector_t *d, double floor);
+
+// 喂入一个样本并打分；异常开始或解除时返回 1，状态未变返回 0
+int anomaly_update(anomaly_detector_t *d, double x, anomaly_score_t *out);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef DB_BACKEND_H
+#define DB_BACKEND_H
+
+#include "db_helper.h"
+
+// ==================== 存储后端 ====================
+// db_helper.h 的接口按此表分派到具体后端，启动时由环境变量 DB_BACKEND 选择：
+//   mysql（默认）  外部 MySQL 服务器
+//   tsdb          本地 mmap 列式文件（db_tsdb），可脱离 mysqld 独立运行
+// 列式读取（series_t）与单行写入由 db_helper 在流式/批量接口之上统一实现
+
+typedef struct
+{
+    const char *name;
+    int (*init)(void); // 可重复调用，失败后下次调用会重试
+    void (*close)(void);
+
+    int (*save_sensor_batch)(const db_row_t *rows, int n);
+    int (*save_weather_batch)(const db_row_t *rows, int n);
+
+    int (*stream_sensor_rows_after)(int after_id, int limit, db_chunk_cb cb, void *user); // limit<=0 不限
+    int (*stream_sensor_range)(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                               db_chunk_cb cb, void *user);
+    int (*stream_weather_range)(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                                db_chunk_cb cb, void *user);
+    int (*sensor_max_id)(void);
+
+    int (*table_list)(db_table_info_t *out, int max_count);
+    int (*preview)(const char *tablename, int cursor_id, int newer, db_preview_row_t *out, int max_rows);
+    int (*export_rows)(const char *tablename, const db_export_sink_t *sink, char *msg, int msg_len);
+} db_backend_t;
+
+// 本地时区相对 UTC 的偏移（秒），汇总桶按本地整点/零点对齐
+static inline long db_local_gmtoff(void)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    return tm.tm_gmtoff;
+}
+
+static inline long db_bucket_start(time_t ts, int res, long gmtoff)
+{
+    return (long)((ts + gmtoff) / res) * res - gmtoff;
+}
+
+extern const db_backend_t db_backend_mysql;
+extern const db_backend_t db_backend_tsdb;
+
+#endif
@@ -1,13 +1,24 @@
 #ifndef DB_HELPER_H
 #define DB_HELPER_H
 #include <time.h>
+#include "db_series.h"
 typedef struct
 {
     char name[32];
     char desc[32];
     int count;
+    int approx; // count 为估算值（MySQL 后台计数完成前）
 } db_table_info_t;
 
+// 读取时间范围数据的分辨率：原始行，或 1 分钟 / 1 小时 / 1 天汇总桶（桶按本地时间对齐）
+typedef enum
+{
+    DB_RES_RAW = 0,
+    DB_RES_MINUTE = 60,
+    DB_RES_HOUR = 3600,
+    DB_RES_DAY = 86400
+} db_resolution_t;
+
 typedef struct
 {
     int id;
@@ -16,23 +27,78 @@ typedef struct
     char ts[16]; // MM-DD HH:MM
 } db_preview_row_t;
 
+/* 待写入的一行（天气行额外带地点与描述） */
+typedef struct
+{
+    time_t ts;
+    float temp;
+    float humi;
+    char location[64];
+    char desc[32];
+} db_row_t;
+
 int db_init(void);
 void db_save_dht11(float temp, float humi);
+/* 批量写入（一个事务），按 ts 先后排列；返回 0 成功，失败时整批回滚可原样重试 */
+int db_save_sensor_batch(const db_row_t *rows, int n);
+int db_save_weather_batch(const db_row_t *rows, int n);
 int db_get_table_list(db_table_info_t *out, int max_count);
-int db_get_preview(const char *tablename, int offset, db_preview_row_t *out, int max_rows);
-int db_export_xlsx(const char *tablename, const char *filepath, char *msg, int msg_len);
-/* 获取传感器数据，返回天数（相对时间） */
-int db_get_sensor_analysis_data(double **temp, double **humi, double **days, int *count);
+/* 预览分页（键集游标）：newer=0 取 id < cursor_id 的 max_rows 行（cursor_id<=0 从最新一行开始），
+   newer=1 取紧邻 cursor_id 之上（更新）的 max_rows 行；结果均按 id 倒序，代价与翻到第几页无关 */
+int db_get_preview(const char *tablename, int cursor_id, int newer, db_preview_row_t *out, int max_rows);
+/* ---- 整表导出：按表结构顺序逐行回调，不在内存中缓存整表（写文件见 export_job） ---- */
+typedef struct
+{
+    const char *str; // 单元格文本，NULL 表示 SQL NULL
+    double num;      // is_num 时有效
+    int is_num;      // 数值列且非 NULL
+} db_cell_t;
+
+typedef struct
+{
+    int (*columns)(void *user, const char *const *names, int count); // 首行之前调用一次
+    int (*row)(void *user, const db_cell_t *cells, int count);       // 返回非 0 中止导出
+    void *user;
+} db_export_sink_t;
+
+// 返回导出行数；失败返回 -1（msg 为原因），被 sink 中止返回 -2
+int db_export_rows(const char *tablename, const db_export_sink_t *sink, char *msg, int msg_len);
+/* 当前 sensor_data 最大 id（空表返回0，失败返回-1） */
+int db_get_sensor_max_id(void);
 // 在 db_helper.h 中添加
 void db_save_weather(float temp, float humi, const char *location, const char *weather_desc);
 int db_create_weather_table(void); // 可选，用于建表，但建议在 db_init 中处理
-// 获取指定时间范围内的传感器数据（返回动态数组，需释放）
-int db_get_sensor_data_range(time_t start_ts, time_t end_ts,
-                             double **temp_out, double **humi_out, int *count);
+/* ---- 列式读取：整段结果装入一个 series_t（见 db_series.h），用完 series_release；失败返回 NULL ---- */
+// id > after_id 的传感器数据，按 id 升序，最多 limit 行（limit<=0 不限），带 id 列
+series_t *db_load_sensor_rows_after(int after_id, int limit);
+// 指定时间范围内的数据；resolution 非 DB_RES_RAW 时读取汇总表，每个桶一行均值
+series_t *db_load_sensor_range(time_t start_ts, time_t end_ts, db_resolution_t resolution);
+// 天气数据带字典编码的描述列（汇总桶的描述取桶内最后一条）
+series_t *db_load_weather_range(time_t start_ts, time_t end_ts, db_resolution_t resolution);
+
+/* ---- 流式读取：结果集不在客户端整体缓存，按块回调，内存占用与总行数无关 ---- */
+#define DB_STREAM_CHUNK 1024
+
+typedef struct
+{
+    int count;
+    const int *id;           // 仅 sensor_data 行读取，其余为 NULL
+    const double *ts;        // UNIX 时间戳（秒）；汇总读取为桶起点
+    const double *temp;
+    const double *humi;
+    const char *const *desc; // 仅天气读取（NULL 元素表示无描述），其余为 NULL
+} db_chunk_t;
+
+// 块内数组仅在回调期间有效；返回非 0 提前结束
+// 读取期间独占一条池连接，回调内再调用 db_* 接口会另借连接
+typedef int (*db_chunk_cb)(const db_chunk_t *chunk, void *user);
 
-// 获取指定时间范围内的天气数据
-int db_get_weather_data_range(time_t start_ts, time_t end_ts,
-                              double **temp_out, double **humi_out, char ***desc_out, int *count);
+// 均返回交付的总行数，失败返回 -1
+int db_stream_sensor_rows_after(int after_id, db_chunk_cb cb, void *user); // id 升序
+int db_stream_sensor_range(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                           db_chunk_cb cb, void *user);
+int db_stream_weather_range(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                            db_chunk_cb cb, void *user);
 void db_close(void);
 
 #endif
\ No newline at end of file
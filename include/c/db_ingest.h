@@ -0,0 +1,24 @@
+#ifndef DB_INGEST_H
+#define DB_INGEST_H
+
+// ==================== 写入队列（write-behind） ====================
+// 采集/天气线程只把行放进内存队列立即返回，由独立写线程攒批后一次事务写入
+// 满 INGEST_BATCH_MAX 行或最早一行等待超过 INGEST_FLUSH_MS 即触发写入
+// 写入失败的批落盘到 db_spool，数据库恢复后按时间顺序补写
+
+#define INGEST_CAPACITY 1024  // 每类队列容量，满时（落盘也不可用）丢弃最旧的行
+#define INGEST_BATCH_MAX 64
+#define INGEST_FLUSH_MS 2000
+#define INGEST_RETRY_MS 5000  // 写入/补写失败后的重试间隔
+
+// 启动写线程（重复调用无副作用）
+void db_ingest_init(void);
+
+// 入队，时间戳取入队时刻；返回 0 成功，队列已满时挤掉最旧一行并返回 1
+int db_ingest_sensor(float temp, float humi);
+int db_ingest_weather(float temp, float humi, const char *location, const char *desc);
+
+// 立即写出队列中全部行，最多等待 timeout_ms；返回 0 已清空，超时返回 -1
+int db_ingest_flush(int timeout_ms);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef DB_POOL_H
+#define DB_POOL_H
+
+#include <time.h>
+#include <mysql/mysql.h>
+
+// ==================== MySQL 连接池 ====================
+// 每个线程在一次数据库操作期间独占一条连接（含其预处理语句），用完归还
+// 连接在空闲超过 DB_POOL_PING_IDLE 秒后再次借出时先 mysql_ping 检查，失效则重连
+
+#define DB_POOL_SIZE 8         // 采集写入、天气、邮件、分析、导出、导出预览读取、表目录刷新、UI 各一条
+#define DB_POOL_WAIT_MS 3000   // 借出等待上限，超时返回 NULL
+#define DB_POOL_PING_IDLE 30   // 秒
+#define DB_POOL_STMT_SLOTS 16  // 每条连接的预处理语句槽位（由 db_helper 按编号使用）
+
+typedef struct
+{
+    MYSQL *mysql;
+    MYSQL_STMT *stmt[DB_POOL_STMT_SLOTS]; // 随连接失效，由连接池统一释放
+    int in_use;
+    time_t last_used;
+} db_conn_t;
+
+// 借出一条已连接的连接；池满等待超时或连接失败返回 NULL
+db_conn_t *db_pool_acquire(void);
+void db_pool_release(db_conn_t *conn);
+
+// 连接出错（如服务器断开）后丢弃语句并重连，返回 0 成功
+int db_pool_reconnect(db_conn_t *conn);
+
+// 断开所有空闲连接（借出中的连接不受影响）
+void db_pool_close_all(void);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef DB_SERIES_H
+#define DB_SERIES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ==================== 列式结果缓冲 ====================
+// 一次读取的结果按列存放（struct-of-arrays），各列都从同一块 arena 中切出并按 SERIES_ALIGN 对齐，
+// 可直接交给统计内核做向量化计算；数据库层填好后原样交给分析/邮件，不再逐级复制
+// 天气描述按字典编码：每个不同的字符串只保存一份，行内只存 16 位下标
+// 引用计数：创建者持有一个引用，共享给其他模块时 series_retain，用完 series_release
+// 释放的 arena 会留一块备用，下一次读取直接复用，避免反复申请大块内存
+
+#define SERIES_ALIGN 64
+#define SERIES_DESC_NONE 0 // 无描述（dict[0] 为 NULL）
+
+enum
+{
+    SERIES_COL_ID = 1 << 0,   // id 列
+    SERIES_COL_DESC = 1 << 1, // 描述列（字典编码）
+};
+
+typedef struct
+{
+    int count;
+    int cap;
+    double *ts;     // UNIX 时间戳（秒）；汇总读取为桶起点
+    double *temp;
+    double *humi;
+    int *id;        // 仅 SERIES_COL_ID
+    uint16_t *desc; // 仅 SERIES_COL_DESC，dict 的下标
+    const char *const *dict;
+    int dict_count; // 含 dict[0]
+
+    // 以下为内部字段
+    int refs;
+    unsigned cols;
+    void *arena;
+    size_t arena_size;
+    char **dict_buf;
+    int dict_cap;
+    int dict_last; // 上一次命中的编码
+} series_t;
+
+// 创建空结果（引用计数为 1），cap 为预计行数；失败返回 NULL
+series_t *series_new(unsigned cols, int cap);
+// 保证至少能容纳 cap 行（扩容时各列整体搬到新的 arena）；返回 0 成功
+int series_reserve(series_t *s, int cap);
+// 取字符串的字典编码，首次出现时加入字典；str 为 NULL 返回 SERIES_DESC_NONE，失败返回 -1
+int series_intern(series_t *s, const char *str);
+
+series_t *series_retain(series_t *s);
+void series_release(series_t *s);
+
+// ---- 时间戳对齐连接（as-of join） ----
+// 两侧均须按 ts 升序；一次归并扫描，O(left->count + right->count)
+typedef enum
+{
+    SERIES_ASOF_PREV = 0, // 取不晚于该时刻的最近一行
+    SERIES_ASOF_NEAREST,  // 取前后最近的一行
+    SERIES_ASOF_LINEAR,   // 前后两行都在容差内时线性插值，否则退化为 NEAREST
+} series_asof_t;
+
+// 对 left 的每一行在 right 中取 tolerance 秒内的对齐值，找不到的行丢弃
+// 成功返回配对数，*left_out 为配上的 left 行，*right_out 为对应的 right 对齐值（两者 ts 均为 left 时间戳）
+// 失败返回 -1
+int series_asof_join(const series_t *left, const series_t *right, double tolerance, series_asof_t mode,
+                     series_t **left_out, series_t **right_out);
+
+static inline const char *series_desc(const series_t *s, int i)
+{
+    return s->desc ? s->dict[s->desc[i]] : NULL;
+}
+
+#endif
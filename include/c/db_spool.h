@@ -0,0 +1,34 @@
+#ifndef DB_SPOOL_H
+#define DB_SPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "db_helper.h"
+
+// ==================== 本地落盘缓冲（spool） ====================
+// 数据库不可用时，写入队列把整批行追加到 mSATA 上的日志文件（每批一次 fsync）
+// 每条记录带长度与 CRC32，断电造成的半条尾记录在读取/追加时被识别并截掉
+// 数据库恢复后按时间戳排序，以大事务分批补写，完成后删除文件
+// 补写中断时已提交的行数先落盘到 .replay.done，去掉已提交行失败（如磁盘满）时下次据此跳过，不会重复写入
+// 同一文件的追加/补写由调用方保证串行（写入队列只在写线程中调用）
+
+#define DB_SPOOL_SENSOR_PATH "/mnt/msata/sensor_data.spool"
+#define DB_SPOOL_WEATHER_PATH "/mnt/msata/weather.spool"
+#define DB_SPOOL_REPLAY_BATCH 512 // 补写时每个事务的行数
+
+// 追加一批行并 fsync；返回 0 成功
+int db_spool_append(const char *path, const db_row_t *rows, int n);
+
+// 按写入顺序读出全部完整记录（rows 需调用方释放）；文件不存在返回 0 行
+int db_spool_load(const char *path, db_row_t **rows, int *count);
+
+// 记录校验所用的 CRC32（IEEE）
+uint32_t db_spool_crc32(const void *data, size_t n);
+
+// 是否有待补写的数据
+int db_spool_pending(const char *path);
+
+// 补写全部落盘数据，save 为 db_save_*_batch；返回补写行数，中途失败返回 -1（未写入的行保留）
+int db_spool_replay(const char *path, int (*save)(const db_row_t *rows, int n));
+
+#endif
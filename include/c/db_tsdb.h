@@ -0,0 +1,21 @@
+#ifndef DB_TSDB_H
+#define DB_TSDB_H
+
+#include "db_helper.h"
+
+// ==================== 本地列式时序存储（DB_BACKEND=tsdb） ====================
+// 每个序列一个只追加文件，整体 mmap：
+//   [文件头 4KB：块数、已封块行数、天气描述/地点字典] [块] [块] ...
+// 每块最多 DB_TSDB_BLOCK_ROWS 行，按列压缩：
+//   ts 为 delta-of-delta 变长编码，温湿度为相邻值 XOR（Gorilla），天气描述/地点为字典下标
+// 块头记录时间范围与首行 id，打开时据此建立内存块索引，范围读取跳过不相交的块
+// 未凑满一块的行先追加到 CRC 分帧的尾部日志（db_spool 格式），满一块再压缩封块
+// 封块时先写块并 msync，再写新尾部日志，最后提交文件头，任一步断电都可恢复
+
+#define DB_TSDB_DIR "/mnt/msata/tsdb"
+#define DB_TSDB_BLOCK_ROWS DB_STREAM_CHUNK // 一块解码后恰好是一个流式块
+#define DB_TSDB_GROW_BYTES (1 << 20)       // 文件按 1MB 扩展，减少重新映射
+#define DB_TSDB_DICT_DESC 64
+#define DB_TSDB_DICT_LOC 16
+
+#endif
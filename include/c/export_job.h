@@ -0,0 +1,52 @@
+#ifndef EXPORT_JOB_H
+#define EXPORT_JOB_H
+
+// ==================== 后台导出任务 ====================
+// 页面只发起导出并轮询状态；挂载 U 盘、逐行读表、写文件、sync 与卸载都在独立线程中完成
+// 行数据由 db_export_rows 流式送入写出器，内存占用与表大小无关
+// 同一时间只运行一个导出任务
+
+typedef enum
+{
+    EXPORT_XLSX = 0,
+    EXPORT_CSV,
+    EXPORT_CSV_GZ,
+    EXPORT_FORMAT_COUNT
+} export_format_t;
+
+typedef enum
+{
+    EXPORT_IDLE = 0,
+    EXPORT_RUNNING,
+    EXPORT_DONE,
+    EXPORT_FAILED,
+    EXPORT_CANCELLED
+} export_state_t;
+
+typedef struct
+{
+    export_state_t state;
+    int rows;       // 已写出行数
+    int total;      // 预估总行数（来自表列表），0 表示未知
+    int to_usb;     // 目标是否为 U 盘
+    char path[256]; // 目标文件
+    char msg[64];   // 失败原因
+    char hint[32];  // 失败时的处理建议，为空时按目标显示写入失败
+} export_status_t;
+
+#define EXPORT_TMP_DIR "/mnt/msata" // xlsx 临时文件目录（避免占用 tmpfs 内存）
+
+// 文件扩展名，如 "xlsx"、"csv.gz"
+const char *export_format_ext(export_format_t fmt);
+
+// 启动导出，total_rows 用于显示进度；total_exact 为 0 表示行数是估算值（不据此拒绝 xlsx）
+// 已有任务在运行时返回 -1
+int export_job_start(const char *tablename, int total_rows, int total_exact, export_format_t fmt);
+
+// 请求取消正在运行的任务（异步生效，未完成的文件会被删除）
+void export_job_cancel(void);
+
+// 读取任务状态副本
+void export_job_get_status(export_status_t *out);
+
+#endif
@@ -27,6 +27,7 @@ void hal_gpio_cleanup(void);
 void hal_beep(int ms);
 void hal_beep_set(int on);
 void hal_led_set(int led_id, int on);  // led_id: 0/1/2
+int hal_led_get(int led_id);           // 最近一次设置的状态（1 亮）
 void hal_led_all_off(void);            // 关闭所有LED
 
 #endif
\ No newline at end of file
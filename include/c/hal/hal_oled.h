@@ -15,7 +15,14 @@ void hal_oled_clear(void);
 void hal_oled_pixel(int x, int y, int on);
 void hal_oled_char(int x, int y, char c);
 void hal_oled_string(int x, int y, const char *str);
+// 双缓冲：绘制函数只写后台缓冲，refresh 发布一帧后立即返回，由显示线程发送到屏幕
+// （显示线程创建失败时退化为在 refresh 中同步发送）
 void hal_oled_refresh(void);
+// 一帧绘制的开始/结束：期间的 refresh 不发布，end_frame 时整帧交换一次（可嵌套）
+void hal_oled_begin_frame(void);
+void hal_oled_end_frame(void);
+// 等待已发布的帧发送完成，返回 0 成功，超时返回 -1
+int hal_oled_flush(int timeout_ms);
 void hal_oled_cleanup(void);
 void hal_oled_line(int x0, int y0, int x1, int y1);  // 添加这行
 void hal_oled_draw_progress_bar(int x, int y, int width, int percent, const char *label);
@@ -47,6 +47,7 @@ void page_terminal_init(void);
 
 menu_item_t* page_terminal_create_menu(void);
 menu_item_t *page_advanced_analysis_create_menu(void);
+menu_item_t *page_forecast_create_menu(void);
 menu_item_t *page_dashboard_create_menu(void);
 menu_item_t *page_system_create_menu(void);
 void page_home_draw(void);
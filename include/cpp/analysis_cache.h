@@ -0,0 +1,80 @@
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include "stats_engine.h"
+#include "periodicity.h"
+#include "forecast.h"
+
+// 增量分析缓存文件（本地 mSATA）
+#define ANALYSIS_CACHE_PATH "/mnt/msata/analysis_cache.bin"
+
+namespace stats
+{
+
+// 单日汇总：累加器、精确直方图（中位数 / 3σ 计数）与逐小时分箱（周期分解）
+struct DayStats
+{
+    SensorAccumulator acc;
+    TempHistogram temp_hist;
+    HumiHistogram humi_hist;
+    HourBins hours;
+
+    void merge(const DayStats &later);
+};
+
+// ==================== 增量分析缓存 ====================
+// 按天保存可合并的汇总，并记录已处理的 sensor_data 最大 id（水位线）
+// 打开分析页时只需读取水位线之后的新行，代价为 O(新增行数)
+class AnalysisCache
+{
+public:
+    static AnalysisCache &instance();
+
+    // 读取水位线之后的新数据并落盘，返回新增行数，失败返回 -1
+    int refresh();
+
+    // [day_from, day_to] 本地日期编号范围内的汇总（趋势横坐标为天数）
+    DayStats range(int32_t day_from, int32_t day_to);
+    // 当前水位线，数据变化的版本号
+    int32_t watermark();
+    // 周期分解：先定稿新近完整的日子，再生成结果
+    void periodic(stats_periodic_t *out);
+    // 预测：已喂入的最后一个本地小时编号（调用方据此读取之后的室外数据）
+    int32_t forecast_fed();
+    // 喂入截至 now 已完整的小时并生成预测；outdoor 为室外小时均值，可为 NULL
+    void forecast(time_t now, const series_t *outdoor, stats_forecast_t *out);
+
+    // 本地日期编号（本地时区下自 1970-01-01 起的天数）
+    static int32_t local_day(double ts);
+    // 本地小时编号（local_day * 24 + 本地小时）
+    static int32_t local_hour(double ts);
+
+private:
+    AnalysisCache() = default;
+
+    void reset();
+    bool load(const char *path);
+    // 只写回变化的日子；首次或重建后整体重写
+    bool save(const char *path);
+    bool save_all(const char *path);
+    // 折叠一块按 id 升序的行（n 不超过 DB_STREAM_CHUNK）
+    void fold(const double *ts, const double *temp, const double *humi, int n);
+
+    std::mutex lock_;
+    bool loaded_ = false;
+    int32_t watermark_ = 0; // 已折叠的最大 sensor_data.id
+    std::map<int32_t, DayStats> days_;
+    std::map<int32_t, uint32_t> slots_; // 各日记录在缓存文件中的序号（定长记录）
+    std::set<int32_t> dirty_;           // 上次落盘后有变化的日子
+    bool rewrite_ = true;               // 文件与内存不一致，下次整体重写
+    Periodicity periodicity_; // 由 days_ 派生，不落盘，启动后首次调用时重建
+    Forecaster forecaster_;   // 同上
+};
+
+} // namespace stats
+
+#endif
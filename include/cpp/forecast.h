@@ -0,0 +1,82 @@
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include <cstdint>
+#include <map>
+#include "stats_engine.h"
+extern "C" {
+#include "db_series.h"
+}
+
+#define FORECAST_WARMUP_HOURS 48 // 学习满两天后才给出预测
+#define FORECAST_SETTLE_S 120    // 小时结束后再等这么久才喂入，写入队列里的尾部行先落库
+
+namespace stats
+{
+
+struct DayStats;
+
+// ==================== 加性 Holt-Winters（单通道） ====================
+// 水平 L、阻尼趋势 b、24 小时季节 s，按小时均值逐点更新，状态固定大小：
+//   预测   ŷ(t+h) = L + (φ + ... + φ^h)·b + s[(t+h) mod 24]
+//   更新   L' = α(y - s[k]) + (1-α)(L + φb)
+//          b' = β(L' - L) + (1-β)φb
+//          s[k] = γ(y - L') + (1-γ)s[k]
+// 第一天按观测直接初始化季节项，避免从 0 开始要学很多天
+class HoltWinters
+{
+public:
+    void update(int hour, double y);
+    void skip(); // 缺失的小时：沿阻尼趋势推进
+    double forecast(int steps, int hour) const; // hour 为目标时刻的本地小时
+    double baseline(int hour) const { return level_ + season_[hour]; }
+    bool ready() const { return n_ >= FORECAST_WARMUP_HOURS; }
+    double rmse() const;
+
+private:
+    double level_ = 0, trend_ = 0;
+    double season_[24] = {0};
+    bool seen_[24] = {false}; // 仅初始化阶段使用
+    uint32_t n_ = 0;          // 已观测小时数
+    uint32_t steps_ = 0;      // 已推进小时数（含缺失）
+    double mse_ = 0;          // 一步误差的指数加权均方
+};
+
+// ==================== 室内外联合预测 ====================
+// 室内温/湿度各一个 Holt-Winters；室外值先减去其自身的日季节基线得到异常 u，
+// 室内一步残差对上一小时的 u 做带遗忘的最小二乘（增益 k），u 本身按 AR(1) 衰减（系数 ρ），
+// h 步外生项为 k·ρ^(h-1)·u(起点)；Holt-Winters 用扣除外生项后的值更新，两者不重复解释同一部分
+// 每喂入一个新小时代价 O(1)；状态由缓存的逐小时分箱派生，不落盘，启动后首次调用时重放重建
+class Forecaster
+{
+public:
+    void reset();
+    int32_t fed() const { return fed_; } // 已喂入的最后一个本地小时编号（日编号 * 24 + 小时）
+
+    // 喂入 (fed(), last_hour] 的小时；outdoor 为按 ts 升序的室外小时均值，可为 NULL
+    void update(const std::map<int32_t, DayStats> &days, int32_t last_hour, const series_t *outdoor);
+    void predict(stats_forecast_t *out) const;
+
+private:
+    struct Exo
+    {
+        HoltWinters outdoor; // 室外基线
+        double sxx = 0, sxy = 0; // 室内残差 ~ 上一小时室外异常
+        double s00 = 0, s01 = 0; // 室外异常 AR(1)
+        double last_u;           // 上一小时的室外异常，无数据为 NAN
+
+        Exo();
+        double gain() const;
+        double rho() const;
+    };
+
+    void step(HoltWinters &model, Exo &exo, int hour, bool has_y, double y, bool has_o, double o);
+
+    HoltWinters temp_, humi_;
+    Exo exo_temp_, exo_humi_;
+    int32_t fed_ = INT32_MIN;
+};
+
+} // namespace stats
+
+#endif
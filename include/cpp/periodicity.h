@@ -0,0 +1,82 @@
+#ifndef PERIODICITY_H
+#define PERIODICITY_H
+
+#include <cstdint>
+#include <map>
+#include "stats_engine.h"
+
+// 日幅度与小时分量至少需要的有数据小时数
+#define PERIODIC_MIN_HOURS 18
+
+namespace stats
+{
+
+struct DayStats;
+
+// ==================== 单日逐小时分箱 ====================
+// 按本地时间的小时累加，随 DayStats 一起落盘，可合并
+struct HourBins
+{
+    double temp_sum[24] = {0};
+    double humi_sum[24] = {0};
+    uint32_t count[24] = {0};
+
+    void add(int hour, double temp, double humi);
+    void merge(const HourBins &o);
+
+    int hours() const; // 有数据的小时数
+    // 有数据小时的小时均值的平均（缺小时不会把日均值拉向某一时段）
+    bool day_mean(double *temp, double *humi) const;
+    // 日幅度：小时均值的极差；覆盖不足 PERIODIC_MIN_HOURS 时返回 false
+    bool amplitude(double *temp, double *humi) const;
+};
+
+// ==================== 周期分解（STL 风格，增量） ====================
+// y(d,h) = 趋势 T(d) + 日周期 S(h) + 周分量 W(星期) + 残差
+//   T(d)  以 d 为中心的 7 天日均值滑动平均，因此某天要等到其后 3 天完整才定稿
+//   S(h)  定稿日去趋势后按小时平均（展示时去掉 24 小时均值）
+//   W     定稿日日均值去趋势后按星期平均
+// 每定稿一天只读取前后 7 天的分箱并更新各累加器，代价为 O(一天)，与历史长度无关
+// 已定稿的日子收到迟到数据时调用 reset()，下次 update 从头重建（只在补写旧数据时发生）
+class Periodicity
+{
+public:
+    static const int TREND_HALF = 3;  // 趋势窗口半宽（天）
+    static const int TREND_KEEP = 14; // 保留的定稿趋势值，用于斜率与加速度
+
+    void reset();
+    int32_t finalized() const { return finalized_; }
+
+    // 定稿 complete_day 之前、趋势窗口已完整的所有日子
+    void update(const std::map<int32_t, DayStats> &days, int32_t complete_day);
+    // 生成结果；today 为当前本地日期编号，用于计算最新一小时的残差分数
+    void summarize(const std::map<int32_t, DayStats> &days, int32_t today, stats_periodic_t *out) const;
+
+    static int weekday(int32_t day) { return (int)(((day + 4) % 7 + 7) % 7); } // 1970-01-01 为周四，0 = 周日
+
+private:
+    void finalize_day(const std::map<int32_t, DayStats> &days, int32_t day);
+    bool trend_at(const std::map<int32_t, DayStats> &days, int32_t day, int32_t last_day,
+                  double *temp, double *humi) const;
+    double diurnal(const double *sum, int h) const;
+
+    int32_t finalized_ = INT32_MIN; // 已定稿到的日期（含）
+    int days_ = 0;
+
+    double s_temp_[24] = {0}, s_humi_[24] = {0};
+    uint32_t s_count_[24] = {0};
+    double w_temp_[7] = {0}, w_humi_[7] = {0};
+    uint32_t w_count_[7] = {0};
+
+    Moments amp_temp_, amp_humi_;
+    Moments resid_temp_, resid_humi_;
+
+    int32_t trend_day_[TREND_KEEP] = {0};
+    double trend_temp_[TREND_KEEP] = {0}, trend_humi_[TREND_KEEP] = {0};
+    int trend_n_ = 0; // 环形缓冲中的有效个数
+    int trend_head_ = 0;
+};
+
+} // namespace stats
+
+#endif
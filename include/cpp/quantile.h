@@ -0,0 +1,67 @@
+#ifndef QUANTILE_H
+#define QUANTILE_H
+
+#include <cstdint>
+
+namespace stats
+{
+
+// ==================== 精确分位数（选择算法） ====================
+// 基于 nth_element，平均 O(n)，会就地重排 data（调用方需自备可改写的缓冲区）
+// 线性插值定义与排序后取 data[q*(n-1)] 一致，q=0.5 即中位数
+double quantile_select(double *data, int n, double q);
+// 一次求多个分位数，qs 须升序；后一个分位数只在前一次划分的右侧继续选择
+void quantiles_select(double *data, int n, const double *qs, int nq, double *out);
+
+// ==================== 秩 ====================
+// 平均秩（1 起），相同值取其所占名次的平均，不修改输入
+void tie_ranks(const double *x, int n, double *ranks);
+// Spearman 秩相关（对秩做 Pearson），正确处理并列值
+double spearman(const double *x, const double *y, int n);
+
+// ==================== P² 流式分位数估计 ====================
+// Jain & Chlamtac 的 P² 算法：5 个标记点，O(1) 内存与更新，无需保存样本
+// 前 5 个样本内返回精确值；可按值拷贝/落盘
+class P2Quantile
+{
+public:
+    explicit P2Quantile(double p = 0.5);
+
+    void add(double x);
+    double value() const;
+    int64_t count() const { return n_; }
+
+private:
+    double parabolic(int i, double d) const;
+    double linear(int i, double d) const;
+
+    double p_;
+    int64_t n_ = 0;
+    double q_[5];    // 标记高度
+    double pos_[5];  // 标记实际位置
+    double want_[5]; // 标记期望位置
+    double dn_[5];   // 期望位置增量
+};
+
+// 报告常用的 p5/p50/p95/p99 一组
+class StreamingQuantiles
+{
+public:
+    static const int COUNT = 4;
+
+    StreamingQuantiles();
+    void add(double x);
+
+    double p5() const { return q_[0].value(); }
+    double p50() const { return q_[1].value(); }
+    double p95() const { return q_[2].value(); }
+    double p99() const { return q_[3].value(); }
+    int64_t count() const { return q_[0].count(); }
+
+private:
+    P2Quantile q_[COUNT];
+};
+
+} // namespace stats
+
+#endif
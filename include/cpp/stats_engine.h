@@ -1,20 +1,266 @@
 #ifndef STATS_ENGINE_H
 #define STATS_ENGINE_H
 
+#include <time.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// 占位：后续添加高级分析函数
+// ==================== C 接口：统一统计结果 ====================
+// 标准差一律为样本标准差（n-1），趋势一律按天（℃/天、%/天）
 typedef struct {
     int count;
-    double temp_mean;
-    double temp_std;
-    // ... 其他字段
+    double temp_mean, temp_std, temp_min, temp_max, temp_median;
+    double humi_mean, humi_std, humi_min, humi_max, humi_median;
+    double temp_p5, temp_p95, humi_p5, humi_p95;
+    double temp_skewness, temp_kurtosis;
+    double humi_skewness, humi_kurtosis;
+    double temp_humi_corr; // 温湿度 Pearson 相关
+
+    double temp_trend_per_day, humi_trend_per_day;
+    double temp_acceleration, humi_acceleration; // 3点滑动平均后的趋势
+
+    double thi_mean, thi_std, thi_min, thi_max;
+    double heat_index_mean;
+    char comfort_grade[16];      // Cold / Cool / Comfort / Warm / Hot / Muggy
+    char comfort_level[24];      // 体感描述
+    char comfort_suggestion[32]; // 简短建议
+
+    int temp_anom_3sigma, humi_anom_3sigma;
+    int hot, cold, high_humi, low_humi; // 温度 >35 / <0，湿度 >80 / <30
 } stats_result_t;
 
+// 单序列摘要（天气等少量数据）
+typedef struct {
+    int count;
+    double mean, std, min, max;
+} stats_summary_t;
+
+// 日/周周期分解（全部历史，按本地时间分箱，见 periodicity.h）
+typedef struct {
+    int days;                                   // 已定稿分解的天数
+    double temp_amp_mean, humi_amp_mean;        // 每日幅度（小时均值的极差）的平均
+    double temp_amp_last, humi_amp_last;        // 最近一个完整日的幅度
+    double diurnal_temp[24], diurnal_humi[24];  // 日周期分量（按小时，24 小时均值为 0）
+    double weekly_temp[7], weekly_humi[7];      // 周分量（0 = 周日）
+    int temp_peak_hour, temp_trough_hour;       // 日周期分量的峰/谷所在小时，无数据为 -1
+    double trend_temp, trend_humi;              // 最近 7 天的趋势水平
+    double trend_temp_slope, trend_humi_slope;  // 趋势斜率（/天，最近 7 个定稿日）
+    double trend_temp_accel, trend_humi_accel;  // 趋势斜率的变化（/天²，相邻两个 7 天）
+    double resid_temp_std, resid_humi_std;      // 残差标准差
+    double score_temp, score_humi;              // 最新一小时的残差分数（残差 / 残差标准差）
+} stats_periodic_t;
+
+// 刷新增量缓存并给出周期分解结果；返回 0 成功，数据库不可用且无缓存时返回 -1
+int stats_periodic(stats_periodic_t *out);
+
+// 未来 1~24 小时预测（日季节 Holt-Winters + 室外天气外生项，见 forecast.h）
+#define STATS_FORECAST_HORIZON 24
+typedef struct {
+    int ready;                                 // 已积累足够的小时数，结果可用
+    long origin_ts;                            // 预测起点：最近一个完整小时的结束时刻
+    int origin_hour;                           // 起点的本地小时（0~23），temp[i] 对应 origin_hour + i + 1
+    double temp[STATS_FORECAST_HORIZON];
+    double humi[STATS_FORECAST_HORIZON];
+    double temp_rmse, humi_rmse;               // 一步预测误差（指数加权均方根），h 步约放大 sqrt(h) 倍
+    double temp_exo, humi_exo;                 // 室外异常对下一小时室内值的回归系数
+    int exo_used;                              // 起点附近有室外数据，外生项已计入
+} stats_forecast_t;
+
+// 刷新增量缓存并推进预测状态（每个新小时 O(1)）；返回 0 成功，失败返回 -1
+int stats_forecast(stats_forecast_t *out);
+
+// 统计 [start_ts, end_ts] 时间窗内的传感器数据，start_ts <= 0 表示全部历史
+// 窗口按本地日期对齐；同一窗口在数据未变化时只计算一次，页面与邮件报告共享结果
+// 返回 0 成功（count 可能为 0），数据库不可用且无缓存时返回 -1
+int stats_window(time_t start_ts, time_t end_ts, stats_result_t *out);
+
+// 按 THI 均值填充 comfort_grade / comfort_level / comfort_suggestion
+void stats_comfort(double thi_mean, stats_result_t *out);
+
+// 当前使用的分块统计内核名称（"avx2" / "sse2" / "neon" / "scalar"），首次调用时完成选择与自检
+const char *stats_kernel_name(void);
+
+void stats_summarize(const double *data, int n, stats_summary_t *out);
+double stats_pearson(const double *x, const double *y, int n);
+
 #ifdef __cplusplus
 }
+
+#include <cstdint>
+#include <cmath>
+#include "stats_kernels.h"
+
+namespace stats
+{
+
+// 温湿指数 THI
+inline double thi(double temp, double humi)
+{
+    return 0.8 * temp + (0.01 * humi) * (0.8 * temp - 14.3) + 46.3;
+}
+
+// 简化版热指数（27℃以下直接取温度）
+inline double heat_index(double temp, double humi)
+{
+    if (temp < 27)
+        return temp;
+    return -42.379 + 2.04901523 * temp + 10.14333127 * humi - 0.22475541 * temp * humi - 0.00683783 * temp * temp - 0.05481717 * humi * humi + 0.00122874 * temp * temp * humi + 0.00085282 * temp * humi * humi - 0.00000199 * temp * temp * humi * humi;
+}
+
+// ==================== 单变量矩累加器 ====================
+// Welford 在线算法，维护到四阶中心矩，单遍得到均值/方差/偏度/峰度/极值
+class Moments
+{
+public:
+    void add(double x);
+    void merge(const Moments &o);
+    // 由平移后的幂和 Σd^k（d = x - shift）构造，供分块 SIMD 内核使用
+    static Moments from_sums(int64_t n, double shift, double s1, double s2, double s3, double s4, double min, double max);
+
+    int64_t count() const { return n_; }
+    double mean() const { return mean_; }
+    double min() const { return n_ ? min_ : 0; }
+    double max() const { return n_ ? max_ : 0; }
+    double variance() const; // 样本方差（n-1）
+    double stddev() const;
+    double skewness() const; // Σz³/n，z 按样本标准差归一化
+    double kurtosis() const; // 超额峰度 Σz⁴/n - 3
+
+private:
+    int64_t n_ = 0;
+    double mean_ = 0, m2_ = 0, m3_ = 0, m4_ = 0;
+    double min_ = 0, max_ = 0;
+};
+
+// ==================== 双变量协矩累加器 ====================
+// 同时给出 Pearson 相关系数和 y 对 x 的最小二乘斜率
+class CoMoments
+{
+public:
+    void add(double x, double y);
+    // x_offset 用于合并以样本序号为横坐标的分段（后段序号整体平移）
+    void merge(const CoMoments &o, double x_offset = 0);
+    // 由平移后的原始和构造（cx/cy 为平移量）
+    static CoMoments from_sums(int64_t n, double cx, double cy, double sx, double sy, double sxx, double syy, double sxy);
+
+    int64_t count() const { return n_; }
+    double pearson() const;
+    double slope() const;
+
+private:
+    int64_t n_ = 0;
+    double mean_x_ = 0, mean_y_ = 0;
+    double m2_x_ = 0, m2_y_ = 0, c_xy_ = 0;
+};
+
+// ==================== 固定分辨率直方图 ====================
+// 0.1 步长，覆盖 [LO, HI]，越界值截断到两端；可合并
+// DHT11 数据按 %.1f 入库，分桶即原值，因此中位数与 3σ 计数是精确的
+template <int LO, int HI>
+class Histogram
+{
+public:
+    static const int BINS = (HI - LO) * 10 + 1;
+
+    void add(double x)
+    {
+        long b = lround((x - LO) * 10);
+        counts_[b < 0 ? 0 : (b >= BINS ? BINS - 1 : b)]++;
+        n_++;
+    }
+
+    void merge(const Histogram &o)
+    {
+        for (int b = 0; b < BINS; b++)
+            counts_[b] += o.counts_[b];
+        n_ += o.n_;
+    }
+
+    int64_t count() const { return n_; }
+
+    // 线性插值分位数，q=0.5 时与排序求中位数一致
+    double quantile(double q) const
+    {
+        if (n_ == 0)
+            return 0;
+        double pos = q * (n_ - 1);
+        int64_t k = (int64_t)pos;
+        double lo = kth(k);
+        double hi = (k + 1 < n_) ? kth(k + 1) : lo;
+        return lo + (hi - lo) * (pos - k);
+    }
+
+    // 落在 [lo, hi] 之外的样本数
+    int64_t count_outside(double lo, double hi) const
+    {
+        int64_t c = 0;
+        for (int b = 0; b < BINS; b++)
+        {
+            double v = value(b);
+            if (v < lo || v > hi)
+                c += counts_[b];
+        }
+        return c;
+    }
+
+private:
+    double value(int b) const { return LO + b / 10.0; }
+
+    // 第 k 小的值（0 起）
+    double kth(int64_t k) const
+    {
+        int64_t seen = 0;
+        for (int b = 0; b < BINS; b++)
+        {
+            seen += counts_[b];
+            if (seen > k)
+                return value(b);
+        }
+        return value(BINS - 1);
+    }
+
+    int64_t n_ = 0;
+    uint32_t counts_[BINS] = {0};
+};
+
+typedef Histogram<-40, 80> TempHistogram;
+typedef Histogram<0, 100> HumiHistogram;
+
+// ==================== 传感器融合累加器 ====================
+// 一次遍历温湿度序列，得到矩、极值、趋势、加速度、舒适度与极端事件计数
+class SensorAccumulator
+{
+public:
+    // x 为趋势回归的横坐标（样本序号或天数）
+    void add(double temp, double humi, double x);
+    // 批量追加一段连续样本，按 STATS_BLOCK_SIZE 分块走 SIMD 内核，结果与逐个 add 一致
+    void add_block(const double *temp, const double *humi, const double *x, int n);
+    // 追加时间上紧随其后的一段；趋势横坐标须为同一基准（如天数）
+    void merge(const SensorAccumulator &later);
+
+    Moments temp, humi;
+    Moments thi, heat_index;
+    CoMoments temp_humi;              // 温湿度相关性
+    CoMoments temp_trend, humi_trend; // 趋势（斜率）
+    CoMoments temp_accel, humi_accel; // 3点滑动平均后的趋势（加速度）
+
+    int hot = 0, cold = 0;           // 温度 >35 / <0
+    int high_humi = 0, low_humi = 0; // 湿度 >80 / <30
+
+private:
+    static SensorAccumulator from_block(const block_sums_t &s, const double *temp, const double *humi);
+
+    // 首尾各两个样本，用于合并时补齐跨段的滑动平均点
+    double first_temp_[2] = {0, 0};
+    double first_humi_[2] = {0, 0};
+    double prev_temp_[2] = {0, 0};
+    double prev_humi_[2] = {0, 0};
+};
+
+} // namespace stats
+
 #endif
 
-#endif
\ No newline at end of file
+#endif
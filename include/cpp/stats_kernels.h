@@ -0,0 +1,42 @@
+#ifndef STATS_KERNELS_H
+#define STATS_KERNELS_H
+
+namespace stats
+{
+
+// 每块样本数：三条输入数组共 12KB，保证块内多趟计算都命中 L1
+#define STATS_BLOCK_SIZE 512
+
+// 单通道幂和（以块首值为平移量，减小抵消误差）
+typedef struct
+{
+    double s1, s2, s3, s4;
+    double min, max;
+} power_sums_t;
+
+// 一个数据块的全部原始和，温度与湿度两条通道同时计算
+typedef struct
+{
+    int n;
+    double shift_t, shift_h, shift_thi, shift_hi, shift_x;
+    power_sums_t t, h, thi, hi;
+    double s_th;                         // Σ dt·dh
+    double s_x, s_xx, s_xt, s_xh;        // 趋势回归（x 同样平移）
+    double a_t, a_tt, a_kt;              // 3点滑动平均序列：Σu, Σu², Σk·u（k 为块内序号）
+    double a_h, a_hh, a_kh;
+    int hot, cold, high_humi, low_humi;
+} block_sums_t;
+
+typedef void (*block_kernel_t)(const double *t, const double *h, const double *x, int n, block_sums_t *out);
+
+// 标量参考实现
+void block_sums_scalar(const double *t, const double *h, const double *x, int n, block_sums_t *out);
+
+// 运行时按 CPU 能力选择（NEON / AVX2 / SSE2 / 标量），首次使用时与标量实现对比自检，不一致则退回标量
+// 环境变量 STATS_SIMD=off 强制使用标量参考实现
+block_kernel_t block_kernel(void);
+const char *block_kernel_name(void);
+
+} // namespace stats
+
+#endif
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "analysis_worker.h"
+#include "advanced_analysis.h"
+#include "mqtt_client.h"
+
+// 每类任务一个槽位：票据单调递增，completed 之前的票据均已完成
+typedef struct
+{
+    unsigned target;    // 最新排队/执行中任务的票据
+    unsigned completed; // 最近完成任务的票据
+    analysis_state_t state;
+    int progress;
+    int ok; // 最近完成任务是否成功
+} job_slot_t;
+
+static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_cond = PTHREAD_COND_INITIALIZER;
+static job_slot_t jobs[ANALYSIS_JOB_COUNT];
+
+// 已发布结果（worker_lock 保护，读取方拿副本）
+static stats_result_t summary_result;
+static int summary_valid = 0;
+static char report_result[ANALYSIS_REPORT_SIZE];
+static int report_valid = 0;
+static stats_forecast_t forecast_result;
+static int forecast_valid = 0;
+
+static void set_progress(analysis_job_t job, int progress)
+{
+    pthread_mutex_lock(&worker_lock);
+    jobs[job].progress = progress;
+    pthread_mutex_unlock(&worker_lock);
+}
+
+static void publish(analysis_job_t job, unsigned ticket, int ok)
+{
+    job_slot_t *slot = &jobs[job];
+    slot->completed = ticket;
+    slot->ok = ok;
+    slot->progress = 100;
+    slot->state = ok ? ANALYSIS_DONE : ANALYSIS_FAILED;
+}
+
+static void run_summary(unsigned ticket)
+{
+    stats_result_t res;
+    int ok = stats_window(0, time(NULL), &res) == 0 && res.count > 0;
+
+    pthread_mutex_lock(&worker_lock);
+    if (ok)
+    {
+        summary_result = res;
+        summary_valid = 1;
+    }
+    publish(ANALYSIS_JOB_SUMMARY, ticket, ok);
+    pthread_mutex_unlock(&worker_lock);
+}
+
+static void run_report(unsigned ticket)
+{
+    static char buffer[ANALYSIS_REPORT_SIZE];
+
+    // 先折叠增量缓存（耗时主要在这里），报告生成时直接命中窗口结果
+    stats_result_t res;
+    stats_window(0, time(NULL), &res);
+    set_progress(ANALYSIS_JOB_REPORT, 60);
+
+    memset(buffer, 0, sizeof(buffer));
+    int ok = perform_advanced_analysis(buffer, sizeof(buffer)) == 0;
+
+    pthread_mutex_lock(&worker_lock);
+    if (ok)
+    {
+        memcpy(report_result, buffer, sizeof(report_result));
+        report_valid = 1;
+    }
+    publish(ANALYSIS_JOB_REPORT, ticket, ok);
+    pthread_mutex_unlock(&worker_lock);
+}
+
+// 预测发布格式：Origin:<起点时间戳>,T:<24 个温度>,H:<24 个湿度>，数值以空格分隔
+static void publish_forecast(const stats_forecast_t *f)
+{
+    char msg[512];
+    int off = snprintf(msg, sizeof(msg), "Origin:%ld,T:", f->origin_ts);
+    for (int i = 0; i < STATS_FORECAST_HORIZON; i++)
+        off += snprintf(msg + off, sizeof(msg) - off, i ? " %.1f" : "%.1f", f->temp[i]);
+    off += snprintf(msg + off, sizeof(msg) - off, ",H:");
+    for (int i = 0; i < STATS_FORECAST_HORIZON; i++)
+        off += snprintf(msg + off, sizeof(msg) - off, i ? " %.1f" : "%.1f", f->humi[i]);
+    mqtt_publish(ANALYSIS_FORECAST_TOPIC, msg);
+}
+
+static void run_forecast(unsigned ticket)
+{
+    stats_forecast_t f;
+    int ok = stats_forecast(&f) == 0 && f.ready;
+    if (ok)
+        publish_forecast(&f);
+
+    pthread_mutex_lock(&worker_lock);
+    if (ok)
+    {
+        forecast_result = f;
+        forecast_valid = 1;
+    }
+    publish(ANALYSIS_JOB_FORECAST, ticket, ok);
+    pthread_mutex_unlock(&worker_lock);
+}
+
+static void *analysis_worker_thread(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&worker_lock);
+        int job = -1;
+        while (job < 0)
+        {
+            for (int i = 0; i < ANALYSIS_JOB_COUNT; i++)
+            {
+                if (jobs[i].state == ANALYSIS_PENDING)
+                {
+                    job = i;
+                    break;
+                }
+            }
+            if (job < 0)
+                pthread_cond_wait(&worker_cond, &worker_lock);
+        }
+        unsigned ticket = jobs[job].target;
+        jobs[job].state = ANALYSIS_RUNNING;
+        jobs[job].progress = 10;
+        pthread_mutex_unlock(&worker_lock);
+
+        if (job == ANALYSIS_JOB_SUMMARY)
+            run_summary(ticket);
+        else if (job == ANALYSIS_JOB_REPORT)
+            run_report(ticket);
+        else
+            run_forecast(ticket);
+    }
+    return NULL;
+}
+
+void analysis_worker_init(void)
+{
+    static int initialized = 0;
+    if (initialized)
+        return;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, analysis_worker_thread, NULL) != 0)
+    {
+        fprintf(stderr, "[ANALYSIS] Failed to create worker thread\n");
+        return;
+    }
+    pthread_detach(thread);
+    initialized = 1;
+    printf("[ANALYSIS] Stats kernel: %s\n", stats_kernel_name());
+}
+
+unsigned analysis_submit(analysis_job_t job)
+{
+    if ((unsigned)job >= ANALYSIS_JOB_COUNT)
+        return 0;
+
+    pthread_mutex_lock(&worker_lock);
+    job_slot_t *slot = &jobs[job];
+    unsigned ticket;
+    if (slot->state == ANALYSIS_PENDING || slot->state == ANALYSIS_RUNNING)
+    {
+        // 合并到进行中的同类任务
+        ticket = slot->target;
+    }
+    else
+    {
+        ticket = ++slot->target;
+        slot->state = ANALYSIS_PENDING;
+        slot->progress = 0;
+        pthread_cond_signal(&worker_cond);
+    }
+    pthread_mutex_unlock(&worker_lock);
+    return ticket;
+}
+
+analysis_state_t analysis_poll(analysis_job_t job, unsigned ticket, int *progress)
+{
+    if ((unsigned)job >= ANALYSIS_JOB_COUNT || ticket == 0)
+        return ANALYSIS_IDLE;
+
+    analysis_state_t state;
+    int pct;
+    pthread_mutex_lock(&worker_lock);
+    job_slot_t *slot = &jobs[job];
+    if (ticket <= slot->completed)
+    {
+        state = slot->ok ? ANALYSIS_DONE : ANALYSIS_FAILED;
+        pct = 100;
+    }
+    else
+    {
+        state = slot->state;
+        pct = slot->progress;
+    }
+    pthread_mutex_unlock(&worker_lock);
+
+    if (progress)
+        *progress = pct;
+    return state;
+}
+
+int analysis_get_summary(stats_result_t *out)
+{
+    pthread_mutex_lock(&worker_lock);
+    int ok = summary_valid;
+    if (ok)
+        *out = summary_result;
+    pthread_mutex_unlock(&worker_lock);
+    return ok ? 0 : -1;
+}
+
+int analysis_get_report(char *buffer, int buf_size)
+{
+    if (!buffer || buf_size <= 0)
+        return -1;
+    pthread_mutex_lock(&worker_lock);
+    int ok = report_valid;
+    if (ok)
+        snprintf(buffer, buf_size, "%s", report_result);
+    pthread_mutex_unlock(&worker_lock);
+    return ok ? 0 : -1;
+}
+
+int analysis_get_forecast(stats_forecast_t *out)
+{
+    pthread_mutex_lock(&worker_lock);
+    int ok = forecast_valid;
+    if (ok)
+        *out = forecast_result;
+    pthread_mutex_unlock(&worker_lock);
+    return ok ? 0 : -1;
+}
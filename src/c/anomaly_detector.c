@@ -0,0 +1,132 @@
+#include <math.h>
+#include <string.h>
+#include "anomaly_detector.h"
+
+// 正态分布下 MAD = 0.6745σ
+#define MAD_TO_SIGMA 0.6745
+
+void anomaly_init(anomaly_detector_t *d, double floor)
+{
+    memset(d, 0, sizeof(*d));
+    d->floor = floor;
+}
+
+// 有序数组中第一个 >= x 的位置
+static int lower_bound(const double *a, int n, double x)
+{
+    int lo = 0, hi = n;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (a[mid] < x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void window_push(anomaly_detector_t *d, double x)
+{
+    if (d->count == ANOMALY_WINDOW)
+    {
+        // 移出最旧样本
+        double old = d->ring[d->head];
+        int i = lower_bound(d->sorted, d->count, old);
+        memmove(d->sorted + i, d->sorted + i + 1, (d->count - i - 1) * sizeof(double));
+        d->count--;
+        d->ring[d->head] = x;
+        d->head = (d->head + 1) % ANOMALY_WINDOW;
+    }
+    else
+    {
+        d->ring[(d->head + d->count) % ANOMALY_WINDOW] = x;
+    }
+
+    int i = lower_bound(d->sorted, d->count, x);
+    memmove(d->sorted + i + 1, d->sorted + i, (d->count - i) * sizeof(double));
+    d->sorted[i] = x;
+    d->count++;
+}
+
+// 窗口中位数与 MAD
+// 到中位数的距离在中位数左右两侧各自有序，双指针归并出第 n/2 个（从 0 起）距离；
+// n 为偶数时与中位数一致，取第 n/2 - 1 与第 n/2 个的平均
+static void window_median_mad(const anomaly_detector_t *d, double *median, double *mad)
+{
+    const double *s = d->sorted;
+    int n = d->count;
+    double med = (n % 2) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2;
+
+    int left = lower_bound(s, n, med) - 1; // 向左距离递增
+    int right = left + 1;                  // 向右距离递增
+    double dev = 0, prev = 0;
+    for (int k = 0; k <= n / 2; k++)
+    {
+        prev = dev;
+        double dl = left >= 0 ? med - s[left] : INFINITY;
+        double dr = right < n ? s[right] - med : INFINITY;
+        if (dl <= dr)
+        {
+            dev = dl;
+            left--;
+        }
+        else
+        {
+            dev = dr;
+            right++;
+        }
+    }
+    *median = med;
+    *mad = (n % 2) ? dev : (prev + dev) / 2;
+}
+
+int anomaly_update(anomaly_detector_t *d, double x, anomaly_score_t *out)
+{
+    anomaly_score_t s = {x, 0, 0, d->active};
+
+    // 1. 用样本到来之前的状态打分
+    if (d->count == ANOMALY_WINDOW)
+    {
+        double sd = sqrt(d->var);
+        s.z_ewma = (x - d->mean) / (sd > d->floor ? sd : d->floor);
+
+        double median, mad;
+        window_median_mad(d, &median, &mad);
+        s.z_robust = MAD_TO_SIGMA * (x - median) / (mad > d->floor ? mad : d->floor);
+
+        double ze = fabs(s.z_ewma), zr = fabs(s.z_robust);
+        if (!d->active)
+            s.active = ze > ANOMALY_EWMA_Z && zr > ANOMALY_ROBUST_Z;
+        else
+            s.active = !(ze < ANOMALY_EWMA_Z * ANOMALY_CLEAR_RATIO && zr < ANOMALY_ROBUST_Z * ANOMALY_CLEAR_RATIO);
+    }
+
+    // 2. 更新 EWMA/EWMV；更新量截断在 ±ANOMALY_EWMA_Z 倍标准差内，单个尖峰不会撑大方差
+    if (d->n == 0)
+    {
+        d->mean = x;
+    }
+    else
+    {
+        double sd = sqrt(d->var);
+        double limit = ANOMALY_EWMA_Z * (sd > d->floor ? sd : d->floor);
+        double diff = x - d->mean;
+        if (diff > limit)
+            diff = limit;
+        else if (diff < -limit)
+            diff = -limit;
+        d->mean += ANOMALY_EWMA_ALPHA * diff;
+        d->var = (1 - ANOMALY_EWMA_ALPHA) * (d->var + ANOMALY_EWMA_ALPHA * diff * diff);
+    }
+    d->n++;
+
+    // 3. 滑动窗口照常收录（中位数/MAD 本身对离群点稳健）
+    window_push(d, x);
+
+    int changed = s.active != d->active;
+    d->active = s.active;
+    if (out)
+        *out = s;
+    return changed;
+}
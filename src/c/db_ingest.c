@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "db_ingest.h"
+#include "db_helper.h"
+#include "db_spool.h"
+
+typedef struct
+{
+    const char *name;
+    int (*save)(const db_row_t *rows, int n);
+    const char *spool_path;
+    db_row_t items[INGEST_CAPACITY]; // 环形队列
+    int head, count;
+    long long first_ms;              // 队首入队时刻
+    unsigned dropped;
+    db_row_t batch[INGEST_BATCH_MAX]; // 写入中/待重试的批（内容仅写线程访问）
+    int batch_n;
+    long long retry_ms;
+    int spooled; // 有落盘待补写的数据，期间新批直接追加到 spool 保持先后
+} ingest_queue_t;
+
+static pthread_mutex_t ingest_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ingest_cond;  // 有新行或请求刷新
+static pthread_cond_t drained_cond; // 队列写空
+static int flush_requested = 0;
+
+static ingest_queue_t queues[] = {
+    {.name = "sensor", .save = db_save_sensor_batch, .spool_path = DB_SPOOL_SENSOR_PATH},
+    {.name = "weather", .save = db_save_weather_batch, .spool_path = DB_SPOOL_WEATHER_PATH},
+};
+#define QUEUE_COUNT ((int)(sizeof(queues) / sizeof(queues[0])))
+
+static long long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int queue_push(ingest_queue_t *q, const db_row_t *row)
+{
+    pthread_mutex_lock(&ingest_lock);
+    int overflow = 0;
+    if (q->count == INGEST_CAPACITY)
+    {
+        // 数据库长时间不可用：保留最新数据
+        q->head = (q->head + 1) % INGEST_CAPACITY;
+        q->count--;
+        if (q->dropped++ % 100 == 0)
+            fprintf(stderr, "[INGEST] %s queue full, dropped %u rows\n", q->name, q->dropped);
+        overflow = 1;
+    }
+    if (q->count == 0)
+        q->first_ms = now_ms();
+    q->items[(q->head + q->count) % INGEST_CAPACITY] = *row;
+    q->count++;
+    // 首行入队启动定时，凑满一批立即写
+    if (q->count == 1 || q->count >= INGEST_BATCH_MAX)
+        pthread_cond_signal(&ingest_cond);
+    pthread_mutex_unlock(&ingest_lock);
+    return overflow;
+}
+
+// 需持有 ingest_lock；返回该队列下次需要处理的时刻（无事可做返回 -1）
+static long long queue_due(const ingest_queue_t *q)
+{
+    if (q->batch_n > 0)
+        return q->retry_ms;
+    long long due = -1;
+    if (q->count > 0)
+        due = (q->count >= INGEST_BATCH_MAX || flush_requested) ? 0 : q->first_ms + INGEST_FLUSH_MS;
+    if (q->spooled && (due < 0 || q->retry_ms < due))
+        due = q->retry_ms;
+    return due;
+}
+
+static int queues_empty(void)
+{
+    for (int i = 0; i < QUEUE_COUNT; i++)
+    {
+        if (queues[i].count > 0 || queues[i].batch_n > 0)
+            return 0;
+    }
+    return 1;
+}
+
+static void *ingest_writer_thread(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&ingest_lock);
+        long long now;
+        while (1)
+        {
+            now = now_ms();
+            long long next = -1;
+            for (int i = 0; i < QUEUE_COUNT; i++)
+            {
+                long long due = queue_due(&queues[i]);
+                if (due >= 0 && (next < 0 || due < next))
+                    next = due;
+            }
+            if (next >= 0 && next <= now)
+                break;
+
+            if (next < 0)
+            {
+                pthread_cond_wait(&ingest_cond, &ingest_lock);
+            }
+            else
+            {
+                struct timespec deadline;
+                clock_gettime(CLOCK_MONOTONIC, &deadline);
+                long long wait = next - now;
+                deadline.tv_sec += wait / 1000;
+                deadline.tv_nsec += (wait % 1000) * 1000000L;
+                if (deadline.tv_nsec >= 1000000000L)
+                {
+                    deadline.tv_sec++;
+                    deadline.tv_nsec -= 1000000000L;
+                }
+                pthread_cond_timedwait(&ingest_cond, &ingest_lock, &deadline);
+            }
+        }
+
+        // 取出到期队列的一批（失败的批保留原样重试）
+        for (int i = 0; i < QUEUE_COUNT; i++)
+        {
+            ingest_queue_t *q = &queues[i];
+            long long due = queue_due(q);
+            if (q->batch_n > 0 || due < 0 || due > now)
+                continue;
+            while (q->batch_n < INGEST_BATCH_MAX && q->count > 0)
+            {
+                q->batch[q->batch_n++] = q->items[q->head];
+                q->head = (q->head + 1) % INGEST_CAPACITY;
+                q->count--;
+            }
+            q->first_ms = now;
+        }
+        pthread_mutex_unlock(&ingest_lock);
+
+        // 写库在锁外进行，生产者不受影响
+        // 数据库不可用时整批落盘，恢复后先补写落盘数据再写新批
+        int done[QUEUE_COUNT], failed[QUEUE_COUNT], spooled[QUEUE_COUNT];
+        for (int i = 0; i < QUEUE_COUNT; i++)
+        {
+            ingest_queue_t *q = &queues[i];
+            int retry_due = q->retry_ms <= now;
+            done[i] = failed[i] = 0;
+            spooled[i] = q->spooled;
+            if (spooled[i] && retry_due)
+            {
+                if (db_spool_replay(q->spool_path, q->save) >= 0)
+                    spooled[i] = 0;
+                else
+                    failed[i] = 1;
+            }
+            if (q->batch_n == 0)
+                continue;
+
+            if (!spooled[i])
+            {
+                if (!retry_due)
+                    continue;
+                done[i] = q->save(q->batch, q->batch_n) == 0;
+                if (done[i])
+                    printf("[INGEST] Wrote %d %s rows\n", q->batch_n, q->name);
+                else
+                    failed[i] = 1;
+            }
+            if (!done[i] && db_spool_append(q->spool_path, q->batch, q->batch_n) == 0)
+            {
+                printf("[INGEST] Spooled %d %s rows\n", q->batch_n, q->name);
+                done[i] = spooled[i] = 1;
+            }
+            if (!done[i])
+                fprintf(stderr, "[INGEST] Write %d %s rows failed, retry in %d ms\n", q->batch_n, q->name,
+                        INGEST_RETRY_MS);
+        }
+
+        pthread_mutex_lock(&ingest_lock);
+        for (int i = 0; i < QUEUE_COUNT; i++)
+        {
+            ingest_queue_t *q = &queues[i];
+            q->spooled = spooled[i];
+            if (done[i])
+                q->batch_n = 0;
+            if (failed[i])
+                q->retry_ms = now_ms() + INGEST_RETRY_MS;
+            else if (done[i] && !q->spooled)
+                q->retry_ms = 0;
+        }
+        if (queues_empty())
+        {
+            flush_requested = 0;
+            pthread_cond_broadcast(&drained_cond);
+        }
+        pthread_mutex_unlock(&ingest_lock);
+    }
+    return NULL;
+}
+
+void db_ingest_init(void)
+{
+    static int initialized = 0;
+    if (initialized)
+        return;
+
+    // 等待超时使用单调时钟，不受系统校时影响
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ingest_cond, &attr);
+    pthread_cond_init(&drained_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    // 上次运行遗留的落盘数据，写线程启动后即尝试补写
+    for (int i = 0; i < QUEUE_COUNT; i++)
+        queues[i].spooled = db_spool_pending(queues[i].spool_path);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, ingest_writer_thread, NULL) != 0)
+    {
+        fprintf(stderr, "[INGEST] Failed to create writer thread\n");
+        return;
+    }
+    pthread_detach(thread);
+    initialized = 1;
+}
+
+int db_ingest_sensor(float temp, float humi)
+{
+    db_row_t row = {.ts = time(NULL), .temp = temp, .humi = humi};
+    return queue_push(&queues[0], &row);
+}
+
+int db_ingest_weather(float temp, float humi, const char *location, const char *desc)
+{
+    db_row_t row = {.ts = time(NULL), .temp = temp, .humi = humi};
+    snprintf(row.location, sizeof(row.location), "%s", location ? location : "");
+    snprintf(row.desc, sizeof(row.desc), "%s", desc ? desc : "");
+    return queue_push(&queues[1], &row);
+}
+
+int db_ingest_flush(int timeout_ms)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&ingest_lock);
+    int ret = 0;
+    if (!queues_empty())
+    {
+        flush_requested = 1;
+        pthread_cond_signal(&ingest_cond);
+        while (!queues_empty() && ret == 0)
+            ret = pthread_cond_timedwait(&drained_cond, &ingest_lock, &deadline) == 0 ? 0 : -1;
+    }
+    pthread_mutex_unlock(&ingest_lock);
+    return ret;
+}
@@ -0,0 +1,1211 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include <mysql/mysql.h>
+#include <mysql/errmsg.h>
+#include "db_helper.h"
+#include "db_backend.h"
+#include "db_pool.h"
+
+// MySQL 8 起移除了 my_bool（MariaDB 仍保留）
+#if !defined(MARIADB_BASE_VERSION) && defined(MYSQL_VERSION_ID) && MYSQL_VERSION_ID >= 80001
+#include <stdbool.h>
+typedef bool my_bool;
+#endif
+
+// 表结构只需在首次成功连接时确认一次
+static pthread_mutex_t schema_lock = PTHREAD_MUTEX_INITIALIZER;
+static int schema_ready = 0;
+
+static void rollup_backfill(MYSQL *db, const char *src, const char *dst, const char *tcol, const char *hcol,
+                            const char *desc_col);
+static void schema_migrate(MYSQL *db);
+static void explain_range_queries(MYSQL *db);
+static void catalog_note_insert(const char *name, int n);
+
+/* ========== 预处理语句缓存 ========== */
+// 固定形状的读写全部走二进制协议：服务器只解析一次，客户端不再做数值与文本的往返转换
+// 语句缓存在各自连接的槽位中，随连接由连接池释放，重连后按需重新 prepare
+typedef enum
+{
+    STMT_SENSOR_INSERT = 0,
+    STMT_WEATHER_INSERT,
+    STMT_SENSOR_ROLLUP_ADD,
+    STMT_WEATHER_ROLLUP_ADD,
+    STMT_SENSOR_RANGE,
+    STMT_SENSOR_ROLLUP_RANGE,
+    STMT_WEATHER_RANGE,
+    STMT_WEATHER_ROLLUP_RANGE,
+    STMT_SENSOR_ROWS_AFTER,
+    STMT_SENSOR_MAX_ID,
+    STMT_COUNT
+} db_stmt_id_t;
+
+#define ROLLUP_COLS "(res, bucket, cnt, t_min, t_max, t_sum, t_sumsq, h_min, h_max, h_sum, h_sumsq"
+#define ROLLUP_ROW "(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?"
+#define ROLLUP_UPSERT                                                                 \
+    " ON DUPLICATE KEY UPDATE cnt = cnt + VALUES(cnt), "                              \
+    "t_min = LEAST(t_min, VALUES(t_min)), t_max = GREATEST(t_max, VALUES(t_max)), "   \
+    "t_sum = t_sum + VALUES(t_sum), t_sumsq = t_sumsq + VALUES(t_sumsq), "            \
+    "h_min = LEAST(h_min, VALUES(h_min)), h_max = GREATEST(h_max, VALUES(h_max)), "   \
+    "h_sum = h_sum + VALUES(h_sum), h_sumsq = h_sumsq + VALUES(h_sumsq)"
+
+static const struct
+{
+    const char *name;
+    const char *sql;
+} stmt_defs[STMT_COUNT] = {
+    [STMT_SENSOR_INSERT] = {"sensor insert",
+                            "INSERT INTO sensor_data (ts, temp, humi) VALUES (FROM_UNIXTIME(?), ?, ?)"},
+    [STMT_WEATHER_INSERT] = {"weather insert",
+                             "INSERT INTO weather (ts, temperature, humidity, location, weather_desc) "
+                             "VALUES (FROM_UNIXTIME(?), ?, ?, ?, ?)"},
+    [STMT_SENSOR_ROLLUP_ADD] = {"sensor rollup",
+                                "INSERT INTO sensor_rollup " ROLLUP_COLS ") VALUES " ROLLUP_ROW ")" ROLLUP_UPSERT},
+    [STMT_WEATHER_ROLLUP_ADD] = {"weather rollup",
+                                 "INSERT INTO weather_rollup " ROLLUP_COLS ", last_desc) VALUES " ROLLUP_ROW
+                                 ", ?)" ROLLUP_UPSERT ", last_desc = VALUES(last_desc)"},
+    [STMT_SENSOR_RANGE] = {"sensor range",
+                           "SELECT UNIX_TIMESTAMP(ts), temp, humi FROM sensor_data "
+                           "WHERE ts >= FROM_UNIXTIME(?) AND ts <= FROM_UNIXTIME(?) "
+                           "AND temp IS NOT NULL AND humi IS NOT NULL ORDER BY ts ASC"},
+    [STMT_SENSOR_ROLLUP_RANGE] = {"sensor rollup range",
+                                  "SELECT bucket, t_sum / cnt, h_sum / cnt FROM sensor_rollup "
+                                  "WHERE res = ? AND bucket >= ? AND bucket <= ? ORDER BY bucket ASC"},
+    [STMT_WEATHER_RANGE] = {"weather range",
+                            "SELECT UNIX_TIMESTAMP(ts), temperature, humidity, weather_desc FROM weather "
+                            "WHERE ts >= FROM_UNIXTIME(?) AND ts <= FROM_UNIXTIME(?) "
+                            "AND temperature IS NOT NULL AND humidity IS NOT NULL ORDER BY ts ASC"},
+    [STMT_WEATHER_ROLLUP_RANGE] = {"weather rollup range",
+                                   "SELECT bucket, t_sum / cnt, h_sum / cnt, last_desc FROM weather_rollup "
+                                   "WHERE res = ? AND bucket >= ? AND bucket <= ? ORDER BY bucket ASC"},
+    [STMT_SENSOR_ROWS_AFTER] = {"sensor rows after",
+                                "SELECT id, UNIX_TIMESTAMP(ts), temp, humi FROM sensor_data "
+                                "WHERE id > ? AND temp IS NOT NULL AND humi IS NOT NULL ORDER BY id ASC LIMIT ?"},
+    [STMT_SENSOR_MAX_ID] = {"sensor max id", "SELECT IFNULL(MAX(id), 0) FROM sensor_data"},
+};
+
+_Static_assert(STMT_COUNT <= DB_POOL_STMT_SLOTS, "statement slots exhausted");
+
+// 取连接上的缓存语句，首次使用时 prepare；失败返回 NULL，错误码写入 *err
+static MYSQL_STMT *stmt_get(db_conn_t *conn, db_stmt_id_t id, unsigned int *err)
+{
+    if (conn->stmt[id])
+        return conn->stmt[id];
+
+    MYSQL_STMT *st = mysql_stmt_init(conn->mysql);
+    if (st == NULL)
+    {
+        *err = mysql_errno(conn->mysql);
+        fprintf(stderr, "[DB] %s: mysql_stmt_init failed\n", stmt_defs[id].name);
+        return NULL;
+    }
+    if (mysql_stmt_prepare(st, stmt_defs[id].sql, strlen(stmt_defs[id].sql)))
+    {
+        *err = mysql_stmt_errno(st);
+        fprintf(stderr, "[DB] %s: prepare failed: %s\n", stmt_defs[id].name, mysql_stmt_error(st));
+        mysql_stmt_close(st);
+        return NULL;
+    }
+    conn->stmt[id] = st;
+    return st;
+}
+
+// 绑定参数并执行；attempts > 1 时连接断开会重连、重新 prepare 后重试
+static MYSQL_STMT *stmt_run(db_conn_t *conn, db_stmt_id_t id, MYSQL_BIND *params, int attempts)
+{
+    for (int attempt = 0; attempt < attempts; attempt++)
+    {
+        unsigned int err = 0;
+        MYSQL_STMT *st = stmt_get(conn, id, &err);
+        if (st)
+        {
+            if ((params == NULL || mysql_stmt_bind_param(st, params) == 0) && mysql_stmt_execute(st) == 0)
+                return st;
+            err = mysql_stmt_errno(st);
+            fprintf(stderr, "[DB] %s failed: %s\n", stmt_defs[id].name, mysql_stmt_error(st));
+        }
+
+        if (err != CR_SERVER_GONE_ERROR && err != CR_SERVER_LOST)
+            return NULL;
+        if (attempt + 1 < attempts && db_pool_reconnect(conn) != 0)
+            return NULL;
+    }
+    return NULL;
+}
+
+static MYSQL_STMT *stmt_exec(db_conn_t *conn, db_stmt_id_t id, MYSQL_BIND *params)
+{
+    return stmt_run(conn, id, params, 2);
+}
+
+static void bind_value(MYSQL_BIND *b, enum enum_field_types type, void *buffer)
+{
+    memset(b, 0, sizeof(*b));
+    b->buffer_type = type;
+    b->buffer = buffer;
+}
+
+// 输入字符串参数，NULL 绑定为 SQL NULL
+static void bind_string(MYSQL_BIND *b, const char *s, my_bool *is_null)
+{
+    bind_value(b, MYSQL_TYPE_STRING, (void *)s);
+    b->buffer_length = s ? strlen(s) : 0;
+    *is_null = s == NULL;
+    b->is_null = is_null;
+}
+
+// 绑定结果缓冲并把结果集取回客户端，返回行数（失败 -1，已释放结果）
+static int stmt_store(MYSQL_STMT *st, MYSQL_BIND *result)
+{
+    if (mysql_stmt_bind_result(st, result) || mysql_stmt_store_result(st))
+    {
+        fprintf(stderr, "[DB] Fetch failed: %s\n", mysql_stmt_error(st));
+        mysql_stmt_free_result(st);
+        return -1;
+    }
+    return (int)mysql_stmt_num_rows(st);
+}
+
+// 取下一行；字符串列超出缓冲时按截断处理
+static int stmt_next(MYSQL_STMT *st)
+{
+    int rc = mysql_stmt_fetch(st);
+    return rc == 0 || rc == MYSQL_DATA_TRUNCATED;
+}
+
+// 借出连接；首次使用时完成建表与迁移
+static int sql_init(void);
+
+static db_conn_t *db_acquire(void)
+{
+    if (sql_init() != 0)
+        return NULL;
+    return db_pool_acquire();
+}
+
+// FLOAT 列按二进制取回是 float 精度（23.4 → 23.3999996），写入端固定 0.1 精度，这里还原
+static double float_col(double v)
+{
+    return round(v * 10) / 10.0;
+}
+
+static int sql_init(void)
+{
+    pthread_mutex_lock(&schema_lock);
+    if (schema_ready)
+    {
+        pthread_mutex_unlock(&schema_lock);
+        return 0;
+    }
+
+    db_conn_t *conn = db_pool_acquire();
+    if (conn == NULL)
+    {
+        pthread_mutex_unlock(&schema_lock);
+        return -1;
+    }
+    MYSQL *db = conn->mysql;
+
+    // ---- 建表（确保表存在） ----
+    const char *create_sensor =
+        "CREATE TABLE IF NOT EXISTS sensor_data ("
+        "id INT AUTO_INCREMENT PRIMARY KEY, "
+        "ts TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+        "temp FLOAT, "
+        "humi FLOAT)";
+
+    const char *create_weather =
+        "CREATE TABLE IF NOT EXISTS weather ("
+        "id INT AUTO_INCREMENT PRIMARY KEY, "
+        "ts TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+        "temperature FLOAT, "
+        "humidity FLOAT, "
+        "location VARCHAR(100), "
+        "weather_desc VARCHAR(50))";
+
+    if (mysql_query(db, create_sensor))
+    {
+        fprintf(stderr, "[DB] Create sensor table failed: %s\n", mysql_error(db));
+        // 不致命，继续
+    }
+    if (mysql_query(db, create_weather))
+    {
+        fprintf(stderr, "[DB] Create weather table failed: %s\n", mysql_error(db));
+        // 不致命，继续
+    }
+
+    // ---- 汇总表：res 为桶宽（秒），bucket 为桶起点（UNIX 时间，按本地时间对齐） ----
+    const char *create_sensor_rollup =
+        "CREATE TABLE IF NOT EXISTS sensor_rollup ("
+        "res INT NOT NULL, "
+        "bucket INT NOT NULL, "
+        "cnt INT NOT NULL, "
+        "t_min FLOAT, t_max FLOAT, t_sum DOUBLE, t_sumsq DOUBLE, "
+        "h_min FLOAT, h_max FLOAT, h_sum DOUBLE, h_sumsq DOUBLE, "
+        "PRIMARY KEY (res, bucket))";
+
+    const char *create_weather_rollup =
+        "CREATE TABLE IF NOT EXISTS weather_rollup ("
+        "res INT NOT NULL, "
+        "bucket INT NOT NULL, "
+        "cnt INT NOT NULL, "
+        "t_min FLOAT, t_max FLOAT, t_sum DOUBLE, t_sumsq DOUBLE, "
+        "h_min FLOAT, h_max FLOAT, h_sum DOUBLE, h_sumsq DOUBLE, "
+        "last_desc VARCHAR(50), "
+        "PRIMARY KEY (res, bucket))";
+
+    if (mysql_query(db, create_sensor_rollup))
+        fprintf(stderr, "[DB] Create sensor_rollup failed: %s\n", mysql_error(db));
+    if (mysql_query(db, create_weather_rollup))
+        fprintf(stderr, "[DB] Create weather_rollup failed: %s\n", mysql_error(db));
+
+    // 首次启用汇总表时从原始数据回填
+    rollup_backfill(db, "sensor_data", "sensor_rollup", "temp", "humi", NULL);
+    rollup_backfill(db, "weather", "weather_rollup", "temperature", "humidity", "weather_desc");
+
+    schema_migrate(db);
+    explain_range_queries(db);
+
+    db_pool_release(conn);
+    schema_ready = 1;
+    pthread_mutex_unlock(&schema_lock);
+
+    printf("[DB] Connected to MySQL and tables ready\n");
+    return 0;
+}
+
+/* ========== 表结构迁移 ========== */
+// 按版本号顺序执行，已执行的版本记录在 schema_migrations 中，只追加不修改
+typedef struct
+{
+    int version;
+    const char *desc;
+    const char *sql;
+} db_migration_t;
+
+static const db_migration_t migrations[] = {
+    // 时间范围查询走索引；sensor_data 附带 temp/humi 作覆盖索引，范围读取无需回表
+    {1, "sensor_data ts index", "ALTER TABLE sensor_data ADD INDEX idx_sensor_ts (ts, temp, humi)"},
+    {2, "weather ts index", "ALTER TABLE weather ADD INDEX idx_weather_ts (ts)"},
+};
+#define MIGRATION_COUNT ((int)(sizeof(migrations) / sizeof(migrations[0])))
+
+// MySQL 错误码：索引名已存在（手工建过索引时视为已完成）
+#define ER_DUP_KEYNAME_CODE 1061
+
+static void schema_migrate(MYSQL *db)
+{
+    if (mysql_query(db,
+                    "CREATE TABLE IF NOT EXISTS schema_migrations ("
+                    "version INT PRIMARY KEY, "
+                    "description VARCHAR(64), "
+                    "applied_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP)"))
+    {
+        fprintf(stderr, "[DB] Create schema_migrations failed: %s\n", mysql_error(db));
+        return;
+    }
+
+    int current = 0;
+    if (mysql_query(db, "SELECT IFNULL(MAX(version), 0) FROM schema_migrations") == 0)
+    {
+        MYSQL_RES *res = mysql_store_result(db);
+        if (res)
+        {
+            MYSQL_ROW row = mysql_fetch_row(res);
+            current = (row && row[0]) ? atoi(row[0]) : 0;
+            mysql_free_result(res);
+        }
+    }
+
+    for (int i = 0; i < MIGRATION_COUNT; i++)
+    {
+        const db_migration_t *m = &migrations[i];
+        if (m->version <= current)
+            continue;
+
+        if (mysql_query(db, m->sql) && mysql_errno(db) != ER_DUP_KEYNAME_CODE)
+        {
+            // 失败即停止，后续版本可能依赖本版本
+            fprintf(stderr, "[DB] Migration %d (%s) failed: %s\n", m->version, m->desc, mysql_error(db));
+            return;
+        }
+
+        char sql[256];
+        snprintf(sql, sizeof(sql),
+                 "INSERT INTO schema_migrations (version, description) VALUES (%d, '%s')",
+                 m->version, m->desc);
+        if (mysql_query(db, sql))
+        {
+            fprintf(stderr, "[DB] Record migration %d failed: %s\n", m->version, mysql_error(db));
+            return;
+        }
+        printf("[DB] Migration %d applied: %s\n", m->version, m->desc);
+    }
+}
+
+// 打印最近 24 小时范围查询（与 STMT_*_RANGE 同形）的执行计划，确认 ts 索引被使用（type=range, key=idx_*）
+static void explain_one(MYSQL *db, const char *label, const char *query)
+{
+    char sql[600];
+    snprintf(sql, sizeof(sql), "EXPLAIN %s", query);
+    if (mysql_query(db, sql))
+    {
+        fprintf(stderr, "[DB] EXPLAIN %s failed: %s\n", label, mysql_error(db));
+        return;
+    }
+    MYSQL_RES *res = mysql_store_result(db);
+    if (!res)
+        return;
+
+    // 不同 MySQL/MariaDB 版本列顺序不同，按列名定位
+    int col_type = -1, col_key = -1, col_rows = -1, col_extra = -1;
+    unsigned nf = mysql_num_fields(res);
+    MYSQL_FIELD *fields = mysql_fetch_fields(res);
+    for (unsigned c = 0; c < nf; c++)
+    {
+        if (strcmp(fields[c].name, "type") == 0)
+            col_type = c;
+        else if (strcmp(fields[c].name, "key") == 0)
+            col_key = c;
+        else if (strcmp(fields[c].name, "rows") == 0)
+            col_rows = c;
+        else if (strcmp(fields[c].name, "Extra") == 0)
+            col_extra = c;
+    }
+
+#define EXPLAIN_COL(c) ((c) >= 0 && row[c] ? row[c] : "NULL")
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res)))
+    {
+        printf("[DB] EXPLAIN %s: type=%s key=%s rows=%s extra=%s\n", label,
+               EXPLAIN_COL(col_type), EXPLAIN_COL(col_key), EXPLAIN_COL(col_rows), EXPLAIN_COL(col_extra));
+    }
+#undef EXPLAIN_COL
+    mysql_free_result(res);
+}
+
+static void explain_range_queries(MYSQL *db)
+{
+    time_t now = time(NULL);
+    char query[512];
+
+    snprintf(query, sizeof(query),
+             "SELECT temp, humi FROM sensor_data "
+             "WHERE ts >= FROM_UNIXTIME(%ld) AND ts <= FROM_UNIXTIME(%ld) "
+             "AND temp IS NOT NULL AND humi IS NOT NULL ORDER BY ts ASC",
+             (long)(now - 86400), (long)now);
+    explain_one(db, "sensor_data", query);
+
+    snprintf(query, sizeof(query),
+             "SELECT temperature, humidity, weather_desc FROM weather "
+             "WHERE ts >= FROM_UNIXTIME(%ld) AND ts <= FROM_UNIXTIME(%ld) "
+             "AND temperature IS NOT NULL AND humidity IS NOT NULL ORDER BY ts ASC",
+             (long)(now - 86400), (long)now);
+    explain_one(db, "weather", query);
+}
+
+/* ========== 汇总表（1分钟 / 1小时 / 1天） ========== */
+static const int rollup_res[] = {DB_RES_MINUTE, DB_RES_HOUR, DB_RES_DAY};
+#define ROLLUP_LEVELS ((int)(sizeof(rollup_res) / sizeof(rollup_res[0])))
+
+static void rollup_backfill(MYSQL *db, const char *src, const char *dst, const char *tcol, const char *hcol,
+                            const char *desc_col)
+{
+    char sql[1024];
+    snprintf(sql, sizeof(sql), "SELECT 1 FROM `%s` LIMIT 1", dst);
+    if (mysql_query(db, sql))
+        return;
+    MYSQL_RES *res = mysql_store_result(db);
+    if (!res)
+        return;
+    int has_rows = mysql_num_rows(res) > 0;
+    mysql_free_result(res);
+    if (has_rows)
+        return;
+
+    // 回填时无法确定桶内最后一条描述，取 MAX 近似
+    char desc_sel[64] = "";
+    if (desc_col)
+        snprintf(desc_sel, sizeof(desc_sel), ", MAX(%s)", desc_col);
+
+    long off = db_local_gmtoff();
+    for (int i = 0; i < ROLLUP_LEVELS; i++)
+    {
+        int r = rollup_res[i];
+        snprintf(sql, sizeof(sql),
+                 "INSERT INTO `%s` (res, bucket, cnt, t_min, t_max, t_sum, t_sumsq, "
+                 "h_min, h_max, h_sum, h_sumsq%s) "
+                 "SELECT %d, FLOOR((UNIX_TIMESTAMP(ts) + %ld) / %d) * %d - %ld AS b, COUNT(*), "
+                 "MIN(%s), MAX(%s), SUM(%s), SUM(%s * %s), "
+                 "MIN(%s), MAX(%s), SUM(%s), SUM(%s * %s)%s "
+                 "FROM `%s` WHERE %s IS NOT NULL AND %s IS NOT NULL GROUP BY b",
+                 dst, desc_col ? ", last_desc" : "",
+                 r, off, r, r, off,
+                 tcol, tcol, tcol, tcol, tcol,
+                 hcol, hcol, hcol, hcol, hcol, desc_sel,
+                 src, tcol, hcol);
+        if (mysql_query(db, sql))
+        {
+            fprintf(stderr, "[DB] Rollup backfill %s/%d failed: %s\n", dst, r, mysql_error(db));
+            return;
+        }
+    }
+    printf("[DB] Rollup %s backfilled from %s\n", dst, src);
+}
+
+typedef struct
+{
+    int res, cnt;
+    long long bucket;
+    double t_min, t_max, t_sum, t_sumsq;
+    double h_min, h_max, h_sum, h_sumsq;
+} rollup_acc_t;
+
+static int rollup_upsert(db_conn_t *conn, db_stmt_id_t id, rollup_acc_t *a, const char *desc)
+{
+    my_bool desc_null;
+    MYSQL_BIND p[12];
+    bind_value(&p[0], MYSQL_TYPE_LONG, &a->res);
+    bind_value(&p[1], MYSQL_TYPE_LONGLONG, &a->bucket);
+    bind_value(&p[2], MYSQL_TYPE_LONG, &a->cnt);
+    bind_value(&p[3], MYSQL_TYPE_DOUBLE, &a->t_min);
+    bind_value(&p[4], MYSQL_TYPE_DOUBLE, &a->t_max);
+    bind_value(&p[5], MYSQL_TYPE_DOUBLE, &a->t_sum);
+    bind_value(&p[6], MYSQL_TYPE_DOUBLE, &a->t_sumsq);
+    bind_value(&p[7], MYSQL_TYPE_DOUBLE, &a->h_min);
+    bind_value(&p[8], MYSQL_TYPE_DOUBLE, &a->h_max);
+    bind_value(&p[9], MYSQL_TYPE_DOUBLE, &a->h_sum);
+    bind_value(&p[10], MYSQL_TYPE_DOUBLE, &a->h_sumsq);
+    if (id == STMT_WEATHER_ROLLUP_ADD)
+        bind_string(&p[11], desc, &desc_null);
+    return stmt_run(conn, id, p, 1) ? 0 : -1;
+}
+
+// 批内行按时间先后排列，相邻同桶的行先在本地合并，每个桶只发一条 upsert
+static int rollup_batch(db_conn_t *conn, db_stmt_id_t id, const db_row_t *rows, int n)
+{
+    long gmtoff = db_local_gmtoff();
+    for (int l = 0; l < ROLLUP_LEVELS; l++)
+    {
+        int i = 0;
+        while (i < n)
+        {
+            rollup_acc_t a = {.res = rollup_res[l], .bucket = db_bucket_start(rows[i].ts, rollup_res[l], gmtoff)};
+            int j = i;
+            while (j < n && db_bucket_start(rows[j].ts, rollup_res[l], gmtoff) == a.bucket)
+            {
+                // 与原始表一致按 0.1 精度入账
+                double t = round(rows[j].temp * 10) / 10.0, h = round(rows[j].humi * 10) / 10.0;
+                a.t_min = a.cnt ? fmin(a.t_min, t) : t;
+                a.t_max = a.cnt ? fmax(a.t_max, t) : t;
+                a.h_min = a.cnt ? fmin(a.h_min, h) : h;
+                a.h_max = a.cnt ? fmax(a.h_max, h) : h;
+                a.t_sum += t;
+                a.t_sumsq += t * t;
+                a.h_sum += h;
+                a.h_sumsq += h * h;
+                a.cnt++;
+                j++;
+            }
+            if (rollup_upsert(conn, id, &a, rows[j - 1].desc) != 0)
+                return -1;
+            i = j;
+        }
+    }
+    return 0;
+}
+
+// 批量写入放在一个事务里：只提交一次，失败整批回滚，调用方可原样重试
+static int txn_begin(db_conn_t *conn)
+{
+    if (mysql_query(conn->mysql, "START TRANSACTION") == 0)
+        return 0;
+    unsigned int err = mysql_errno(conn->mysql);
+    if ((err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST) && db_pool_reconnect(conn) == 0 &&
+        mysql_query(conn->mysql, "START TRANSACTION") == 0)
+        return 0;
+    fprintf(stderr, "[DB] START TRANSACTION failed: %s\n", mysql_error(conn->mysql));
+    return -1;
+}
+
+static int txn_end(db_conn_t *conn, int ok)
+{
+    if (ok && mysql_commit(conn->mysql) == 0)
+        return 0;
+    if (ok)
+        fprintf(stderr, "[DB] COMMIT failed: %s\n", mysql_error(conn->mysql));
+    mysql_rollback(conn->mysql);
+    return -1;
+}
+
+// 原始行与汇总桶在同一事务中写入；weather 行额外写地点与描述
+static int save_batch(db_stmt_id_t insert_id, db_stmt_id_t rollup_id, const db_row_t *rows, int n)
+{
+    if (n <= 0)
+        return 0;
+    db_conn_t *conn = db_acquire();
+    if (conn == NULL)
+        return -1;
+    if (txn_begin(conn) != 0)
+    {
+        db_pool_release(conn);
+        return -1;
+    }
+
+    int ok = 1;
+    for (int i = 0; i < n && ok; i++)
+    {
+        // 显式写入时间戳，与汇总桶保持一致；数值按 0.1 精度入库
+        long long ts = rows[i].ts;
+        float t = roundf(rows[i].temp * 10) / 10.0f, h = roundf(rows[i].humi * 10) / 10.0f;
+        my_bool loc_null, desc_null;
+        MYSQL_BIND p[5];
+        bind_value(&p[0], MYSQL_TYPE_LONGLONG, &ts);
+        bind_value(&p[1], MYSQL_TYPE_FLOAT, &t);
+        bind_value(&p[2], MYSQL_TYPE_FLOAT, &h);
+        if (insert_id == STMT_WEATHER_INSERT)
+        {
+            // 字符串以参数绑定传入，无需转义
+            bind_string(&p[3], rows[i].location, &loc_null);
+            bind_string(&p[4], rows[i].desc, &desc_null);
+        }
+        // 事务中断线不能重连重试，否则前面的行已随旧连接回滚
+        ok = stmt_run(conn, insert_id, p, 1) != NULL;
+    }
+    if (ok)
+        ok = rollup_batch(conn, rollup_id, rows, n) == 0;
+
+    int ret = txn_end(conn, ok);
+    db_pool_release(conn);
+    if (ret == 0)
+        catalog_note_insert(insert_id == STMT_WEATHER_INSERT ? "weather" : "sensor_data", n);
+    return ret;
+}
+
+static int sql_save_sensor_batch(const db_row_t *rows, int n)
+{
+    return save_batch(STMT_SENSOR_INSERT, STMT_SENSOR_ROLLUP_ADD, rows, n);
+}
+
+static int sql_save_weather_batch(const db_row_t *rows, int n)
+{
+    return save_batch(STMT_WEATHER_INSERT, STMT_WEATHER_ROLLUP_ADD, rows, n);
+}
+
+static void sql_close(void)
+{
+    db_pool_close_all();
+}
+
+/* ========== 表目录缓存（供UI显示） ========== */
+// 打开导出列表不再逐表 SELECT COUNT(*)（InnoDB 每次都是一次全索引扫描），而是直接读缓存：
+//   首次由 information_schema.TABLES 一条查询取得全部表及 TABLE_ROWS 估算行数
+//   写入路径维护的表（原始数据表）在后台线程精确计数一次，此后按每次提交的行数累加
+//   其余表（汇总表等）沿用估算值，每 CATALOG_REFRESH_S 秒在后台重新读取一次
+
+#define CATALOG_MAX 16
+#define CATALOG_REFRESH_S 600
+
+typedef struct
+{
+    char name[32];
+    char desc[32];
+    long long base;     // 最近一次计数（或估算）
+    long long inserted; // 此后写入路径提交的行数
+    int tracked;        // 由写入路径累加
+    int approx;         // base 仍是 TABLE_ROWS 估算值
+} catalog_entry_t;
+
+static const char *const catalog_tracked[] = {"sensor_data", "weather"};
+
+static pthread_mutex_t catalog_lock = PTHREAD_MUTEX_INITIALIZER;
+static catalog_entry_t catalog[CATALOG_MAX];
+static int catalog_count = 0;
+static int catalog_loaded = 0;
+static int catalog_refreshing = 0;
+static time_t catalog_refreshed = 0; // CLOCK_MONOTONIC 秒，0 表示从未刷新
+
+static time_t catalog_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec;
+}
+
+static catalog_entry_t *catalog_find(const char *name)
+{
+    for (int i = 0; i < catalog_count; i++)
+    {
+        if (strcmp(catalog[i].name, name) == 0)
+            return &catalog[i];
+    }
+    return NULL;
+}
+
+// 写入事务提交后调用（save_batch）
+static void catalog_note_insert(const char *name, int n)
+{
+    pthread_mutex_lock(&catalog_lock);
+    catalog_entry_t *e = catalog_find(name);
+    if (e)
+        e->inserted += n;
+    pthread_mutex_unlock(&catalog_lock);
+}
+
+// 读取表名与 TABLE_ROWS 估算并与缓存合并：已精确计数的维护表保留计数，其余取新估算
+static int catalog_load(MYSQL *db)
+{
+    /* 查询所有用户表（排除系统表） */
+    if (mysql_query(db,
+                    "SELECT table_name, IFNULL(table_rows, 0) FROM information_schema.tables "
+                    "WHERE table_schema='mydb' AND table_type='BASE TABLE' ORDER BY table_name"))
+    {
+        return -1;
+    }
+
+    MYSQL_RES *res = mysql_store_result(db);
+    if (!res)
+        return -1;
+
+    catalog_entry_t fresh[CATALOG_MAX];
+    int n = 0;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res)) && n < CATALOG_MAX)
+    {
+        const char *name = row[0];
+
+        /* 跳过系统表 */
+        if (strcmp(name, "tables_priv") == 0 ||
+            strcmp(name, "columns_priv") == 0 ||
+            strcmp(name, "db") == 0 ||
+            strcmp(name, "user") == 0)
+        {
+            continue;
+        }
+
+        catalog_entry_t *e = &fresh[n++];
+        memset(e, 0, sizeof(*e));
+        strncpy(e->name, name, sizeof(e->name) - 1);
+
+        /* 显示名称：sensor_data → "Sensor Data" */
+        if (strcmp(name, "sensor_data") == 0)
+            strcpy(e->desc, "Sensor Data");
+        else
+            strncpy(e->desc, name, sizeof(e->desc) - 1);
+
+        e->base = atoll(row[1]);
+        e->approx = 1;
+        for (size_t k = 0; k < sizeof(catalog_tracked) / sizeof(catalog_tracked[0]); k++)
+        {
+            if (strcmp(name, catalog_tracked[k]) == 0)
+                e->tracked = 1;
+        }
+    }
+    mysql_free_result(res);
+
+    pthread_mutex_lock(&catalog_lock);
+    for (int i = 0; i < n; i++)
+    {
+        catalog_entry_t *old = catalog_find(fresh[i].name);
+        if (old && old->tracked && !old->approx)
+            fresh[i] = *old;
+    }
+    memcpy(catalog, fresh, n * sizeof(fresh[0]));
+    catalog_count = n;
+    catalog_loaded = 1;
+    pthread_mutex_unlock(&catalog_lock);
+    return 0;
+}
+
+// 维护表的精确计数：计数期间提交的行保留在 inserted 中（可能与计数重叠几行，仅用于显示）
+static void catalog_count_exact(MYSQL *db, const char *name)
+{
+    pthread_mutex_lock(&catalog_lock);
+    catalog_entry_t *e = catalog_find(name);
+    long long ins0 = e ? e->inserted : 0;
+    pthread_mutex_unlock(&catalog_lock);
+    if (!e)
+        return;
+
+    char cnt_sql[128];
+    snprintf(cnt_sql, sizeof(cnt_sql), "SELECT COUNT(*) FROM `%s`", name);
+    if (mysql_query(db, cnt_sql) != 0)
+        return;
+    MYSQL_RES *res = mysql_store_result(db);
+    if (!res)
+        return;
+    MYSQL_ROW row = mysql_fetch_row(res);
+    long long count = row && row[0] ? atoll(row[0]) : -1;
+    mysql_free_result(res);
+    if (count < 0)
+        return;
+
+    pthread_mutex_lock(&catalog_lock);
+    e = catalog_find(name);
+    if (e)
+    {
+        e->base = count;
+        e->inserted -= ins0;
+        e->approx = 0;
+    }
+    pthread_mutex_unlock(&catalog_lock);
+}
+
+static void *catalog_refresh_thread(void *arg)
+{
+    (void)arg;
+    db_conn_t *conn = db_acquire();
+    int ok = 0;
+    if (conn)
+    {
+        ok = catalog_load(conn->mysql) == 0;
+        for (size_t k = 0; ok && k < sizeof(catalog_tracked) / sizeof(catalog_tracked[0]); k++)
+        {
+            pthread_mutex_lock(&catalog_lock);
+            catalog_entry_t *e = catalog_find(catalog_tracked[k]);
+            int need = e && e->approx;
+            pthread_mutex_unlock(&catalog_lock);
+            if (need)
+                catalog_count_exact(conn->mysql, catalog_tracked[k]);
+        }
+        db_pool_release(conn);
+    }
+
+    pthread_mutex_lock(&catalog_lock);
+    catalog_refreshing = 0;
+    if (ok)
+        catalog_refreshed = catalog_now();
+    pthread_mutex_unlock(&catalog_lock);
+    return NULL;
+}
+
+// 调用方持有 catalog_lock
+static void catalog_kick_refresh(void)
+{
+    if (catalog_refreshing ||
+        (catalog_refreshed != 0 && catalog_now() - catalog_refreshed < CATALOG_REFRESH_S))
+        return;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, catalog_refresh_thread, NULL) != 0)
+    {
+        fprintf(stderr, "[DB] Failed to create catalog refresh thread\n");
+        return;
+    }
+    pthread_detach(thread);
+    catalog_refreshing = 1;
+}
+
+static int sql_table_list(db_table_info_t *out, int max_count)
+{
+    pthread_mutex_lock(&catalog_lock);
+    int loaded = catalog_loaded;
+    pthread_mutex_unlock(&catalog_lock);
+
+    // 首次打开只有一条 information_schema 查询，不扫描数据
+    if (!loaded)
+    {
+        db_conn_t *conn = db_acquire();
+        if (conn == NULL)
+            return 0;
+        int ret = catalog_load(conn->mysql);
+        db_pool_release(conn);
+        if (ret != 0)
+            return 0;
+    }
+
+    pthread_mutex_lock(&catalog_lock);
+    int i;
+    for (i = 0; i < catalog_count && i < max_count; i++)
+    {
+        long long count = catalog[i].base + catalog[i].inserted;
+        memset(&out[i], 0, sizeof(out[i]));
+        memcpy(out[i].name, catalog[i].name, sizeof(out[i].name));
+        memcpy(out[i].desc, catalog[i].desc, sizeof(out[i].desc));
+        out[i].count = count > INT_MAX ? INT_MAX : (int)count;
+        out[i].approx = catalog[i].approx;
+    }
+    catalog_kick_refresh();
+    pthread_mutex_unlock(&catalog_lock);
+    return i;
+}
+
+/* ========== 整表导出（逐行交给 sink） ========== */
+
+#define EXPORT_MAX_COLS 32
+
+static int export_rows(MYSQL *db, const char *tablename, const db_export_sink_t *sink, char *msg, int msg_len)
+{
+    char data_sql[256];
+    snprintf(data_sql, sizeof(data_sql), "SELECT * FROM `%s`", tablename);
+    if (mysql_query(db, data_sql))
+    {
+        snprintf(msg, msg_len, "Query Err");
+        return -1;
+    }
+
+    /* 逐行从连接读取，不在客户端缓存整个表 */
+    MYSQL_RES *res = mysql_use_result(db);
+    if (!res)
+    {
+        snprintf(msg, msg_len, "No Data");
+        return -1;
+    }
+
+    /* 列名与类型取自结果集元数据，数值列按数值写出，无需逐格猜测 */
+    int col_count = (int)mysql_num_fields(res);
+    if (col_count > EXPORT_MAX_COLS)
+        col_count = EXPORT_MAX_COLS;
+    MYSQL_FIELD *fields = mysql_fetch_fields(res);
+    const char *names[EXPORT_MAX_COLS];
+    int is_num[EXPORT_MAX_COLS];
+    for (int c = 0; c < col_count; c++)
+    {
+        names[c] = fields[c].name;
+        is_num[c] = IS_NUM(fields[c].type);
+    }
+
+    int rows = 0, stopped = sink->columns(sink->user, names, col_count) != 0;
+    db_cell_t cells[EXPORT_MAX_COLS];
+    MYSQL_ROW r;
+    while (!stopped && (r = mysql_fetch_row(res)))
+    {
+        for (int c = 0; c < col_count; c++)
+        {
+            cells[c].str = r[c];
+            cells[c].is_num = is_num[c] && r[c];
+            cells[c].num = cells[c].is_num ? strtod(r[c], NULL) : 0;
+        }
+        stopped = sink->row(sink->user, cells, col_count) != 0;
+        rows++;
+    }
+
+    /* 中止时 mysql_free_result 会读完剩余行，连接可继续使用 */
+    int fetch_err = !stopped && mysql_errno(db) != 0;
+    mysql_free_result(res);
+    if (fetch_err)
+    {
+        snprintf(msg, msg_len, "Read Err");
+        return -1;
+    }
+    if (stopped)
+    {
+        snprintf(msg, msg_len, "Stopped");
+        return -2;
+    }
+    return rows;
+}
+
+static int sql_export_rows(const char *tablename, const db_export_sink_t *sink, char *msg, int msg_len)
+{
+    db_conn_t *conn = db_acquire();
+    if (conn == NULL)
+    {
+        snprintf(msg, msg_len, "DB Error");
+        return -1;
+    }
+    int ret = export_rows(conn->mysql, tablename, sink, msg, msg_len);
+    db_pool_release(conn);
+    return ret;
+}
+
+static int preview(MYSQL *db, const char *tablename, int cursor_id, int newer, db_preview_row_t *out,
+                   int max_rows)
+{
+    char sql[512];
+    char where[64] = "";
+
+    // 键集分页：沿主键索引定位游标后只读 max_rows 行，不再随 OFFSET 增长逐行跳过
+    if (newer)
+        snprintf(where, sizeof(where), "WHERE id > %d ORDER BY id ASC", cursor_id);
+    else if (cursor_id > 0)
+        snprintf(where, sizeof(where), "WHERE id < %d ORDER BY id DESC", cursor_id);
+    else
+        snprintf(where, sizeof(where), "ORDER BY id DESC");
+
+    // 根据表名选择正确的字段映射
+    if (strcmp(tablename, "weather") == 0) {
+        // weather 表字段：temperature, humidity, ts
+        snprintf(sql, sizeof(sql),
+                 "SELECT id, temperature AS temp, humidity AS humi, DATE_FORMAT(ts, '%%m-%%d %%H:%%i') "
+                 "FROM `%s` %s LIMIT %d",
+                 tablename, where, max_rows);
+    } else {
+        // sensor_data 及其他表（假设存在 temp, humi, ts）
+        snprintf(sql, sizeof(sql),
+                 "SELECT id, temp, humi, DATE_FORMAT(ts, '%%m-%%d %%H:%%i') "
+                 "FROM `%s` %s LIMIT %d",
+                 tablename, where, max_rows);
+    }
+
+    if (mysql_query(db, sql))
+    {
+        fprintf(stderr, "[DB] Preview query failed: %s\n", mysql_error(db));
+        return 0;
+    }
+
+    MYSQL_RES *res = mysql_store_result(db);
+    if (!res)
+        return 0;
+
+    int n = (int)mysql_num_rows(res);
+    if (n > max_rows)
+        n = max_rows;
+    int i = 0;
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(res)) && i < n)
+    {
+        // 向上翻页按 id 升序取回，倒序填入
+        db_preview_row_t *r = &out[newer ? n - 1 - i : i];
+        memset(r, 0, sizeof(*r));
+        r->id = atoi(row[0]);
+        r->temp = row[1] ? atof(row[1]) : 0;
+        r->humi = row[2] ? atof(row[2]) : 0;
+        strncpy(r->ts, row[3] ? row[3] : "", sizeof(r->ts) - 1);
+        i++;
+    }
+    mysql_free_result(res);
+    return i;
+}
+
+static int sql_preview(const char *tablename, int cursor_id, int newer, db_preview_row_t *out, int max_rows)
+{
+    db_conn_t *conn = db_acquire();
+    if (conn == NULL)
+        return 0;
+    int n = preview(conn->mysql, tablename, cursor_id, newer, out, max_rows);
+    db_pool_release(conn);
+    return n;
+}
+
+/* ========== 流式读取 ========== */
+// 结果集不在客户端缓存，逐行 fetch 后攒满一块交给回调；列布局固定为 [id,] ts, temp, humi [, desc]
+enum
+{
+    STREAM_ID = 1,   // 首列为 id
+    STREAM_DESC = 2, // 末列为天气描述
+    STREAM_RAW = 4   // 数值来自原始表 FLOAT 列
+};
+
+#define STREAM_DESC_SIZE 208 // VARCHAR(50)，utf8mb4 最多 200 字节
+
+typedef struct
+{
+    int id[DB_STREAM_CHUNK];
+    double ts[DB_STREAM_CHUNK];
+    double temp[DB_STREAM_CHUNK];
+    double humi[DB_STREAM_CHUNK];
+    const char *desc[DB_STREAM_CHUNK];
+} stream_buf_t;
+
+// 返回交付的行数，失败 -1；回调返回非 0 时提前结束并丢弃剩余行
+static int stream_stmt(MYSQL_STMT *st, int flags, db_chunk_cb cb, void *user)
+{
+    stream_buf_t *buf = malloc(sizeof(*buf));
+    char (*desc_buf)[STREAM_DESC_SIZE] = NULL;
+    if (flags & STREAM_DESC)
+        desc_buf = malloc(DB_STREAM_CHUNK * STREAM_DESC_SIZE);
+    if (!buf || ((flags & STREAM_DESC) && !desc_buf))
+    {
+        free(buf);
+        free(desc_buf);
+        mysql_stmt_free_result(st);
+        return -1;
+    }
+
+    int idv = 0;
+    long long tsv = 0;
+    double tv = 0, hv = 0;
+    char dv[STREAM_DESC_SIZE];
+    unsigned long dlen = 0;
+    my_bool dnull = 0;
+    MYSQL_BIND r[5];
+    int nc = 0;
+    if (flags & STREAM_ID)
+        bind_value(&r[nc++], MYSQL_TYPE_LONG, &idv);
+    bind_value(&r[nc++], MYSQL_TYPE_LONGLONG, &tsv);
+    bind_value(&r[nc++], MYSQL_TYPE_DOUBLE, &tv);
+    bind_value(&r[nc++], MYSQL_TYPE_DOUBLE, &hv);
+    if (flags & STREAM_DESC)
+    {
+        bind_value(&r[nc], MYSQL_TYPE_STRING, dv);
+        r[nc].buffer_length = sizeof(dv);
+        r[nc].length = &dlen;
+        r[nc].is_null = &dnull;
+    }
+
+    int total = 0;
+    if (mysql_stmt_bind_result(st, r))
+    {
+        fprintf(stderr, "[DB] Bind result failed: %s\n", mysql_stmt_error(st));
+        total = -1;
+    }
+
+    db_chunk_t chunk = {
+        .count = 0,
+        .id = (flags & STREAM_ID) ? buf->id : NULL,
+        .ts = buf->ts,
+        .temp = buf->temp,
+        .humi = buf->humi,
+        .desc = (flags & STREAM_DESC) ? buf->desc : NULL,
+    };
+    int k = 0, stopped = 0;
+    while (total >= 0 && !stopped)
+    {
+        int rc = mysql_stmt_fetch(st);
+        if (rc == MYSQL_NO_DATA)
+            break;
+        if (rc != 0 && rc != MYSQL_DATA_TRUNCATED)
+        {
+            fprintf(stderr, "[DB] Fetch failed: %s\n", mysql_stmt_error(st));
+            total = -1;
+            break;
+        }
+
+        buf->id[k] = idv;
+        buf->ts[k] = (double)tsv;
+        buf->temp[k] = (flags & STREAM_RAW) ? float_col(tv) : tv;
+        buf->humi[k] = (flags & STREAM_RAW) ? float_col(hv) : hv;
+        if (flags & STREAM_DESC)
+        {
+            if (dnull)
+            {
+                buf->desc[k] = NULL;
+            }
+            else
+            {
+                size_t len = dlen < sizeof(dv) ? dlen : sizeof(dv) - 1;
+                memcpy(desc_buf[k], dv, len);
+                desc_buf[k][len] = '\0';
+                buf->desc[k] = desc_buf[k];
+            }
+        }
+
+        if (++k == DB_STREAM_CHUNK)
+        {
+            chunk.count = k;
+            total += k;
+            k = 0;
+            stopped = cb(&chunk, user) != 0;
+        }
+    }
+    if (total >= 0 && !stopped && k > 0)
+    {
+        chunk.count = k;
+        total += k;
+        cb(&chunk, user);
+    }
+
+    mysql_stmt_free_result(st);
+    free(buf);
+    free(desc_buf);
+    return total;
+}
+
+static int stream_rows_after(int after_id, int limit, db_chunk_cb cb, void *user)
+{
+    db_conn_t *conn = db_acquire();
+    if (conn == NULL)
+        return -1;
+
+    int lim = limit > 0 ? limit : INT_MAX;
+    MYSQL_BIND p[2];
+    bind_value(&p[0], MYSQL_TYPE_LONG, &after_id);
+    bind_value(&p[1], MYSQL_TYPE_LONG, &lim);
+    MYSQL_STMT *st = stmt_exec(conn, STMT_SENSOR_ROWS_AFTER, p);
+    int n = st ? stream_stmt(st, STREAM_ID | STREAM_RAW, cb, user) : -1;
+    db_pool_release(conn);
+    return n;
+}
+
+// 按分辨率绑定范围参数：原始表用 ts 区间，汇总表用桶区间（起点对齐到所在桶）
+static MYSQL_STMT *range_exec(db_conn_t *conn, db_stmt_id_t raw_id, db_stmt_id_t rollup_id,
+                              time_t start_ts, time_t end_ts, db_resolution_t resolution)
+{
+    long long from = start_ts, to = end_ts;
+    int res = (int)resolution;
+    MYSQL_BIND p[3];
+    if (resolution == DB_RES_RAW)
+    {
+        bind_value(&p[0], MYSQL_TYPE_LONGLONG, &from);
+        bind_value(&p[1], MYSQL_TYPE_LONGLONG, &to);
+        return stmt_exec(conn, raw_id, p);
+    }
+
+    from = db_bucket_start(start_ts, resolution, db_local_gmtoff());
+    bind_value(&p[0], MYSQL_TYPE_LONG, &res);
+    bind_value(&p[1], MYSQL_TYPE_LONGLONG, &from);
+    bind_value(&p[2], MYSQL_TYPE_LONGLONG, &to);
+    return stmt_exec(conn, rollup_id, p);
+}
+
+static int sql_stream_sensor_range(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                                   db_chunk_cb cb, void *user)
+{
+    db_conn_t *conn = db_acquire();
+    if (conn == NULL)
+        return -1;
+    MYSQL_STMT *st = range_exec(conn, STMT_SENSOR_RANGE, STMT_SENSOR_ROLLUP_RANGE, start_ts, end_ts, resolution);
+    // 汇总桶均值是 DOUBLE，保持原值
+    int n = st ? stream_stmt(st, resolution == DB_RES_RAW ? STREAM_RAW : 0, cb, user) : -1;
+    db_pool_release(conn);
+    return n;
+}
+
+static int sql_stream_weather_range(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                                    db_chunk_cb cb, void *user)
+{
+    db_conn_t *conn = db_acquire();
+    if (conn == NULL)
+        return -1;
+    MYSQL_STMT *st = range_exec(conn, STMT_WEATHER_RANGE, STMT_WEATHER_ROLLUP_RANGE, start_ts, end_ts, resolution);
+    int n = st ? stream_stmt(st, STREAM_DESC | (resolution == DB_RES_RAW ? STREAM_RAW : 0), cb, user) : -1;
+    db_pool_release(conn);
+    return n;
+}
+
+static int sql_sensor_max_id(void)
+{
+    db_conn_t *conn = db_acquire();
+    if (conn == NULL)
+        return -1;
+
+    long long max_id = -1;
+    MYSQL_STMT *st = stmt_exec(conn, STMT_SENSOR_MAX_ID, NULL);
+    if (st)
+    {
+        MYSQL_BIND r[1];
+        bind_value(&r[0], MYSQL_TYPE_LONGLONG, &max_id);
+        if (stmt_store(st, r) >= 0)
+        {
+            if (!stmt_next(st))
+                max_id = 0;
+            mysql_stmt_free_result(st);
+        }
+        else
+        {
+            max_id = -1;
+        }
+    }
+    db_pool_release(conn);
+    return (int)max_id;
+}
+
+const db_backend_t db_backend_mysql = {
+    .name = "mysql",
+    .init = sql_init,
+    .close = sql_close,
+    .save_sensor_batch = sql_save_sensor_batch,
+    .save_weather_batch = sql_save_weather_batch,
+    .stream_sensor_rows_after = stream_rows_after,
+    .stream_sensor_range = sql_stream_sensor_range,
+    .stream_weather_range = sql_stream_weather_range,
+    .sensor_max_id = sql_sensor_max_id,
+    .table_list = sql_table_list,
+    .preview = sql_preview,
+    .export_rows = sql_export_rows,
+};
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "db_pool.h"
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key; // 非空表示本线程已 mysql_thread_init
+static int thread_key_ready = 0;
+static db_conn_t pool[DB_POOL_SIZE];
+
+// 线程退出时释放 libmysql 线程状态（导出、表目录刷新等分离线程用完即退出）
+static void pool_thread_end(void *arg)
+{
+    (void)arg;
+    mysql_thread_end();
+}
+
+// libmysql 的全局初始化不是线程安全的，必须在任何线程调用 mysql_init 之前完成
+static void pool_library_init(void)
+{
+    if (mysql_library_init(0, NULL, NULL))
+        fprintf(stderr, "[DB] mysql_library_init failed\n");
+    if (pthread_key_create(&thread_key, pool_thread_end) == 0)
+        thread_key_ready = 1;
+    else
+        fprintf(stderr, "[DB] pthread_key_create failed\n");
+}
+
+static void conn_close(db_conn_t *conn)
+{
+    for (int i = 0; i < DB_POOL_STMT_SLOTS; i++)
+    {
+        if (conn->stmt[i])
+        {
+            mysql_stmt_close(conn->stmt[i]);
+            conn->stmt[i] = NULL;
+        }
+    }
+    if (conn->mysql)
+    {
+        mysql_close(conn->mysql);
+        conn->mysql = NULL;
+    }
+}
+
+static int conn_open(db_conn_t *conn)
+{
+    conn->mysql = mysql_init(NULL);
+    if (conn->mysql == NULL)
+    {
+        fprintf(stderr, "[DB] mysql_init failed\n");
+        return -1;
+    }
+
+    unsigned int timeout = 3;
+    mysql_options(conn->mysql, MYSQL_OPT_CONNECT_TIMEOUT, &timeout);
+
+    if (mysql_real_connect(conn->mysql, "127.0.0.1", "admin", "19981009huan",
+                           "mydb", 3306, NULL, 0) == NULL)
+    {
+        fprintf(stderr, "[DB] Connect failed: %s\n", mysql_error(conn->mysql));
+        mysql_close(conn->mysql);
+        conn->mysql = NULL;
+        return -1;
+    }
+    conn->last_used = time(NULL);
+    return 0;
+}
+
+db_conn_t *db_pool_acquire(void)
+{
+    pthread_once(&pool_once, pool_library_init);
+
+    // 连接会在线程间流转，使用连接的线程都需要各自的 libmysql 线程状态
+    // mysql_thread_init 可重复调用，键创建失败时每次借出都调用一次
+    if (!thread_key_ready || pthread_getspecific(thread_key) == NULL)
+    {
+        mysql_thread_init();
+        if (thread_key_ready)
+            pthread_setspecific(thread_key, (void *)1);
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += DB_POOL_WAIT_MS / 1000;
+    deadline.tv_nsec += (DB_POOL_WAIT_MS % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&pool_lock);
+    db_conn_t *conn = NULL;
+    while (conn == NULL)
+    {
+        // 优先复用已连接的空闲连接
+        for (int i = 0; i < DB_POOL_SIZE; i++)
+        {
+            if (!pool[i].in_use && (conn == NULL || (pool[i].mysql && !conn->mysql)))
+                conn = &pool[i];
+        }
+        if (conn)
+            break;
+        if (pthread_cond_timedwait(&pool_cond, &pool_lock, &deadline) == ETIMEDOUT)
+        {
+            pthread_mutex_unlock(&pool_lock);
+            fprintf(stderr, "[DB] Pool exhausted, waited %d ms\n", DB_POOL_WAIT_MS);
+            return NULL;
+        }
+    }
+    conn->in_use = 1;
+    pthread_mutex_unlock(&pool_lock);
+
+    // 连接建立与健康检查在锁外进行，不阻塞其他线程借还
+    time_t now = time(NULL);
+    if (conn->mysql && now - conn->last_used >= DB_POOL_PING_IDLE && mysql_ping(conn->mysql) != 0)
+    {
+        fprintf(stderr, "[DB] Ping failed, reconnecting: %s\n", mysql_error(conn->mysql));
+        conn_close(conn);
+    }
+    if (conn->mysql == NULL && conn_open(conn) != 0)
+    {
+        db_pool_release(conn);
+        return NULL;
+    }
+    return conn;
+}
+
+void db_pool_release(db_conn_t *conn)
+{
+    if (conn == NULL)
+        return;
+    pthread_mutex_lock(&pool_lock);
+    conn->last_used = time(NULL);
+    conn->in_use = 0;
+    pthread_cond_signal(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+}
+
+int db_pool_reconnect(db_conn_t *conn)
+{
+    conn_close(conn);
+    return conn_open(conn);
+}
+
+void db_pool_close_all(void)
+{
+    pthread_mutex_lock(&pool_lock);
+    for (int i = 0; i < DB_POOL_SIZE; i++)
+    {
+        if (!pool[i].in_use && pool[i].mysql)
+            conn_close(&pool[i]);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    printf("[DB] Connection pool closed\n");
+}
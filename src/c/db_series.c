@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "db_series.h"
+
+#define SERIES_MIN_CAP 256
+#define SERIES_SPARE_MAX (8u << 20) // 备用 arena 的上限，更大的直接归还系统
+#define SERIES_DICT_MAX 65535
+
+// 备用 arena（最多一块）
+static pthread_mutex_t spare_lock = PTHREAD_MUTEX_INITIALIZER;
+static void *spare_arena = NULL;
+static size_t spare_size = 0;
+
+static size_t col_bytes(size_t elem, int cap)
+{
+    return (elem * (size_t)cap + SERIES_ALIGN - 1) & ~(size_t)(SERIES_ALIGN - 1);
+}
+
+static size_t arena_bytes(unsigned cols, int cap)
+{
+    size_t n = 3 * col_bytes(sizeof(double), cap);
+    if (cols & SERIES_COL_ID)
+        n += col_bytes(sizeof(int), cap);
+    if (cols & SERIES_COL_DESC)
+        n += col_bytes(sizeof(uint16_t), cap);
+    return n;
+}
+
+static void *arena_get(size_t size, size_t *got)
+{
+    pthread_mutex_lock(&spare_lock);
+    void *p = NULL;
+    if (spare_arena && spare_size >= size)
+    {
+        p = spare_arena;
+        *got = spare_size;
+        spare_arena = NULL;
+        spare_size = 0;
+    }
+    pthread_mutex_unlock(&spare_lock);
+    if (p)
+        return p;
+
+    if (posix_memalign(&p, SERIES_ALIGN, size) != 0)
+        return NULL;
+    *got = size;
+    return p;
+}
+
+static void arena_put(void *p, size_t size)
+{
+    if (!p)
+        return;
+    pthread_mutex_lock(&spare_lock);
+    if (size <= SERIES_SPARE_MAX && size > spare_size)
+    {
+        void *old = spare_arena;
+        spare_arena = p;
+        spare_size = size;
+        p = old;
+    }
+    pthread_mutex_unlock(&spare_lock);
+    free(p);
+}
+
+series_t *series_new(unsigned cols, int cap)
+{
+    series_t *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    s->refs = 1;
+    s->cols = cols;
+    if (series_reserve(s, cap > 0 ? cap : SERIES_MIN_CAP) != 0 ||
+        ((cols & SERIES_COL_DESC) && series_intern(s, NULL) < 0))
+    {
+        series_release(s);
+        return NULL;
+    }
+    return s;
+}
+
+int series_reserve(series_t *s, int cap)
+{
+    if (cap <= s->cap)
+        return 0;
+    if (s->cap > 0 && cap < s->cap * 2)
+        cap = s->cap * 2;
+
+    size_t size;
+    char *p = arena_get(arena_bytes(s->cols, cap), &size);
+    if (!p)
+        return -1;
+
+    // 依次切出各列，旧数据按列搬过去
+    series_t n = *s;
+    n.ts = (double *)p;
+    p += col_bytes(sizeof(double), cap);
+    n.temp = (double *)p;
+    p += col_bytes(sizeof(double), cap);
+    n.humi = (double *)p;
+    p += col_bytes(sizeof(double), cap);
+    if (s->cols & SERIES_COL_ID)
+    {
+        n.id = (int *)p;
+        p += col_bytes(sizeof(int), cap);
+    }
+    if (s->cols & SERIES_COL_DESC)
+        n.desc = (uint16_t *)p;
+
+    if (s->count > 0)
+    {
+        memcpy(n.ts, s->ts, s->count * sizeof(double));
+        memcpy(n.temp, s->temp, s->count * sizeof(double));
+        memcpy(n.humi, s->humi, s->count * sizeof(double));
+        if (n.id)
+            memcpy(n.id, s->id, s->count * sizeof(int));
+        if (n.desc)
+            memcpy(n.desc, s->desc, s->count * sizeof(uint16_t));
+    }
+    arena_put(s->arena, s->arena_size);
+
+    s->ts = n.ts;
+    s->temp = n.temp;
+    s->humi = n.humi;
+    s->id = n.id;
+    s->desc = n.desc;
+    s->arena = n.ts;
+    s->arena_size = size;
+    s->cap = cap;
+    return 0;
+}
+
+// 描述种类很少（天气类型数十种），线性查找并优先比较上一次命中
+int series_intern(series_t *s, const char *str)
+{
+    if (str == NULL && s->dict_count > 0)
+        return SERIES_DESC_NONE;
+
+    if (str && s->dict_last > 0 && strcmp(s->dict_buf[s->dict_last], str) == 0)
+        return s->dict_last;
+    for (int i = 1; str && i < s->dict_count; i++)
+    {
+        if (strcmp(s->dict_buf[i], str) == 0)
+            return s->dict_last = i;
+    }
+
+    if (s->dict_count >= SERIES_DICT_MAX)
+        return -1;
+    if (s->dict_count == s->dict_cap)
+    {
+        int cap = s->dict_cap ? s->dict_cap * 2 : 16;
+        char **buf = realloc(s->dict_buf, cap * sizeof(char *));
+        if (!buf)
+            return -1;
+        s->dict_buf = buf;
+        s->dict_cap = cap;
+        s->dict = (const char *const *)buf;
+    }
+    char *copy = NULL;
+    if (str && !(copy = strdup(str)))
+        return -1;
+    s->dict_buf[s->dict_count] = copy;
+    return s->dict_last = s->dict_count++;
+}
+
+series_t *series_retain(series_t *s)
+{
+    if (s)
+        __atomic_add_fetch(&s->refs, 1, __ATOMIC_RELAXED);
+    return s;
+}
+
+void series_release(series_t *s)
+{
+    if (!s || __atomic_sub_fetch(&s->refs, 1, __ATOMIC_ACQ_REL) != 0)
+        return;
+    for (int i = 0; i < s->dict_count; i++)
+        free(s->dict_buf[i]);
+    free(s->dict_buf);
+    arena_put(s->arena, s->arena_size);
+    free(s);
+}
+
+int series_asof_join(const series_t *left, const series_t *right, double tolerance, series_asof_t mode,
+                     series_t **left_out, series_t **right_out)
+{
+    series_t *l = series_new(0, left->count);
+    series_t *r = series_new(0, left->count);
+    if (!l || !r)
+    {
+        series_release(l);
+        series_release(r);
+        return -1;
+    }
+
+    // j 指向 right 中最后一个 ts <= t 的行（-1 表示没有），随 t 单调前移
+    int n = 0, j = -1;
+    for (int i = 0; i < left->count; i++)
+    {
+        double t = left->ts[i];
+        while (j + 1 < right->count && right->ts[j + 1] <= t)
+            j++;
+
+        int prev = j >= 0 && t - right->ts[j] <= tolerance ? j : -1;
+        int next = mode != SERIES_ASOF_PREV && j + 1 < right->count && right->ts[j + 1] - t <= tolerance ? j + 1 : -1;
+        if (prev < 0 && next < 0)
+            continue;
+
+        double rt, rh;
+        if (mode == SERIES_ASOF_LINEAR && prev >= 0 && next >= 0)
+        {
+            double w = (t - right->ts[prev]) / (right->ts[next] - right->ts[prev]);
+            rt = right->temp[prev] + (right->temp[next] - right->temp[prev]) * w;
+            rh = right->humi[prev] + (right->humi[next] - right->humi[prev]) * w;
+        }
+        else
+        {
+            int k = prev;
+            if (k < 0 || (next >= 0 && right->ts[next] - t < t - right->ts[prev]))
+                k = next;
+            rt = right->temp[k];
+            rh = right->humi[k];
+        }
+
+        l->ts[n] = r->ts[n] = t;
+        l->temp[n] = left->temp[i];
+        l->humi[n] = left->humi[i];
+        r->temp[n] = rt;
+        r->humi[n] = rh;
+        n++;
+    }
+    l->count = r->count = n;
+    *left_out = l;
+    *right_out = r;
+    return n;
+}
@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include "db_spool.h"
+
+#define SPOOL_MAGIC 0x314c5053 // "SPL1"
+#define SPOOL_MAX_PAYLOAD 128  // ts + 温湿度 + 两个带长度前缀的字符串
+#define SPOOL_MAX_PATHS 4
+#define SPOOL_PROGRESS_MAGIC 0x314c5052 // "RPL1"
+
+// 每条记录：帧头 + 变长负载，crc 覆盖负载
+typedef struct
+{
+    uint32_t magic;
+    uint32_t len;
+    uint32_t crc;
+} spool_frame_t;
+
+// .replay 的补写进度：已提交的排序后前 sent 行；size/count 与文件不符时作废
+typedef struct
+{
+    uint32_t magic;
+    int32_t count;
+    int64_t size;
+    int32_t sent;
+    uint32_t crc; // 覆盖以上字段
+} spool_progress_t;
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_table_init(void)
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+uint32_t db_spool_crc32(const void *data, size_t n)
+{
+    pthread_once(&crc_once, crc_table_init);
+    const uint8_t *p = data;
+    uint32_t c = 0xFFFFFFFFu;
+    while (n--)
+        c = crc_table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+static uint32_t encode_str(uint8_t *out, const char *s, size_t max)
+{
+    size_t n = strnlen(s, max - 1);
+    out[0] = (uint8_t)n;
+    memcpy(out + 1, s, n);
+    return (uint32_t)n + 1;
+}
+
+// 负载：ts(8) temp(4) humi(4) location desc
+static uint32_t encode_row(const db_row_t *row, uint8_t *out)
+{
+    int64_t ts = row->ts;
+    uint32_t len = 0;
+    memcpy(out + len, &ts, sizeof(ts));
+    len += sizeof(ts);
+    memcpy(out + len, &row->temp, sizeof(row->temp));
+    len += sizeof(row->temp);
+    memcpy(out + len, &row->humi, sizeof(row->humi));
+    len += sizeof(row->humi);
+    len += encode_str(out + len, row->location, sizeof(row->location));
+    len += encode_str(out + len, row->desc, sizeof(row->desc));
+    return len;
+}
+
+static int decode_str(const uint8_t *p, uint32_t left, char *out, size_t max, uint32_t *used)
+{
+    if (left < 1 || p[0] >= max || (uint32_t)p[0] + 1 > left)
+        return -1;
+    memcpy(out, p + 1, p[0]);
+    out[p[0]] = '\0';
+    *used = (uint32_t)p[0] + 1;
+    return 0;
+}
+
+static int decode_row(const uint8_t *p, uint32_t len, db_row_t *row)
+{
+    const uint32_t fixed = sizeof(int64_t) + 2 * sizeof(float);
+    if (len < fixed)
+        return -1;
+    int64_t ts;
+    memset(row, 0, sizeof(*row));
+    memcpy(&ts, p, sizeof(ts));
+    memcpy(&row->temp, p + sizeof(ts), sizeof(float));
+    memcpy(&row->humi, p + sizeof(ts) + sizeof(float), sizeof(float));
+    row->ts = (time_t)ts;
+
+    uint32_t off = fixed, used;
+    if (decode_str(p + off, len - off, row->location, sizeof(row->location), &used) != 0)
+        return -1;
+    off += used;
+    if (decode_str(p + off, len - off, row->desc, sizeof(row->desc), &used) != 0)
+        return -1;
+    return off + used == len ? 0 : -1;
+}
+
+// 读取全部完整记录（rows_out 为 NULL 时只扫描）；valid_end 为最后一条完整记录的结束偏移
+// 遇到截断或校验失败的记录即停止，视为断电留下的尾部
+static int load_rows(const char *path, db_row_t **rows_out, int *count, long *valid_end)
+{
+    *count = 0;
+    if (rows_out)
+        *rows_out = NULL;
+    if (valid_end)
+        *valid_end = 0;
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return -1;
+
+    db_row_t *rows = NULL;
+    int cap = 0, n = 0;
+    long end = 0;
+    spool_frame_t frame;
+    uint8_t payload[SPOOL_MAX_PAYLOAD];
+    while (fread(&frame, sizeof(frame), 1, fp) == 1)
+    {
+        db_row_t row;
+        if (frame.magic != SPOOL_MAGIC || frame.len > SPOOL_MAX_PAYLOAD ||
+            fread(payload, 1, frame.len, fp) != frame.len ||
+            db_spool_crc32(payload, frame.len) != frame.crc ||
+            decode_row(payload, frame.len, &row) != 0)
+            break;
+
+        if (rows_out)
+        {
+            if (n == cap)
+            {
+                int new_cap = cap ? cap * 2 : 256;
+                db_row_t *tmp = realloc(rows, new_cap * sizeof(db_row_t));
+                if (!tmp)
+                {
+                    free(rows);
+                    fclose(fp);
+                    return -1;
+                }
+                rows = tmp;
+                cap = new_cap;
+            }
+            rows[n] = row;
+        }
+        n++;
+        end = ftell(fp);
+    }
+    fclose(fp);
+
+    *count = n;
+    if (rows_out)
+        *rows_out = rows;
+    if (valid_end)
+        *valid_end = end;
+    return 0;
+}
+
+// 进程内首次追加某文件前截掉上次断电留下的半条记录，否则新记录会接在坏数据之后无法读出
+static void repair_tail(const char *path, int fd)
+{
+    static pthread_mutex_t checked_lock = PTHREAD_MUTEX_INITIALIZER;
+    static char checked[SPOOL_MAX_PATHS][128];
+    static int checked_count = 0;
+    pthread_mutex_lock(&checked_lock);
+    for (int i = 0; i < checked_count; i++)
+    {
+        if (strcmp(checked[i], path) == 0)
+        {
+            pthread_mutex_unlock(&checked_lock);
+            return;
+        }
+    }
+
+    struct stat st;
+    int count;
+    long end;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && load_rows(path, NULL, &count, &end) == 0 && end < st.st_size)
+    {
+        fprintf(stderr, "[SPOOL] %s: dropped %ld bytes of torn tail\n", path, (long)st.st_size - end);
+        if (ftruncate(fd, end) != 0)
+        {
+            pthread_mutex_unlock(&checked_lock);
+            return;
+        }
+    }
+    if (checked_count < SPOOL_MAX_PATHS)
+        snprintf(checked[checked_count++], sizeof(checked[0]), "%s", path);
+    pthread_mutex_unlock(&checked_lock);
+}
+
+// 新建文件后同步目录项，否则断电后文件本身可能不存在
+static void sync_dir(const char *path)
+{
+    char dir[128];
+    snprintf(dir, sizeof(dir), "%s", path);
+    int fd = open(dirname(dir), O_RDONLY);
+    if (fd < 0)
+        return;
+    fsync(fd);
+    close(fd);
+}
+
+int db_spool_append(const char *path, const db_row_t *rows, int n)
+{
+    if (n <= 0)
+        return 0;
+    uint8_t *buf = malloc((size_t)n * (sizeof(spool_frame_t) + SPOOL_MAX_PAYLOAD));
+    if (!buf)
+        return -1;
+
+    // 整批编码后一次 write + 一次 fsync
+    size_t len = 0;
+    for (int i = 0; i < n; i++)
+    {
+        spool_frame_t frame = {SPOOL_MAGIC, 0, 0};
+        uint8_t *payload = buf + len + sizeof(frame);
+        frame.len = encode_row(&rows[i], payload);
+        frame.crc = db_spool_crc32(payload, frame.len);
+        memcpy(buf + len, &frame, sizeof(frame));
+        len += sizeof(frame) + frame.len;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "[SPOOL] Cannot open %s\n", path);
+        free(buf);
+        return -1;
+    }
+    repair_tail(path, fd);
+
+    struct stat st;
+    int ok = fstat(fd, &st) == 0;
+    ssize_t written = ok ? write(fd, buf, len) : -1;
+    ok = ok && written == (ssize_t)len && fsync(fd) == 0;
+    if (!ok && written > 0)
+    {
+        // 写了一半（如磁盘满）：退回到写入前，保持文件只含完整记录
+        if (ftruncate(fd, st.st_size) != 0)
+            fprintf(stderr, "[SPOOL] %s: failed to roll back partial write\n", path);
+    }
+    close(fd);
+    free(buf);
+
+    if (!ok)
+    {
+        fprintf(stderr, "[SPOOL] Write %d rows to %s failed\n", n, path);
+        return -1;
+    }
+    if (st.st_size == 0)
+        sync_dir(path);
+    return 0;
+}
+
+int db_spool_load(const char *path, db_row_t **rows, int *count)
+{
+    if (load_rows(path, rows, count, NULL) == 0)
+        return 0;
+    // 文件不存在视为空
+    *rows = NULL;
+    *count = 0;
+    return access(path, F_OK) == 0 ? -1 : 0;
+}
+
+static void replay_path(const char *path, char *out, size_t len)
+{
+    snprintf(out, len, "%s.replay", path);
+}
+
+int db_spool_pending(const char *path)
+{
+    char rpath[160];
+    replay_path(path, rpath, sizeof(rpath));
+    return access(path, F_OK) == 0 || access(rpath, F_OK) == 0;
+}
+
+// 按时间戳排序；同一时间戳按内容排，保证每次排序结果相同，进度里的行数才能对上
+static int cmp_ts(const void *a, const void *b)
+{
+    time_t ta = ((const db_row_t *)a)->ts, tb = ((const db_row_t *)b)->ts;
+    if (ta != tb)
+        return (ta > tb) - (ta < tb);
+    return memcmp(a, b, sizeof(db_row_t)); // decode_row 已清零填充字节
+}
+
+static void progress_path(const char *rpath, char *out, size_t len)
+{
+    snprintf(out, len, "%s.done", rpath);
+}
+
+// 读取 .replay 已提交的行数；进度不存在或与文件不符返回 0
+static int progress_load(const char *rpath, int64_t size, int count)
+{
+    char ppath[192];
+    progress_path(rpath, ppath, sizeof(ppath));
+    FILE *fp = fopen(ppath, "rb");
+    if (!fp)
+        return 0;
+    spool_progress_t pg;
+    int ok = fread(&pg, sizeof(pg), 1, fp) == 1;
+    fclose(fp);
+    if (!ok || pg.magic != SPOOL_PROGRESS_MAGIC || pg.crc != db_spool_crc32(&pg, offsetof(spool_progress_t, crc)) ||
+        pg.size != size || pg.count != count || pg.sent < 0 || pg.sent > count)
+        return 0;
+    return pg.sent;
+}
+
+// 原子写入进度（临时文件 + fsync + rename + 目录 fsync）；返回 0 成功
+static int progress_save(const char *rpath, int64_t size, int count, int sent)
+{
+    char ppath[192], tmp[200];
+    progress_path(rpath, ppath, sizeof(ppath));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", ppath);
+
+    spool_progress_t pg;
+    memset(&pg, 0, sizeof(pg));
+    pg.magic = SPOOL_PROGRESS_MAGIC;
+    pg.count = count;
+    pg.size = size;
+    pg.sent = sent;
+    pg.crc = db_spool_crc32(&pg, offsetof(spool_progress_t, crc));
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    int ok = write(fd, &pg, sizeof(pg)) == (ssize_t)sizeof(pg) && fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp, ppath) != 0)
+    {
+        unlink(tmp);
+        return -1;
+    }
+    sync_dir(ppath);
+    return 0;
+}
+
+static void progress_clear(const char *rpath)
+{
+    char ppath[192];
+    progress_path(rpath, ppath, sizeof(ppath));
+    unlink(ppath);
+}
+
+int db_spool_replay(const char *path, int (*save)(const db_row_t *rows, int n))
+{
+    char rpath[160], tmp_path[176];
+    replay_path(path, rpath, sizeof(rpath));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", rpath);
+
+    int total = 0;
+    // 先处理上次未补完的 .replay，再把当前日志整体改名后补写（改名后的追加进入新文件）
+    for (int pass = 0; pass < 2; pass++)
+    {
+        if (access(rpath, F_OK) != 0)
+        {
+            if (access(path, F_OK) != 0)
+                break;
+            progress_clear(rpath); // 没有 .replay 时残留的进度属于已删除的旧文件
+            if (rename(path, rpath) != 0)
+                return -1;
+        }
+
+        struct stat st;
+        db_row_t *rows;
+        int count;
+        if (stat(rpath, &st) != 0 || load_rows(rpath, &rows, &count, NULL) != 0)
+            return -1;
+        qsort(rows, count, sizeof(db_row_t), cmp_ts);
+
+        // 跳过上次已提交、但未能从文件中去掉的行
+        int done = progress_load(rpath, (int64_t)st.st_size, count);
+        if (done > 0)
+            printf("[SPOOL] %s: skipping %d rows committed by an earlier replay\n", rpath, done);
+        int sent = done;
+        while (sent < count)
+        {
+            int n = count - sent < DB_SPOOL_REPLAY_BATCH ? count - sent : DB_SPOOL_REPLAY_BATCH;
+            if (save(rows + sent, n) != 0)
+                break;
+            sent += n;
+        }
+
+        if (sent < count)
+        {
+            // 1. 先落盘进度：之后去掉已提交行的步骤失败（如磁盘满）时，下次仍能跳过它们
+            // 2. 再把剩余部分原子替换进 .replay，成功后进度作废
+            if (sent > done)
+            {
+                if (progress_save(rpath, (int64_t)st.st_size, count, sent) != 0)
+                    fprintf(stderr, "[SPOOL] %s: cannot record replay progress\n", rpath);
+                unlink(tmp_path);
+                if (db_spool_append(tmp_path, rows + sent, count - sent) != 0)
+                {
+                    fprintf(stderr, "[SPOOL] %s: cannot compact, resuming from progress\n", rpath);
+                    unlink(tmp_path);
+                }
+                else if (rename(tmp_path, rpath) != 0)
+                {
+                    fprintf(stderr, "[SPOOL] Rename %s failed, resuming from progress\n", tmp_path);
+                    unlink(tmp_path);
+                }
+                else
+                {
+                    sync_dir(rpath);
+                    progress_clear(rpath);
+                }
+            }
+            fprintf(stderr, "[SPOOL] Replay %s stopped at %d/%d rows\n", rpath, sent, count);
+            free(rows);
+            return -1;
+        }
+        free(rows);
+        // 先删 .replay 再删进度：中途断电留下的进度在下一轮改名前被清掉
+        if (unlink(rpath) != 0)
+        {
+            progress_save(rpath, (int64_t)st.st_size, count, count);
+            return -1;
+        }
+        progress_clear(rpath);
+        total += count;
+        printf("[SPOOL] Replayed %d rows from %s\n", count, path);
+    }
+    return total;
+}
@@ -0,0 +1,1120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "db_backend.h"
+#include "db_spool.h"
+#include "db_tsdb.h"
+
+#define TSDB_MAGIC 0x31425354       // "TSB1"
+#define TSDB_BLOCK_MAGIC 0x4b4c4254 // "TBLK"
+#define TSDB_VERSION 1
+#define TSDB_HEADER_BYTES 4096
+#define TSDB_NO_DICT 0xFF // 字典已满，读出为空
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t weather;
+    uint32_t block_count;
+    uint64_t data_end;    // 已提交数据的结束偏移
+    uint64_t sealed_rows; // 已封块行数，即最后一块末行的 id
+    uint32_t tail_gen;    // 当前尾部日志的代号
+    uint32_t desc_count;
+    uint32_t loc_count;
+    uint32_t reserved;
+    char desc_dict[DB_TSDB_DICT_DESC][32];
+    char loc_dict[DB_TSDB_DICT_LOC][64];
+} tsdb_header_t;
+
+_Static_assert(sizeof(tsdb_header_t) <= TSDB_HEADER_BYTES, "tsdb header exceeds reserved page");
+
+// 块头之后依次为 ts、temp、humi 三段位流，天气序列再跟 desc、location 字典下标各 count 字节
+typedef struct
+{
+    uint32_t magic;
+    uint32_t bytes; // 含块头，按 8 字节对齐
+    uint32_t count;
+    uint32_t crc;   // 覆盖块头之后的全部字节
+    int64_t t_min;
+    int64_t t_max;
+    uint32_t first_id;
+    uint32_t ts_bytes;
+    uint32_t temp_bytes;
+    uint32_t humi_bytes;
+} tsdb_block_t;
+
+typedef struct
+{
+    uint64_t offset;
+    int64_t t_min, t_max;
+    uint32_t first_id, count;
+} tsdb_index_t;
+
+typedef struct
+{
+    const char *name; // 与 MySQL 表名一致，表列表/预览/导出沿用
+    const char *desc;
+    int weather;
+    int fd;
+    uint8_t *map;
+    size_t map_len;
+    tsdb_index_t *index; // 块索引，first_id 递增
+    int index_n, index_cap;
+    db_row_t *tail; // 未封块的行（同时在尾部日志中）
+    int tail_n, tail_cap;
+    pthread_rwlock_t lock; // 读者只在解码单个块时持有，回调在锁外执行
+} tsdb_series_t;
+
+static tsdb_series_t series[] = {
+    {.name = "sensor_data", .desc = "Sensor Data", .weather = 0, .fd = -1, .lock = PTHREAD_RWLOCK_INITIALIZER},
+    {.name = "weather", .desc = "weather", .weather = 1, .fd = -1, .lock = PTHREAD_RWLOCK_INITIALIZER},
+};
+#define SERIES_COUNT ((int)(sizeof(series) / sizeof(series[0])))
+#define SENSOR (&series[0])
+#define WEATHER (&series[1])
+
+static pthread_mutex_t open_lock = PTHREAD_MUTEX_INITIALIZER;
+static int tsdb_ready = 0;
+
+static tsdb_header_t *hdr(tsdb_series_t *s)
+{
+    return (tsdb_header_t *)s->map;
+}
+
+// 与 MySQL 后端一致，数值固定 0.1 精度
+static double round1(double v)
+{
+    return round(v * 10) / 10.0;
+}
+
+/* ========== 位流 ========== */
+typedef struct
+{
+    uint8_t *buf; // 需预先清零
+    size_t bits;
+} bit_writer_t;
+
+typedef struct
+{
+    const uint8_t *buf;
+    size_t len_bits;
+    size_t pos;
+} bit_reader_t;
+
+static void bits_put(bit_writer_t *w, uint64_t v, int n)
+{
+    for (int i = n - 1; i >= 0; i--)
+    {
+        if ((v >> i) & 1)
+            w->buf[w->bits >> 3] |= 0x80 >> (w->bits & 7);
+        w->bits++;
+    }
+}
+
+// 越界读出 0，损坏的块只会解出错误数值而不会越界访问
+static uint64_t bits_get(bit_reader_t *r, int n)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int bit = 0;
+        if (r->pos < r->len_bits)
+            bit = (r->buf[r->pos >> 3] >> (7 - (r->pos & 7))) & 1;
+        r->pos++;
+        v = (v << 1) | bit;
+    }
+    return v;
+}
+
+/* ========== 列编码 ========== */
+// ts：首值 64 位，之后为 delta-of-delta：0 | 10+7位 | 110+9位 | 1110+12位 | 1111+64位
+// 固定采样间隔下每行只占 1 位
+static void encode_ts(bit_writer_t *w, const db_row_t *rows, int n)
+{
+    int64_t prev = rows[0].ts, prev_delta = 0;
+    bits_put(w, (uint64_t)prev, 64);
+    for (int i = 1; i < n; i++)
+    {
+        int64_t delta = (int64_t)rows[i].ts - prev;
+        int64_t dod = delta - prev_delta;
+        if (dod == 0)
+        {
+            bits_put(w, 0, 1);
+        }
+        else if (dod >= -63 && dod <= 64)
+        {
+            bits_put(w, 0x2, 2);
+            bits_put(w, (uint64_t)(dod + 63), 7);
+        }
+        else if (dod >= -255 && dod <= 256)
+        {
+            bits_put(w, 0x6, 3);
+            bits_put(w, (uint64_t)(dod + 255), 9);
+        }
+        else if (dod >= -2047 && dod <= 2048)
+        {
+            bits_put(w, 0xE, 4);
+            bits_put(w, (uint64_t)(dod + 2047), 12);
+        }
+        else
+        {
+            bits_put(w, 0xF, 4);
+            bits_put(w, (uint64_t)dod, 64);
+        }
+        prev = rows[i].ts;
+        prev_delta = delta;
+    }
+}
+
+static void decode_ts(bit_reader_t *r, int n, double *out)
+{
+    int64_t prev = (int64_t)bits_get(r, 64), delta = 0;
+    out[0] = (double)prev;
+    for (int i = 1; i < n; i++)
+    {
+        int64_t dod;
+        if (!bits_get(r, 1))
+            dod = 0;
+        else if (!bits_get(r, 1))
+            dod = (int64_t)bits_get(r, 7) - 63;
+        else if (!bits_get(r, 1))
+            dod = (int64_t)bits_get(r, 9) - 255;
+        else if (!bits_get(r, 1))
+            dod = (int64_t)bits_get(r, 12) - 2047;
+        else
+            dod = (int64_t)bits_get(r, 64);
+        delta += dod;
+        prev += delta;
+        out[i] = (double)prev;
+    }
+}
+
+static uint32_t float_bits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static float bits_float(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// 数值：首值 32 位，之后与前值 XOR：0 相同 | 10+沿用上次有效位窗口 | 11+5位前导零+5位长度+有效位
+// 温湿度变化缓慢，XOR 结果集中在少数位
+static void encode_xor(bit_writer_t *w, const float *v, int n)
+{
+    uint32_t prev = float_bits(v[0]);
+    int lead = -1, trail = 0;
+    bits_put(w, prev, 32);
+    for (int i = 1; i < n; i++)
+    {
+        uint32_t cur = float_bits(v[i]);
+        uint32_t x = cur ^ prev;
+        prev = cur;
+        if (x == 0)
+        {
+            bits_put(w, 0, 1);
+            continue;
+        }
+        int l = __builtin_clz(x), t = __builtin_ctz(x);
+        if (lead >= 0 && l >= lead && t >= trail)
+        {
+            bits_put(w, 0x2, 2);
+            bits_put(w, x >> trail, 32 - lead - trail);
+        }
+        else
+        {
+            int len = 32 - l - t;
+            bits_put(w, 0x3, 2);
+            bits_put(w, (uint64_t)l, 5);
+            bits_put(w, (uint64_t)(len - 1), 5);
+            bits_put(w, x >> t, len);
+            lead = l;
+            trail = t;
+        }
+    }
+}
+
+static void decode_xor(bit_reader_t *r, int n, double *out)
+{
+    uint32_t prev = (uint32_t)bits_get(r, 32);
+    int lead = 0, trail = 0;
+    out[0] = round1(bits_float(prev));
+    for (int i = 1; i < n; i++)
+    {
+        if (bits_get(r, 1))
+        {
+            if (bits_get(r, 1))
+            {
+                lead = (int)bits_get(r, 5);
+                trail = 32 - lead - ((int)bits_get(r, 5) + 1);
+                if (trail < 0)
+                    trail = 0;
+            }
+            prev ^= (uint32_t)(bits_get(r, 32 - lead - trail) << trail);
+        }
+        out[i] = round1(bits_float(prev));
+    }
+}
+
+// 需持有写锁；新字符串写入文件头，随下一次文件头提交落盘
+static uint8_t dict_index(char *dict, int width, int max, uint32_t *count, const char *str)
+{
+    for (uint32_t i = 0; i < *count; i++)
+    {
+        if (strncmp(dict + i * width, str, width - 1) == 0)
+            return (uint8_t)i;
+    }
+    if ((int)*count >= max)
+        return TSDB_NO_DICT;
+    snprintf(dict + *count * width, width, "%s", str);
+    return (uint8_t)(*count)++;
+}
+
+// 编码 n 行为一个完整块（含块头），返回 malloc 的缓冲区
+static uint8_t *encode_block(tsdb_series_t *s, const db_row_t *rows, int n, uint32_t first_id, uint32_t *bytes_out)
+{
+    size_t ts_cap = (size_t)n * 9 + 8, val_cap = (size_t)n * 6 + 4;
+    size_t cap = sizeof(tsdb_block_t) + ts_cap + 2 * val_cap + 2 * (size_t)n + 8;
+    uint8_t *buf = calloc(1, cap);
+    float *vals = malloc(n * sizeof(float));
+    if (!buf || !vals)
+    {
+        free(buf);
+        free(vals);
+        return NULL;
+    }
+
+    tsdb_block_t *b = (tsdb_block_t *)buf;
+    uint8_t *p = buf + sizeof(*b);
+    b->t_min = b->t_max = rows[0].ts;
+    for (int i = 1; i < n; i++)
+    {
+        if (rows[i].ts < b->t_min)
+            b->t_min = rows[i].ts;
+        if (rows[i].ts > b->t_max)
+            b->t_max = rows[i].ts;
+    }
+
+    bit_writer_t w = {p, 0};
+    encode_ts(&w, rows, n);
+    b->ts_bytes = (uint32_t)((w.bits + 7) / 8);
+    p += b->ts_bytes;
+
+    for (int i = 0; i < n; i++)
+        vals[i] = (float)round1(rows[i].temp);
+    w = (bit_writer_t){p, 0};
+    encode_xor(&w, vals, n);
+    b->temp_bytes = (uint32_t)((w.bits + 7) / 8);
+    p += b->temp_bytes;
+
+    for (int i = 0; i < n; i++)
+        vals[i] = (float)round1(rows[i].humi);
+    w = (bit_writer_t){p, 0};
+    encode_xor(&w, vals, n);
+    b->humi_bytes = (uint32_t)((w.bits + 7) / 8);
+    p += b->humi_bytes;
+    free(vals);
+
+    if (s->weather)
+    {
+        tsdb_header_t *h = hdr(s);
+        for (int i = 0; i < n; i++)
+            *p++ = dict_index(&h->desc_dict[0][0], sizeof(h->desc_dict[0]), DB_TSDB_DICT_DESC, &h->desc_count,
+                              rows[i].desc);
+        for (int i = 0; i < n; i++)
+            *p++ = dict_index(&h->loc_dict[0][0], sizeof(h->loc_dict[0]), DB_TSDB_DICT_LOC, &h->loc_count,
+                              rows[i].location);
+    }
+
+    b->magic = TSDB_BLOCK_MAGIC;
+    b->count = (uint32_t)n;
+    b->first_id = first_id;
+    b->bytes = (uint32_t)(((p - buf) + 7) & ~(size_t)7);
+    b->crc = db_spool_crc32(buf + sizeof(*b), b->bytes - sizeof(*b));
+    *bytes_out = b->bytes;
+    return buf;
+}
+
+/* ========== 解码段 ========== */
+// 一次读取的单位：一个块，或尾部最多 DB_TSDB_BLOCK_ROWS 行
+typedef struct
+{
+    int start, n; // 有效行为 [start, n)
+    int id[DB_TSDB_BLOCK_ROWS];
+    double ts[DB_TSDB_BLOCK_ROWS];
+    double temp[DB_TSDB_BLOCK_ROWS];
+    double humi[DB_TSDB_BLOCK_ROWS];
+    char desc[DB_TSDB_BLOCK_ROWS][32];
+    char loc[DB_TSDB_BLOCK_ROWS][64];
+} tsdb_seg_t;
+
+// 直接在映射区上解码，无需先拷出块
+static int decode_block(tsdb_series_t *s, const tsdb_block_t *b, tsdb_seg_t *seg)
+{
+    int n = (int)b->count;
+    if (n > DB_TSDB_BLOCK_ROWS)
+        n = DB_TSDB_BLOCK_ROWS;
+    const uint8_t *p = (const uint8_t *)(b + 1);
+
+    bit_reader_t r = {p, (size_t)b->ts_bytes * 8, 0};
+    decode_ts(&r, n, seg->ts);
+    p += b->ts_bytes;
+    r = (bit_reader_t){p, (size_t)b->temp_bytes * 8, 0};
+    decode_xor(&r, n, seg->temp);
+    p += b->temp_bytes;
+    r = (bit_reader_t){p, (size_t)b->humi_bytes * 8, 0};
+    decode_xor(&r, n, seg->humi);
+    p += b->humi_bytes;
+
+    const tsdb_header_t *h = hdr(s);
+    for (int i = 0; i < n; i++)
+    {
+        seg->id[i] = (int)(b->first_id + i);
+        seg->desc[i][0] = seg->loc[i][0] = '\0';
+        if (!s->weather)
+            continue;
+        uint8_t d = p[i], l = p[b->count + i];
+        if (d < h->desc_count)
+            memcpy(seg->desc[i], h->desc_dict[d], sizeof(seg->desc[i]));
+        if (l < h->loc_count)
+            memcpy(seg->loc[i], h->loc_dict[l], sizeof(seg->loc[i]));
+    }
+    seg->n = n;
+    return n;
+}
+
+// 最后一个 first_id <= id 的块
+static int find_block(const tsdb_series_t *s, uint32_t id)
+{
+    int lo = 0, hi = s->index_n - 1, found = -1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (s->index[mid].first_id <= id)
+        {
+            found = mid;
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    if (found >= 0 && id >= s->index[found].first_id + s->index[found].count)
+        return -1;
+    return found;
+}
+
+// 读取 id >= *next_id 的下一段，时间范围与 [from, to] 不相交的块直接跳过；返回段行数，0 表示读完
+// 以 id 作游标，读取过程中封块不会造成重复或遗漏
+static int read_segment(tsdb_series_t *s, uint32_t *next_id, int64_t from, int64_t to, tsdb_seg_t *seg)
+{
+    int n = 0;
+    pthread_rwlock_rdlock(&s->lock);
+    while (n == 0 && s->map)
+    {
+        int i = find_block(s, *next_id);
+        if (i >= 0)
+        {
+            const tsdb_index_t *ix = &s->index[i];
+            uint32_t start = *next_id - ix->first_id;
+            *next_id = ix->first_id + ix->count;
+            if (ix->t_max < from || ix->t_min > to)
+                continue;
+            n = decode_block(s, (const tsdb_block_t *)(s->map + ix->offset), seg);
+            seg->start = (int)start;
+            continue;
+        }
+
+        uint64_t sealed = hdr(s)->sealed_rows;
+        if (*next_id <= sealed)
+        {
+            // 块索引与文件头不一致（打开时截断过），跳到尾部
+            *next_id = (uint32_t)sealed + 1;
+        }
+        int first = (int)(*next_id - sealed - 1);
+        if (first >= s->tail_n)
+            break;
+        int k = s->tail_n - first < DB_TSDB_BLOCK_ROWS ? s->tail_n - first : DB_TSDB_BLOCK_ROWS;
+        for (int j = 0; j < k; j++)
+        {
+            const db_row_t *row = &s->tail[first + j];
+            seg->id[j] = (int)(*next_id + j);
+            seg->ts[j] = (double)row->ts;
+            seg->temp[j] = round1(row->temp);
+            seg->humi[j] = round1(row->humi);
+            memcpy(seg->desc[j], row->desc, sizeof(seg->desc[j]));
+            memcpy(seg->loc[j], row->location, sizeof(seg->loc[j]));
+        }
+        *next_id += k;
+        seg->start = 0;
+        seg->n = n = k;
+    }
+    pthread_rwlock_unlock(&s->lock);
+    return n;
+}
+
+/* ========== 输出块（原始行或按桶聚合） ========== */
+typedef struct
+{
+    db_chunk_cb cb;
+    void *user;
+    int with_id, with_desc;
+    int limit; // 0 不限
+    int total;
+    int stopped;
+    int res; // 0 原始行，否则为桶宽
+    long gmtoff;
+    long bucket;
+    int bucket_n;
+    double t_sum, h_sum;
+    char bucket_desc[32];
+    int n;
+    int id[DB_STREAM_CHUNK];
+    double ts[DB_STREAM_CHUNK];
+    double temp[DB_STREAM_CHUNK];
+    double humi[DB_STREAM_CHUNK];
+    const char *desc[DB_STREAM_CHUNK];
+    char desc_buf[DB_STREAM_CHUNK][32];
+} tsdb_emit_t;
+
+static tsdb_emit_t *emit_new(db_chunk_cb cb, void *user, int res, int with_id, int with_desc)
+{
+    tsdb_emit_t *e = calloc(1, sizeof(*e));
+    if (!e)
+        return NULL;
+    e->cb = cb;
+    e->user = user;
+    e->res = res;
+    e->with_id = with_id;
+    e->with_desc = with_desc;
+    e->gmtoff = db_local_gmtoff();
+    return e;
+}
+
+static void emit_flush(tsdb_emit_t *e)
+{
+    if (e->n == 0 || e->stopped)
+        return;
+    db_chunk_t chunk = {e->n, e->with_id ? e->id : NULL, e->ts, e->temp, e->humi,
+                        e->with_desc ? e->desc : NULL};
+    e->total += e->n;
+    e->n = 0;
+    if (e->cb(&chunk, e->user))
+        e->stopped = 1;
+}
+
+static void emit_row(tsdb_emit_t *e, int id, double ts, double temp, double humi, const char *desc)
+{
+    int k = e->n++;
+    e->id[k] = id;
+    e->ts[k] = ts;
+    e->temp[k] = temp;
+    e->humi[k] = humi;
+    e->desc[k] = NULL;
+    if (desc && desc[0])
+    {
+        snprintf(e->desc_buf[k], sizeof(e->desc_buf[k]), "%s", desc);
+        e->desc[k] = e->desc_buf[k];
+    }
+
+    if (e->limit > 0 && e->total + e->n >= e->limit)
+    {
+        emit_flush(e);
+        e->stopped = 1;
+    }
+    else if (e->n == DB_STREAM_CHUNK)
+    {
+        emit_flush(e);
+    }
+}
+
+static void emit_bucket(tsdb_emit_t *e)
+{
+    if (e->bucket_n == 0)
+        return;
+    emit_row(e, 0, (double)e->bucket, e->t_sum / e->bucket_n, e->h_sum / e->bucket_n, e->bucket_desc);
+    e->bucket_n = 0;
+}
+
+// 写入基本按时间先后，相邻同桶的行直接累加；补写的乱序行会形成额外的桶
+static void emit_value(tsdb_emit_t *e, int id, double ts, double temp, double humi, const char *desc)
+{
+    if (e->res == 0)
+    {
+        emit_row(e, id, ts, temp, humi, desc);
+        return;
+    }
+    long b = db_bucket_start((time_t)ts, e->res, e->gmtoff);
+    if (e->bucket_n > 0 && b != e->bucket)
+        emit_bucket(e);
+    if (e->stopped)
+        return;
+    if (e->bucket_n == 0)
+    {
+        e->bucket = b;
+        e->t_sum = e->h_sum = 0;
+    }
+    e->bucket_n++;
+    e->t_sum += temp;
+    e->h_sum += humi;
+    snprintf(e->bucket_desc, sizeof(e->bucket_desc), "%s", desc ? desc : "");
+}
+
+static int stream_series(tsdb_series_t *s, uint32_t after_id, int64_t from, int64_t to, tsdb_emit_t *e)
+{
+    tsdb_seg_t *seg = malloc(sizeof(*seg));
+    if (!seg)
+        return -1;
+    uint32_t next_id = after_id + 1;
+    while (!e->stopped && read_segment(s, &next_id, from, to, seg) > 0)
+    {
+        for (int i = seg->start; i < seg->n && !e->stopped; i++)
+        {
+            if (seg->ts[i] >= from && seg->ts[i] <= to)
+                emit_value(e, seg->id[i], seg->ts[i], seg->temp[i], seg->humi[i], s->weather ? seg->desc[i] : NULL);
+        }
+    }
+    free(seg);
+    emit_bucket(e);
+    emit_flush(e);
+    return e->total;
+}
+
+/* ========== 文件 ========== */
+static void data_path(const tsdb_series_t *s, char *out, size_t len)
+{
+    snprintf(out, len, "%s/%s.tsdb", DB_TSDB_DIR, s->name);
+}
+
+static void tail_path(const tsdb_series_t *s, uint32_t gen, char *out, size_t len)
+{
+    snprintf(out, len, "%s/%s.tail.%u", DB_TSDB_DIR, s->name, gen);
+}
+
+// 先建立新映射再释放旧映射，失败时旧映射仍可用
+static int map_file(tsdb_series_t *s, size_t len)
+{
+    uint8_t *m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (m == MAP_FAILED)
+    {
+        fprintf(stderr, "[TSDB] mmap %s failed: %s\n", s->name, strerror(errno));
+        return -1;
+    }
+    if (s->map)
+        munmap(s->map, s->map_len);
+    s->map = m;
+    s->map_len = len;
+    return 0;
+}
+
+static int ensure_capacity(tsdb_series_t *s, uint64_t end)
+{
+    if (end <= s->map_len)
+        return 0;
+    size_t len = (size_t)((end + DB_TSDB_GROW_BYTES - 1) / DB_TSDB_GROW_BYTES * DB_TSDB_GROW_BYTES);
+    if (ftruncate(s->fd, (off_t)len) != 0)
+    {
+        fprintf(stderr, "[TSDB] Grow %s failed: %s\n", s->name, strerror(errno));
+        return -1;
+    }
+    return map_file(s, len);
+}
+
+static int sync_range(tsdb_series_t *s, uint64_t off, size_t len)
+{
+    uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = off & ~(page - 1);
+    if (msync(s->map + start, (size_t)(off + len - start), MS_SYNC) != 0)
+    {
+        fprintf(stderr, "[TSDB] msync %s failed: %s\n", s->name, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+static int index_add(tsdb_series_t *s, uint64_t offset, const tsdb_block_t *b)
+{
+    if (s->index_n == s->index_cap)
+    {
+        int cap = s->index_cap ? s->index_cap * 2 : 64;
+        tsdb_index_t *p = realloc(s->index, cap * sizeof(*p));
+        if (!p)
+            return -1;
+        s->index = p;
+        s->index_cap = cap;
+    }
+    s->index[s->index_n++] = (tsdb_index_t){offset, b->t_min, b->t_max, b->first_id, b->count};
+    return 0;
+}
+
+// 由块头链建立索引；文件头在块 msync 之后才提交，已提交的块不会是半写状态，
+// 只校验最后一块的 CRC，打开时不必通读整个文件
+static int build_index(tsdb_series_t *s)
+{
+    tsdb_header_t *h = hdr(s);
+    uint64_t off = TSDB_HEADER_BYTES;
+    uint32_t id = 1;
+    for (uint32_t i = 0; i < h->block_count; i++)
+    {
+        const tsdb_block_t *b = (const tsdb_block_t *)(s->map + off);
+        int ok = off + sizeof(*b) <= h->data_end && b->magic == TSDB_BLOCK_MAGIC && b->bytes >= sizeof(*b) &&
+                 off + b->bytes <= h->data_end && b->first_id == id && b->count <= DB_TSDB_BLOCK_ROWS;
+        if (ok && i + 1 == h->block_count)
+            ok = db_spool_crc32(b + 1, b->bytes - sizeof(*b)) == b->crc;
+        if (!ok)
+        {
+            fprintf(stderr, "[TSDB] %s: block %u corrupt, keeping %u blocks\n", s->name, i, i);
+            h->block_count = i;
+            h->data_end = off;
+            h->sealed_rows = id - 1;
+            sync_range(s, 0, sizeof(*h));
+            break;
+        }
+        if (index_add(s, off, b) != 0)
+            return -1;
+        id += b->count;
+        off += b->bytes;
+    }
+    return 0;
+}
+
+static void series_close(tsdb_series_t *s)
+{
+    if (s->map)
+        munmap(s->map, s->map_len);
+    if (s->fd >= 0)
+        close(s->fd);
+    free(s->index);
+    free(s->tail);
+    s->fd = -1;
+    s->map = NULL;
+    s->map_len = 0;
+    s->index = NULL;
+    s->index_n = s->index_cap = 0;
+    s->tail = NULL;
+    s->tail_n = s->tail_cap = 0;
+}
+
+static int series_open(tsdb_series_t *s)
+{
+    char path[128];
+    data_path(s, path, sizeof(path));
+    s->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (s->fd < 0)
+    {
+        fprintf(stderr, "[TSDB] Cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(s->fd, &st) != 0)
+        goto fail;
+    size_t len = (size_t)st.st_size;
+    if (len < TSDB_HEADER_BYTES)
+    {
+        len = DB_TSDB_GROW_BYTES;
+        if (ftruncate(s->fd, (off_t)len) != 0)
+            goto fail;
+    }
+    if (map_file(s, len) != 0)
+        goto fail;
+
+    tsdb_header_t *h = hdr(s);
+    if (h->magic == 0)
+    {
+        memset(h, 0, TSDB_HEADER_BYTES);
+        h->magic = TSDB_MAGIC;
+        h->version = TSDB_VERSION;
+        h->weather = (uint32_t)s->weather;
+        h->data_end = TSDB_HEADER_BYTES;
+        if (sync_range(s, 0, TSDB_HEADER_BYTES) != 0)
+            goto fail;
+    }
+    else if (h->magic != TSDB_MAGIC || h->version != TSDB_VERSION || h->weather != (uint32_t)s->weather ||
+             h->data_end > s->map_len)
+    {
+        fprintf(stderr, "[TSDB] %s: incompatible file\n", path);
+        goto fail;
+    }
+    if (build_index(s) != 0)
+        goto fail;
+
+    // 封块中途断电可能留下相邻代的尾部日志，以文件头记录的代号为准
+    char tpath[160];
+    if (h->tail_gen > 0)
+    {
+        tail_path(s, h->tail_gen - 1, tpath, sizeof(tpath));
+        unlink(tpath);
+    }
+    tail_path(s, h->tail_gen + 1, tpath, sizeof(tpath));
+    unlink(tpath);
+    tail_path(s, h->tail_gen, tpath, sizeof(tpath));
+    if (db_spool_load(tpath, &s->tail, &s->tail_n) != 0)
+        goto fail;
+    s->tail_cap = s->tail_n;
+
+    printf("[TSDB] %s: %u blocks, %llu sealed rows, %d tail rows\n", s->name, h->block_count,
+           (unsigned long long)h->sealed_rows, s->tail_n);
+    return 0;
+
+fail:
+    series_close(s);
+    return -1;
+}
+
+static int tsdb_init(void)
+{
+    pthread_mutex_lock(&open_lock);
+    if (!tsdb_ready)
+    {
+        if (mkdir(DB_TSDB_DIR, 0755) != 0 && errno != EEXIST)
+            fprintf(stderr, "[TSDB] Cannot create %s: %s\n", DB_TSDB_DIR, strerror(errno));
+        int ok = 1;
+        for (int i = 0; i < SERIES_COUNT && ok; i++)
+            ok = series_open(&series[i]) == 0;
+        if (ok)
+        {
+            tsdb_ready = 1;
+            printf("[TSDB] Storage ready at %s\n", DB_TSDB_DIR);
+        }
+        else
+        {
+            for (int i = 0; i < SERIES_COUNT; i++)
+                series_close(&series[i]);
+        }
+    }
+    int ret = tsdb_ready ? 0 : -1;
+    pthread_mutex_unlock(&open_lock);
+    return ret;
+}
+
+static void tsdb_close(void)
+{
+    pthread_mutex_lock(&open_lock);
+    for (int i = 0; tsdb_ready && i < SERIES_COUNT; i++)
+    {
+        pthread_rwlock_wrlock(&series[i].lock);
+        series_close(&series[i]);
+        pthread_rwlock_unlock(&series[i].lock);
+    }
+    tsdb_ready = 0;
+    pthread_mutex_unlock(&open_lock);
+}
+
+/* ========== 写入 ========== */
+// 尾部前 DB_TSDB_BLOCK_ROWS 行压缩成块：写块并 msync → 剩余行写入新一代尾部日志 → 提交文件头
+static int seal_block(tsdb_series_t *s)
+{
+    const int n = DB_TSDB_BLOCK_ROWS;
+    uint32_t bytes;
+    uint8_t *blk = encode_block(s, s->tail, n, (uint32_t)hdr(s)->sealed_rows + 1, &bytes);
+    if (!blk)
+        return -1;
+    uint64_t off = hdr(s)->data_end;
+    if (ensure_capacity(s, off + bytes) != 0)
+    {
+        free(blk);
+        return -1;
+    }
+    memcpy(s->map + off, blk, bytes);
+    free(blk);
+    if (sync_range(s, off, bytes) != 0)
+        return -1;
+
+    tsdb_header_t *h = hdr(s);
+    char old_path[160], new_path[160];
+    tail_path(s, h->tail_gen, old_path, sizeof(old_path));
+    tail_path(s, h->tail_gen + 1, new_path, sizeof(new_path));
+    unlink(new_path);
+    if (db_spool_append(new_path, s->tail + n, s->tail_n - n) != 0)
+        return -1;
+
+    h->block_count++;
+    h->data_end = off + bytes;
+    h->sealed_rows += n;
+    h->tail_gen++;
+    if (sync_range(s, 0, sizeof(*h)) != 0)
+        fprintf(stderr, "[TSDB] %s: header commit not confirmed\n", s->name);
+    unlink(old_path);
+
+    if (index_add(s, off, (const tsdb_block_t *)(s->map + off)) != 0)
+        fprintf(stderr, "[TSDB] %s: index grow failed\n", s->name);
+    s->tail_n -= n;
+    memmove(s->tail, s->tail + n, s->tail_n * sizeof(db_row_t));
+    return 0;
+}
+
+static int save_rows(tsdb_series_t *s, const db_row_t *rows, int n)
+{
+    if (n <= 0)
+        return 0;
+    if (tsdb_init() != 0)
+        return -1;
+
+    pthread_rwlock_wrlock(&s->lock);
+    int ret = -1;
+    if (s->tail_n + n > s->tail_cap)
+    {
+        int cap = s->tail_cap ? s->tail_cap : DB_TSDB_BLOCK_ROWS;
+        while (cap < s->tail_n + n)
+            cap *= 2;
+        db_row_t *p = realloc(s->tail, cap * sizeof(db_row_t));
+        if (p)
+        {
+            s->tail = p;
+            s->tail_cap = cap;
+        }
+    }
+
+    char path[160];
+    tail_path(s, hdr(s)->tail_gen, path, sizeof(path));
+    if (s->tail_n + n <= s->tail_cap && db_spool_append(path, rows, n) == 0)
+    {
+        memcpy(s->tail + s->tail_n, rows, n * sizeof(db_row_t));
+        s->tail_n += n;
+        ret = 0;
+        // 封块失败（如磁盘满）时行仍在尾部日志中，下次写入再试
+        while (s->tail_n >= DB_TSDB_BLOCK_ROWS && seal_block(s) == 0)
+            ;
+    }
+    pthread_rwlock_unlock(&s->lock);
+    return ret;
+}
+
+static int tsdb_save_sensor_batch(const db_row_t *rows, int n)
+{
+    return save_rows(SENSOR, rows, n);
+}
+
+static int tsdb_save_weather_batch(const db_row_t *rows, int n)
+{
+    return save_rows(WEATHER, rows, n);
+}
+
+/* ========== 读取 ========== */
+static int series_rows(tsdb_series_t *s)
+{
+    pthread_rwlock_rdlock(&s->lock);
+    int n = s->map ? (int)hdr(s)->sealed_rows + s->tail_n : 0;
+    pthread_rwlock_unlock(&s->lock);
+    return n;
+}
+
+static int tsdb_stream_rows_after(int after_id, int limit, db_chunk_cb cb, void *user)
+{
+    if (tsdb_init() != 0)
+        return -1;
+    tsdb_emit_t *e = emit_new(cb, user, 0, 1, 0);
+    if (!e)
+        return -1;
+    e->limit = limit > 0 ? limit : 0;
+    int n = stream_series(SENSOR, after_id > 0 ? (uint32_t)after_id : 0, INT64_MIN, INT64_MAX, e);
+    free(e);
+    return n;
+}
+
+// 汇总分辨率下返回起点对齐后与 [start_ts, end_ts] 相交的桶，与 MySQL 汇总表查询一致
+static int stream_range(tsdb_series_t *s, time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                        db_chunk_cb cb, void *user)
+{
+    if (tsdb_init() != 0)
+        return -1;
+    tsdb_emit_t *e = emit_new(cb, user, (int)resolution, 0, s->weather);
+    if (!e)
+        return -1;
+    int64_t from = start_ts, to = end_ts;
+    if (resolution != DB_RES_RAW)
+    {
+        from = db_bucket_start(start_ts, resolution, e->gmtoff);
+        to = db_bucket_start(end_ts, resolution, e->gmtoff) + resolution - 1;
+    }
+    int n = stream_series(s, 0, from, to, e);
+    free(e);
+    return n;
+}
+
+static int tsdb_stream_sensor_range(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                                    db_chunk_cb cb, void *user)
+{
+    return stream_range(SENSOR, start_ts, end_ts, resolution, cb, user);
+}
+
+static int tsdb_stream_weather_range(time_t start_ts, time_t end_ts, db_resolution_t resolution,
+                                     db_chunk_cb cb, void *user)
+{
+    return stream_range(WEATHER, start_ts, end_ts, resolution, cb, user);
+}
+
+static int tsdb_sensor_max_id(void)
+{
+    if (tsdb_init() != 0)
+        return -1;
+    return series_rows(SENSOR);
+}
+
+/* ========== 表列表 / 预览 / 导出 ========== */
+static tsdb_series_t *find_series(const char *name)
+{
+    for (int i = 0; i < SERIES_COUNT; i++)
+    {
+        if (strcmp(series[i].name, name) == 0)
+            return &series[i];
+    }
+    return NULL;
+}
+
+static int tsdb_table_list(db_table_info_t *out, int max_count)
+{
+    if (tsdb_init() != 0)
+        return 0;
+    int i;
+    for (i = 0; i < SERIES_COUNT && i < max_count; i++)
+    {
+        memset(&out[i], 0, sizeof(out[i]));
+        strncpy(out[i].name, series[i].name, sizeof(out[i].name) - 1);
+        strncpy(out[i].desc, series[i].desc, sizeof(out[i].desc) - 1);
+        out[i].count = series_rows(&series[i]);
+    }
+    return i;
+}
+
+typedef struct
+{
+    db_preview_row_t *out;
+    int max_rows;
+    int hi; // 第 0 行的 id
+} preview_ctx_t;
+
+static int preview_chunk(const db_chunk_t *chunk, void *user)
+{
+    preview_ctx_t *c = user;
+    for (int i = 0; i < chunk->count; i++)
+    {
+        int pos = c->hi - chunk->id[i];
+        if (pos < 0 || pos >= c->max_rows)
+            continue;
+        time_t ts = (time_t)chunk->ts[i];
+        struct tm tm;
+        localtime_r(&ts, &tm);
+        c->out[pos].id = chunk->id[i];
+        c->out[pos].temp = (float)chunk->temp[i];
+        c->out[pos].humi = (float)chunk->humi[i];
+        strftime(c->out[pos].ts, sizeof(c->out[pos].ts), "%m-%d %H:%M", &tm);
+    }
+    return 0;
+}
+
+// 与 MySQL 后端一致：按 id 倒序；id 从 1 连续编号，游标直接换算为区间
+static int tsdb_preview(const char *tablename, int cursor_id, int newer, db_preview_row_t *out, int max_rows)
+{
+    tsdb_series_t *s = find_series(tablename);
+    if (!s || tsdb_init() != 0)
+        return 0;
+    int rows = series_rows(s);
+    int hi;
+    if (newer)
+        hi = cursor_id + max_rows < rows ? cursor_id + max_rows : rows;
+    else
+        hi = cursor_id > 0 && cursor_id <= rows ? cursor_id - 1 : rows;
+    if (hi <= 0 || max_rows <= 0 || (newer && hi <= cursor_id))
+        return 0;
+    int lo = newer ? cursor_id : (hi > max_rows ? hi - max_rows : 0);
+
+    preview_ctx_t ctx = {out, max_rows, hi};
+    tsdb_emit_t *e = emit_new(preview_chunk, &ctx, 0, 1, 0);
+    if (!e)
+        return 0;
+    e->limit = hi - lo;
+    int n = stream_series(s, (uint32_t)lo, INT64_MIN, INT64_MAX, e);
+    free(e);
+    return n < 0 ? 0 : n;
+}
+
+static int tsdb_export_rows(const char *tablename, const db_export_sink_t *sink, char *msg, int msg_len)
+{
+    tsdb_series_t *s = find_series(tablename);
+    if (!s)
+    {
+        snprintf(msg, msg_len, "No such table");
+        return -1;
+    }
+    if (tsdb_init() != 0)
+    {
+        snprintf(msg, msg_len, "DB Error");
+        return -1;
+    }
+    tsdb_seg_t *seg = malloc(sizeof(*seg));
+    if (!seg)
+    {
+        snprintf(msg, msg_len, "No Memory");
+        return -1;
+    }
+
+    // 列与 MySQL 表结构一致
+    static const char *const sensor_cols[] = {"id", "ts", "temp", "humi"};
+    static const char *const weather_cols[] = {"id", "ts", "temperature", "humidity", "location", "weather_desc"};
+    int col_count = s->weather ? 6 : 4;
+    int rows = 0, stopped = sink->columns(sink->user, s->weather ? weather_cols : sensor_cols, col_count) != 0;
+
+    char id_str[16], ts_str[24], temp_str[16], humi_str[16];
+    db_cell_t cells[6] = {
+        {id_str, 0, 1}, {ts_str, 0, 0}, {temp_str, 0, 1}, {humi_str, 0, 1}, {NULL, 0, 0}, {NULL, 0, 0}};
+    uint32_t next_id = 1;
+    while (!stopped && read_segment(s, &next_id, INT64_MIN, INT64_MAX, seg) > 0)
+    {
+        for (int i = seg->start; i < seg->n && !stopped; i++, rows++)
+        {
+            time_t ts = (time_t)seg->ts[i];
+            struct tm tm;
+            localtime_r(&ts, &tm);
+            strftime(ts_str, sizeof(ts_str), "%Y-%m-%d %H:%M:%S", &tm);
+            snprintf(id_str, sizeof(id_str), "%d", seg->id[i]);
+            snprintf(temp_str, sizeof(temp_str), "%g", seg->temp[i]);
+            snprintf(humi_str, sizeof(humi_str), "%g", seg->humi[i]);
+            cells[0].num = seg->id[i];
+            cells[2].num = seg->temp[i];
+            cells[3].num = seg->humi[i];
+            cells[4].str = seg->loc[i];
+            cells[5].str = seg->desc[i];
+            stopped = sink->row(sink->user, cells, col_count) != 0;
+        }
+    }
+    free(seg);
+
+    if (stopped)
+    {
+        snprintf(msg, msg_len, "Stopped");
+        return -2;
+    }
+    return rows;
+}
+
+const db_backend_t db_backend_tsdb = {
+    .name = "tsdb",
+    .init = tsdb_init,
+    .close = tsdb_close,
+    .save_sensor_batch = tsdb_save_sensor_batch,
+    .save_weather_batch = tsdb_save_weather_batch,
+    .stream_sensor_rows_after = tsdb_stream_rows_after,
+    .stream_sensor_range = tsdb_stream_sensor_range,
+    .stream_weather_range = tsdb_stream_weather_range,
+    .sensor_max_id = tsdb_sensor_max_id,
+    .table_list = tsdb_table_list,
+    .preview = tsdb_preview,
+    .export_rows = tsdb_export_rows,
+};
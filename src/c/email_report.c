@@ -8,6 +8,7 @@
 #include <curl/curl.h>
 #include "email_report.h"
 #include "db_helper.h"
+#include "stats_engine.h"
 
 /* ==================== 全局配置（静态变量） ==================== */
 static char g_recipient[128] = {0};
@@ -15,229 +16,109 @@ static int g_send_hour = 8;
 static int g_send_minute = 0;
 static time_t g_last_sent_date = 0;
 
-/* ==================== 统计辅助函数 ==================== */
-static int cmp_double(const void *a, const void *b)
-{
-    double da = *(const double *)a, db = *(const double *)b;
-    return (da > db) - (da < db);
-}
-
-static void calc_mean_std(const double *data, int n, double *mean, double *std)
-{
-    double sum = 0.0;
-    for (int i = 0; i < n; i++)
-        sum += data[i];
-    *mean = sum / n;
-    double var = 0.0;
-    for (int i = 0; i < n; i++)
-        var += (data[i] - *mean) * (data[i] - *mean);
-    *std = sqrt(var / n);
-}
+/* ==================== 分析函数 ==================== */
+// 天气与室内传感器配对时允许的时间差（传感器缺数超过该时长的天气行不参与配对）
+#define SENSOR_ALIGN_TOL_S 900
 
-static double calc_pearson(const double *x, const double *y, int n)
+// 传感器统计来自统一统计库（增量缓存 + 窗口结果共享）
+static int analyze_sensor_data(time_t start_ts, time_t end_ts, report_analysis_t *res)
 {
-    double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0, sum_y2 = 0;
-    for (int i = 0; i < n; i++)
-    {
-        sum_x += x[i];
-        sum_y += y[i];
-        sum_xy += x[i] * y[i];
-        sum_x2 += x[i] * x[i];
-        sum_y2 += y[i] * y[i];
-    }
-    double denom = (n * sum_x2 - sum_x * sum_x) * (n * sum_y2 - sum_y * sum_y);
-    if (denom <= 0)
+    stats_result_t sr;
+    if (stats_window(start_ts, end_ts, &sr) != 0)
+        return -1;
+    if (sr.count == 0)
         return 0;
-    return (n * sum_xy - sum_x * sum_y) / sqrt(denom);
-}
 
-static double calc_trend_per_day(const double *y, const double *x_days, int n)
-{
-    if (n < 2)
-        return 0;
-    double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0;
-    for (int i = 0; i < n; i++)
-    {
-        sum_x += x_days[i];
-        sum_y += y[i];
-        sum_xy += x_days[i] * y[i];
-        sum_x2 += x_days[i] * x_days[i];
-    }
-    double denominator = n * sum_x2 - sum_x * sum_x;
-    if (fabs(denominator) < 1e-9)
-        return 0;
-    return (n * sum_xy - sum_x * sum_y) / denominator;
+    res->sensor_count = sr.count;
+    res->sensor_temp_mean = sr.temp_mean;
+    res->sensor_temp_std = sr.temp_std;
+    res->sensor_temp_min = sr.temp_min;
+    res->sensor_temp_max = sr.temp_max;
+    res->sensor_humi_mean = sr.humi_mean;
+    res->sensor_humi_std = sr.humi_std;
+    res->sensor_humi_min = sr.humi_min;
+    res->sensor_humi_max = sr.humi_max;
+    res->sensor_pearson_corr = sr.temp_humi_corr;
+    res->sensor_thi_mean = sr.thi_mean;
+    snprintf(res->comfort_grade, sizeof(res->comfort_grade), "%s", sr.comfort_grade);
+    snprintf(res->comfort_suggestion, sizeof(res->comfort_suggestion), "%s", sr.comfort_suggestion);
+    res->temp_anom_3sigma = sr.temp_anom_3sigma;
+    res->humi_anom_3sigma = sr.humi_anom_3sigma;
+    res->temp_trend_per_day = sr.temp_trend_per_day;
+    res->humi_trend_per_day = sr.humi_trend_per_day;
+    return 0;
 }
 
-/* ==================== 分析函数 ==================== */
-static void analyze_sensor_data(const double *temp, const double *humi, int n, report_analysis_t *res)
+static void analyze_weather_data(const series_t *w, report_analysis_t *res)
 {
+    int n = w->count;
     if (n == 0)
         return;
-    res->sensor_count = n;
-
-    calc_mean_std(temp, n, &res->sensor_temp_mean, &res->sensor_temp_std);
-    calc_mean_std(humi, n, &res->sensor_humi_mean, &res->sensor_humi_std);
-
-    // 极值
-    res->sensor_temp_min = res->sensor_temp_max = temp[0];
-    res->sensor_humi_min = res->sensor_humi_max = humi[0];
-    for (int i = 1; i < n; i++)
-    {
-        if (temp[i] < res->sensor_temp_min)
-            res->sensor_temp_min = temp[i];
-        if (temp[i] > res->sensor_temp_max)
-            res->sensor_temp_max = temp[i];
-        if (humi[i] < res->sensor_humi_min)
-            res->sensor_humi_min = humi[i];
-        if (humi[i] > res->sensor_humi_max)
-            res->sensor_humi_max = humi[i];
-    }
-
-    res->sensor_pearson_corr = calc_pearson(temp, humi, n);
-
-    // THI
-    double thi_sum = 0;
-    for (int i = 0; i < n; i++)
-    {
-        double thi = 0.8 * temp[i] + (0.01 * humi[i]) * (0.8 * temp[i] - 14.3) + 46.3;
-        thi_sum += thi;
-    }
-    res->sensor_thi_mean = thi_sum / n;
-
-    if (res->sensor_thi_mean < 55)
-    {
-        strcpy(res->comfort_grade, "Cold");
-        strcpy(res->comfort_suggestion, "Warm");
-    }
-    else if (res->sensor_thi_mean < 60)
-    {
-        strcpy(res->comfort_grade, "Cool");
-        strcpy(res->comfort_suggestion, "Add clothes");
-    }
-    else if (res->sensor_thi_mean < 65)
-    {
-        strcpy(res->comfort_grade, "Comfort");
-        strcpy(res->comfort_suggestion, "Good");
-    }
-    else if (res->sensor_thi_mean < 70)
-    {
-        strcpy(res->comfort_grade, "Warm");
-        strcpy(res->comfort_suggestion, "Ventilate");
-    }
-    else if (res->sensor_thi_mean < 75)
-    {
-        strcpy(res->comfort_grade, "Hot");
-        strcpy(res->comfort_suggestion, "Fan/AC");
-    }
-    else
-    {
-        strcpy(res->comfort_grade, "Muggy");
-        strcpy(res->comfort_suggestion, "Cool down");
-    }
+    res->weather_count = n;
 
-    // 3σ异常
-    double temp_std3 = 3 * res->sensor_temp_std;
-    double humi_std3 = 3 * res->sensor_humi_std;
-    int ta = 0, ha = 0;
+    stats_summary_t ts, hs;
+    stats_summarize(w->temp, n, &ts);
+    stats_summarize(w->humi, n, &hs);
+    res->weather_temp_mean = ts.mean;
+    res->weather_temp_std = ts.std;
+    res->weather_temp_min = ts.min;
+    res->weather_temp_max = ts.max;
+    res->weather_humi_mean = hs.mean;
+    res->weather_humi_std = hs.std;
+    res->weather_humi_min = hs.min;
+    res->weather_humi_max = hs.max;
+
+    // 统计最常见天气：描述已按字典编码，按编码计数即可（编码按首次出现顺序分配，并列时取先出现的）
+    int *counts = calloc(w->dict_count, sizeof(int));
+    if (!counts)
+        return;
     for (int i = 0; i < n; i++)
+        counts[w->desc[i]]++;
+    int best = -1;
+    for (int c = 0; c < w->dict_count; c++)
     {
-        if (fabs(temp[i] - res->sensor_temp_mean) > temp_std3)
-            ta++;
-        if (fabs(humi[i] - res->sensor_humi_mean) > humi_std3)
-            ha++;
+        if (counts[c] > 0 && (best < 0 || counts[c] > counts[best]))
+            best = c;
     }
-    res->temp_anom_3sigma = ta;
-    res->humi_anom_3sigma = ha;
-
-    // 趋势（用索引作为天数）
-    double *days = malloc(n * sizeof(double));
-    for (int i = 0; i < n; i++)
-        days[i] = i;
-    res->temp_trend_per_day = calc_trend_per_day(temp, days, n);
-    res->humi_trend_per_day = calc_trend_per_day(humi, days, n);
-    free(days);
+    free(counts);
+    const char *most_common = best >= 0 && w->dict[best] ? w->dict[best] : "unknown";
+    snprintf(res->most_common_weather, sizeof(res->most_common_weather), "%s", most_common);
 }
 
-static void analyze_weather_data(const double *temp, const double *humi, const char **desc, int n, report_analysis_t *res)
+// 以天气时刻为准，在原始传感器序列中按时间插值取对齐值后配对
+static void compute_comparison(time_t start_ts, time_t end_ts, const series_t *w, report_analysis_t *res)
 {
-    if (n == 0)
+    if (res->sensor_count == 0 || w->count == 0)
         return;
-    res->weather_count = n;
 
-    calc_mean_std(temp, n, &res->weather_temp_mean, &res->weather_temp_std);
-    calc_mean_std(humi, n, &res->weather_humi_mean, &res->weather_humi_std);
+    res->temp_diff_mean = res->sensor_temp_mean - res->weather_temp_mean;
+    res->humi_diff_mean = res->sensor_humi_mean - res->weather_humi_mean;
+    res->temp_corr_with_weather = 0;
+    res->humi_corr_with_weather = 0;
 
-    res->weather_temp_min = res->weather_temp_max = temp[0];
-    res->weather_humi_min = res->weather_humi_max = humi[0];
-    for (int i = 1; i < n; i++)
+    series_t *s = db_load_sensor_range(start_ts, end_ts, DB_RES_RAW);
+    series_t *w_pair = NULL, *s_pair = NULL;
+    int pairs = s ? series_asof_join(w, s, SENSOR_ALIGN_TOL_S, SERIES_ASOF_LINEAR, &w_pair, &s_pair) : -1;
+    if (pairs > 0)
     {
-        if (temp[i] < res->weather_temp_min)
-            res->weather_temp_min = temp[i];
-        if (temp[i] > res->weather_temp_max)
-            res->weather_temp_max = temp[i];
-        if (humi[i] < res->weather_humi_min)
-            res->weather_humi_min = humi[i];
-        if (humi[i] > res->weather_humi_max)
-            res->weather_humi_max = humi[i];
-    }
-
-    // 统计最常见天气
-    int max_count = 0;
-    char most_common[30] = "unknown";
-    for (int i = 0; i < n; i++)
-    {
-        int count = 1;
-        for (int j = i + 1; j < n; j++)
-        {
-            if (desc[j] && desc[i] && strcmp(desc[i], desc[j]) == 0)
-                count++;
-        }
-        if (count > max_count)
+        // 有配对时温差取同一时刻的差值均值
+        double dt = 0, dh = 0;
+        for (int i = 0; i < pairs; i++)
         {
-            max_count = count;
-            strncpy(most_common, desc[i] ? desc[i] : "unknown", sizeof(most_common) - 1);
+            dt += s_pair->temp[i] - w_pair->temp[i];
+            dh += s_pair->humi[i] - w_pair->humi[i];
         }
+        res->temp_diff_mean = dt / pairs;
+        res->humi_diff_mean = dh / pairs;
     }
-    strncpy(res->most_common_weather, most_common, sizeof(res->most_common_weather) - 1);
-}
-
-static void compute_comparison(const double *sensor_temp, const double *sensor_humi, int sn,
-                               const double *weather_temp, const double *weather_humi, int wn,
-                               report_analysis_t *res)
-{
-    if (sn == 0 || wn == 0)
-        return;
-
-    double st_mean = 0, wht_mean = 0, sh_mean = 0, whh_mean = 0;
-    for (int i = 0; i < sn; i++)
-    {
-        st_mean += sensor_temp[i];
-        sh_mean += sensor_humi[i];
-    }
-    st_mean /= sn;
-    sh_mean /= sn;
-    for (int i = 0; i < wn; i++)
-    {
-        wht_mean += weather_temp[i];
-        whh_mean += weather_humi[i];
-    }
-    wht_mean /= wn;
-    whh_mean /= wn;
-
-    res->temp_diff_mean = st_mean - wht_mean;
-    res->humi_diff_mean = sh_mean - whh_mean;
-
-    if (sn == wn && sn > 2)
-    {
-        res->temp_corr_with_weather = calc_pearson(sensor_temp, weather_temp, sn);
-        res->humi_corr_with_weather = calc_pearson(sensor_humi, weather_humi, sn);
-    }
-    else
+    if (pairs > 2)
     {
-        res->temp_corr_with_weather = 0;
-        res->humi_corr_with_weather = 0;
+        res->temp_corr_with_weather = stats_pearson(s_pair->temp, w_pair->temp, pairs);
+        res->humi_corr_with_weather = stats_pearson(s_pair->humi, w_pair->humi, pairs);
     }
+    series_release(w_pair);
+    series_release(s_pair);
+    series_release(s);
 }
 
 static void generate_report_text(const report_analysis_t *res, char *buffer, size_t buf_size)
@@ -499,50 +380,26 @@ void email_send_daily_report(void)
     time_t start_ts, end_ts;
     get_day_range(&start_ts, &end_ts, yesterday);
 
-    // 查询传感器数据
-    double *sensor_temp, *sensor_humi;
-    int sensor_count;
-    if (db_get_sensor_data_range(start_ts, end_ts, &sensor_temp, &sensor_humi, &sensor_count) != 0)
+    report_analysis_t res = {0};
+
+    // 传感器统计
+    if (analyze_sensor_data(start_ts, end_ts, &res) != 0)
     {
         fprintf(stderr, "[EMAIL] Failed to get sensor data\n");
         return;
     }
 
     // 查询天气数据
-    double *weather_temp, *weather_humi;
-    char **weather_desc;
-    int weather_count;
-    if (db_get_weather_data_range(start_ts, end_ts, &weather_temp, &weather_humi, &weather_desc, &weather_count) != 0)
-    {
-        fprintf(stderr, "[EMAIL] Failed to get weather data\n");
-        weather_count = 0; // 继续
-    }
+    series_t *weather = db_load_weather_range(start_ts, end_ts, DB_RES_RAW);
+    if (!weather)
+        fprintf(stderr, "[EMAIL] Failed to get weather data\n"); // 继续
 
-    report_analysis_t res = {0};
-    if (sensor_count > 0)
+    if (weather && weather->count > 0)
     {
-        analyze_sensor_data(sensor_temp, sensor_humi, sensor_count, &res);
-        res.sensor_count = sensor_count;
+        analyze_weather_data(weather, &res);
+        compute_comparison(start_ts, end_ts, weather, &res);
     }
-    if (weather_count > 0)
-    {
-        analyze_weather_data(weather_temp, weather_humi, (const char **)weather_desc, weather_count, &res);
-        res.weather_count = weather_count;
-    }
-    if (sensor_count > 0 && weather_count > 0)
-    {
-        compute_comparison(sensor_temp, sensor_humi, sensor_count,
-                           weather_temp, weather_humi, weather_count, &res);
-    }
-
-    // 释放内存
-    free(sensor_temp);
-    free(sensor_humi);
-    free(weather_temp);
-    free(weather_humi);
-    for (int i = 0; i < weather_count; i++)
-        free(weather_desc[i]);
-    free(weather_desc);
+    series_release(weather);
 
     char report_body[4096];
     generate_report_text(&res, report_body, sizeof(report_body));
@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mount.h>
+#include <xlsxwriter.h>
+#include <zlib.h>
+#include "export_job.h"
+#include "db_helper.h"
+
+#define USB_MOUNT_POINT "/mnt/usb"
+#define LOCAL_EXPORT_DIR "/mnt/msata"
+#define PROGRESS_EVERY 256      // 每写出多少行发布一次进度并检查取消
+#define CSV_BUF_SIZE (64 * 1024) // CSV 先攒入缓冲区，整块写出
+#define XLSX_MAX_ROWS (LXW_ROW_MAX - 1) // xlsx 单表上限（扣除表头行），超出时需改用 CSV
+
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static export_status_t job_status;
+static int job_cancel = 0;
+
+// ====================== USB 检测与挂载 ======================
+static void safe_umount(const char *path)
+{
+    if (access(path, F_OK) == 0)
+    {
+        if (umount(path) != 0)
+        {
+            umount2(path, MNT_FORCE);
+        }
+    }
+}
+
+static int find_usb_mountpoint(char *out, int out_len)
+{
+    if (access(USB_MOUNT_POINT, W_OK) == 0)
+    {
+        snprintf(out, out_len, "%s", USB_MOUNT_POINT);
+        return 0;
+    }
+    system("sudo mkdir -p " USB_MOUNT_POINT);
+    system("sudo mount /dev/sdb1 " USB_MOUNT_POINT " 2>/dev/null");
+    if (access(USB_MOUNT_POINT, W_OK) == 0)
+    {
+        snprintf(out, out_len, "%s", USB_MOUNT_POINT);
+        return 0;
+    }
+    system("sudo mount /dev/sdc1 " USB_MOUNT_POINT " 2>/dev/null");
+    if (access(USB_MOUNT_POINT, W_OK) == 0)
+    {
+        snprintf(out, out_len, "%s", USB_MOUNT_POINT);
+        return 0;
+    }
+    return -1;
+}
+
+// ====================== 写出器 ======================
+typedef struct
+{
+    export_format_t fmt;
+    int rows;
+    int io_err;
+    int too_many; // 超出 xlsx 行数上限
+
+    // xlsx（constant_memory：逐行落到临时文件，内存只保留当前行）
+    lxw_workbook *workbook;
+    lxw_worksheet *worksheet;
+
+    // csv / csv.gz
+    FILE *fp;
+    gzFile gz;
+    char *buf;
+    int buf_len;
+} writer_t;
+
+static void csv_flush(writer_t *w)
+{
+    if (w->buf_len == 0 || w->io_err)
+    {
+        w->buf_len = 0;
+        return;
+    }
+    if (w->gz)
+    {
+        if (gzwrite(w->gz, w->buf, (unsigned)w->buf_len) != w->buf_len)
+            w->io_err = 1;
+    }
+    else if (fwrite(w->buf, 1, (size_t)w->buf_len, w->fp) != (size_t)w->buf_len)
+    {
+        w->io_err = 1;
+    }
+    w->buf_len = 0;
+}
+
+static inline void csv_putc(writer_t *w, char ch)
+{
+    if (w->buf_len == CSV_BUF_SIZE)
+        csv_flush(w);
+    w->buf[w->buf_len++] = ch;
+}
+
+// RFC 4180：含逗号、双引号或换行的字段加引号，内部双引号写两次
+static void csv_field(writer_t *w, const char *s)
+{
+    if (!s)
+        return;
+    int quote = strpbrk(s, ",\"\r\n") != NULL;
+    if (quote)
+        csv_putc(w, '"');
+    for (; *s; s++)
+    {
+        if (*s == '"')
+            csv_putc(w, '"');
+        csv_putc(w, *s);
+    }
+    if (quote)
+        csv_putc(w, '"');
+}
+
+static void csv_end_row(writer_t *w)
+{
+    csv_putc(w, '\r');
+    csv_putc(w, '\n');
+}
+
+static int check_cancel(writer_t *w)
+{
+    pthread_mutex_lock(&job_lock);
+    job_status.rows = w->rows;
+    int cancel = job_cancel;
+    pthread_mutex_unlock(&job_lock);
+    return cancel;
+}
+
+static int sink_columns(void *user, const char *const *names, int count)
+{
+    writer_t *w = user;
+    for (int c = 0; c < count; c++)
+    {
+        if (w->fmt == EXPORT_XLSX)
+        {
+            if (worksheet_write_string(w->worksheet, 0, c, names[c], NULL) != LXW_NO_ERROR)
+                w->io_err = 1;
+        }
+        else
+        {
+            if (c > 0)
+                csv_putc(w, ',');
+            csv_field(w, names[c]);
+        }
+    }
+    if (w->fmt != EXPORT_XLSX)
+        csv_end_row(w);
+    if (w->io_err)
+        return 1;
+    return check_cancel(w);
+}
+
+static int sink_row(void *user, const db_cell_t *cells, int count)
+{
+    writer_t *w = user;
+    // 超出上限时 libxlsxwriter 只返回错误而不写入，不能静默丢行
+    if (w->fmt == EXPORT_XLSX && w->rows >= XLSX_MAX_ROWS)
+    {
+        w->too_many = 1;
+        return 1;
+    }
+    int r = ++w->rows;
+    for (int c = 0; c < count; c++)
+    {
+        if (w->fmt == EXPORT_XLSX)
+        {
+            lxw_error err = LXW_NO_ERROR;
+            if (cells[c].is_num)
+                err = worksheet_write_number(w->worksheet, r, c, cells[c].num, NULL);
+            else if (cells[c].str)
+                err = worksheet_write_string(w->worksheet, r, c, cells[c].str, NULL);
+            if (err != LXW_NO_ERROR)
+                w->io_err = 1;
+        }
+        else
+        {
+            if (c > 0)
+                csv_putc(w, ',');
+            csv_field(w, cells[c].str);
+        }
+    }
+    if (w->fmt != EXPORT_XLSX)
+        csv_end_row(w);
+
+    if (w->io_err)
+        return 1;
+    if (r % PROGRESS_EVERY == 0)
+        return check_cancel(w);
+    return 0;
+}
+
+static int writer_open(writer_t *w, const char *path, const char *sheet)
+{
+    if (w->fmt == EXPORT_XLSX)
+    {
+        lxw_workbook_options options = {.constant_memory = LXW_TRUE, .tmpdir = EXPORT_TMP_DIR};
+        w->workbook = workbook_new_opt(path, &options);
+        if (!w->workbook)
+            return -1;
+        w->worksheet = workbook_add_worksheet(w->workbook, sheet);
+        return w->worksheet ? 0 : -1;
+    }
+
+    w->buf = malloc(CSV_BUF_SIZE);
+    if (!w->buf)
+        return -1;
+    if (w->fmt == EXPORT_CSV_GZ)
+    {
+        w->gz = gzopen(path, "wb6");
+        if (w->gz)
+            gzbuffer(w->gz, CSV_BUF_SIZE);
+        return w->gz ? 0 : -1;
+    }
+    w->fp = fopen(path, "wb");
+    return w->fp ? 0 : -1;
+}
+
+// 关闭并落盘，返回 0 成功
+static int writer_close(writer_t *w)
+{
+    int ret = 0;
+    if (w->fmt == EXPORT_XLSX)
+    {
+        // 常量内存模式下 zip 在关闭时才打包，取消时也需要关闭以清理临时文件
+        if (w->workbook && workbook_close(w->workbook) != LXW_NO_ERROR)
+            ret = -1;
+        return ret;
+    }
+
+    csv_flush(w);
+    if (w->io_err)
+        ret = -1;
+    if (w->gz && gzclose(w->gz) != Z_OK)
+        ret = -1;
+    if (w->fp)
+    {
+        if (fflush(w->fp) != 0 || fsync(fileno(w->fp)) != 0)
+            ret = -1;
+        if (fclose(w->fp) != 0)
+            ret = -1;
+    }
+    free(w->buf);
+    return ret;
+}
+
+// ====================== 导出线程 ======================
+typedef struct
+{
+    char table[64];
+    export_format_t fmt;
+} job_args_t;
+
+static void finish(export_state_t state, int rows, const char *msg)
+{
+    pthread_mutex_lock(&job_lock);
+    job_status.state = state;
+    job_status.rows = rows;
+    if (msg)
+        snprintf(job_status.msg, sizeof(job_status.msg), "%s", msg);
+    pthread_mutex_unlock(&job_lock);
+}
+
+static void set_hint(const char *hint)
+{
+    pthread_mutex_lock(&job_lock);
+    snprintf(job_status.hint, sizeof(job_status.hint), "%s", hint);
+    pthread_mutex_unlock(&job_lock);
+}
+
+static void *export_thread(void *arg)
+{
+    job_args_t args = *(job_args_t *)arg;
+    free(arg);
+
+    char usb_path[128] = {0};
+    char path[256];
+    int to_usb = find_usb_mountpoint(usb_path, sizeof(usb_path)) == 0;
+    snprintf(path, sizeof(path), "%s/%s.%s", to_usb ? usb_path : LOCAL_EXPORT_DIR,
+             args.table, export_format_ext(args.fmt));
+
+    pthread_mutex_lock(&job_lock);
+    job_status.to_usb = to_usb;
+    snprintf(job_status.path, sizeof(job_status.path), "%s", path);
+    pthread_mutex_unlock(&job_lock);
+
+    // 先写到临时名，成功后再改名，取消或失败不会覆盖上一次同名导出
+    char part[sizeof(path) + 8];
+    snprintf(part, sizeof(part), "%s.part", path);
+
+    writer_t w = {.fmt = args.fmt};
+    char msg[64] = {0};
+    int ret;
+    if (writer_open(&w, part, args.table) != 0)
+    {
+        snprintf(msg, sizeof(msg), "File Err");
+        ret = -1;
+    }
+    else
+    {
+        ret = db_export_rows(args.table, &(db_export_sink_t){sink_columns, sink_row, &w}, msg, sizeof(msg));
+        if (ret == -2 && w.too_many)
+        {
+            snprintf(msg, sizeof(msg), "Too many rows");
+            set_hint("Use CSV instead");
+            ret = -1;
+        }
+        else if (ret == -2 && w.io_err)
+        {
+            snprintf(msg, sizeof(msg), "Write Err");
+            ret = -1;
+        }
+    }
+    if (writer_close(&w) != 0 && ret >= 0)
+    {
+        snprintf(msg, sizeof(msg), "Write Err");
+        ret = -1;
+    }
+
+    if (ret >= 0 && rename(part, path) != 0)
+    {
+        snprintf(msg, sizeof(msg), "Rename Err");
+        ret = -1;
+    }
+    if (ret < 0)
+        unlink(part); // 不留下半个文件
+    if (to_usb)
+    {
+        sync();
+        safe_umount(usb_path);
+    }
+
+    if (ret >= 0)
+    {
+        printf("[EXPORT] %s: %d rows -> %s\n", args.table, ret, path);
+        finish(EXPORT_DONE, ret, NULL);
+    }
+    else if (ret == -2)
+    {
+        printf("[EXPORT] %s: cancelled\n", args.table);
+        finish(EXPORT_CANCELLED, w.rows, "Cancelled");
+    }
+    else
+    {
+        fprintf(stderr, "[EXPORT] %s: %s\n", args.table, msg);
+        finish(EXPORT_FAILED, w.rows, msg);
+    }
+    return NULL;
+}
+
+// ====================== 对外接口 ======================
+const char *export_format_ext(export_format_t fmt)
+{
+    switch (fmt)
+    {
+    case EXPORT_CSV:
+        return "csv";
+    case EXPORT_CSV_GZ:
+        return "csv.gz";
+    default:
+        return "xlsx";
+    }
+}
+
+int export_job_start(const char *tablename, int total_rows, int total_exact, export_format_t fmt)
+{
+    if (!tablename || (unsigned)fmt >= EXPORT_FORMAT_COUNT)
+        return -1;
+    job_args_t *args = malloc(sizeof(*args));
+    if (!args)
+        return -1;
+    snprintf(args->table, sizeof(args->table), "%s", tablename);
+    args->fmt = fmt;
+
+    pthread_mutex_lock(&job_lock);
+    if (job_status.state == EXPORT_RUNNING)
+    {
+        pthread_mutex_unlock(&job_lock);
+        free(args);
+        return -1;
+    }
+    memset(&job_status, 0, sizeof(job_status));
+    job_status.total = total_rows > 0 ? total_rows : 0;
+    job_cancel = 0;
+    // 精确行数已超出 xlsx 上限，不必读到一百万行后再失败；
+    // 估算值（InnoDB TABLE_ROWS）可能明显偏大，交给 sink_row 按实际行数判断
+    if (fmt == EXPORT_XLSX && total_exact && total_rows > XLSX_MAX_ROWS)
+    {
+        job_status.state = EXPORT_FAILED;
+        snprintf(job_status.msg, sizeof(job_status.msg), "Too many rows");
+        snprintf(job_status.hint, sizeof(job_status.hint), "Use CSV instead");
+        pthread_mutex_unlock(&job_lock);
+        free(args);
+        fprintf(stderr, "[EXPORT] %s: %d rows exceed the xlsx limit\n", tablename, total_rows);
+        return -1;
+    }
+    job_status.state = EXPORT_RUNNING;
+    pthread_mutex_unlock(&job_lock);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, export_thread, args) != 0)
+    {
+        fprintf(stderr, "[EXPORT] Failed to create export thread\n");
+        free(args);
+        finish(EXPORT_FAILED, 0, "Thread Err");
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
+
+void export_job_cancel(void)
+{
+    pthread_mutex_lock(&job_lock);
+    if (job_status.state == EXPORT_RUNNING)
+        job_cancel = 1;
+    pthread_mutex_unlock(&job_lock);
+}
+
+void export_job_get_status(export_status_t *out)
+{
+    pthread_mutex_lock(&job_lock);
+    *out = job_status;
+    pthread_mutex_unlock(&job_lock);
+}
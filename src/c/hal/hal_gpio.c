@@ -128,15 +128,23 @@ int hal_button_wait_release(int btn)
 }
 
 // LED控制（三通道）
+static int led_state[3]; // 最近一次设置的亮灭状态
+
 void hal_led_set(int led_id, int on)
 {
     if (led_id >= 0 && led_id < 3 && led_lines[led_id]) {
         // on=1 → 亮 → 输出0
         // on=0 → 灭 → 输出1
         gpiod_line_set_value(led_lines[led_id], on ? 0 : 1);
+        led_state[led_id] = on ? 1 : 0;
     }
 }
 
+int hal_led_get(int led_id)
+{
+    return (led_id >= 0 && led_id < 3) ? led_state[led_id] : 0;
+}
+
 // 关闭所有LED（真正关掉：全部输出1）
 void hal_led_all_off(void)
 {
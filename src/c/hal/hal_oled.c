@@ -10,11 +10,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <linux/i2c-dev.h>
+#include <linux/i2c.h>
 #include <sys/ioctl.h>
 #include "hal_oled.h"
 #include <fcntl.h>
 #include <sys/syscall.h>
 #include <pthread.h>
+#include <time.h>
 #include <font.h>
 #define OLED_ADDR 0x3C
 #define I2C_BUS "/dev/i2c-7"
@@ -31,11 +33,30 @@
 typedef enum { QR_ECLEVEL_M } qrcodegen_eclevel;
 
 static int i2c_fd = -1;
+static int i2c_rdwr = 0; // 适配器支持 I2C_RDWR 组合传输
 static pthread_mutex_t i2c_mutex = PTHREAD_MUTEX_INITIALIZER;
-static uint8_t oled_buffer[OLED_WIDTH * OLED_HEIGHT / 8];
+static uint8_t oled_buffer[OLED_WIDTH * OLED_HEIGHT / 8]; // 后台缓冲：所有绘制函数的目标
+
+// ==================== 双缓冲与显示线程 ====================
+// 绘制只写后台缓冲；hal_oled_refresh 把完整的一帧拷到前台帧并通知显示线程，立即返回
+// 显示线程是唯一的 I2C 发送方，总是发送最新发布的帧，跟不上时中间帧被合并掉
+// begin/end_frame 之间的 refresh 不发布，整帧绘制完成后只交换一次，屏幕上不会出现半帧
+static uint8_t oled_front[OLED_WIDTH * OLED_HEIGHT / 8]; // 最近发布的完整帧
+static pthread_mutex_t frame_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t frame_cond = PTHREAD_COND_INITIALIZER; // 有新帧 / 有帧发送完成
+static unsigned frame_seq = 0;  // 已发布的帧序号
+static unsigned frame_sent = 0; // 已发送到屏幕的帧序号
+static int frame_depth = 0;     // begin_frame 嵌套深度
+static int frame_failed = 0;    // 最近一次发送失败，屏幕内容不确定
+static int display_running = 0;
+static pthread_t display_tid;
+
 // 内部函数前置声明
 static void oled_send_command(uint8_t cmd);
 static void oled_send_data(const uint8_t *data, size_t len);
+static int oled_push(const uint8_t *frame);
+static void *oled_display_thread(void *arg);
+static void oled_publish_locked(void);
 
 int hal_oled_init(void)
 {
@@ -58,6 +79,12 @@ int hal_oled_init(void)
         return -1;
     }
 
+    // 检查适配器是否支持组合传输
+    unsigned long funcs = 0;
+    i2c_rdwr = ioctl(i2c_fd, I2C_FUNCS, &funcs) == 0 && (funcs & I2C_FUNC_I2C);
+    if (!i2c_rdwr)
+        printf("OLED：I2C 适配器不支持 I2C_RDWR，逐条写入\n");
+
     // 4. SSD1306 初始化序列（保持原有）
     uint8_t init[] = {
         0x00, 0xAE, 0xD5, 0x80, 0xA8, 0x3F, 0xD3, 0x00, 0x40,
@@ -65,10 +92,20 @@ int hal_oled_init(void)
         0xD9, 0xF1, 0xDB, 0x40, 0xA4, 0xA6, 0xAF};
     write(i2c_fd, init, sizeof(init));
 
-    // 5. 清空屏幕
+    // 5. 启动显示线程并清空屏幕
+    display_running = 1;
+    if (pthread_create(&display_tid, NULL, oled_display_thread, NULL) != 0)
+    {
+        printf("错误：无法创建 OLED 显示线程，改为在刷新时同步发送\n");
+        display_running = 0;
+    }
+    // 上电后显存内容随机，第一帧不论是否有变化都整屏发送
     memset(oled_buffer, 0, sizeof(oled_buffer));
-    hal_oled_clear();
-    hal_oled_refresh();
+    pthread_mutex_lock(&frame_lock);
+    memset(oled_front, 0, sizeof(oled_front));
+    frame_seq++;
+    oled_publish_locked();
+    pthread_mutex_unlock(&frame_lock);
 
     printf("OLED 初始化完成\n");
     return 0;
@@ -175,28 +212,286 @@ void hal_oled_draw_progress_bar(int x, int y, int width, int percent, const char
     snprintf(percent_str, sizeof(percent_str), "%d%%", percent);
     hal_oled_string(x + width + 4, bar_y - 1, percent_str);
 }
-void hal_oled_refresh(void)
+// ==================== 脏区增量发送 ====================
+// 与上一次实际发出的帧逐页比较，每页只发送首尾变化列之间的区间
+// 初始化序列已设为水平寻址模式，用 0x21/0x22 设置列/页窗口后连续写数据
+// 画面不变时不产生任何总线传输；时钟跳一格通常只有一两页的几个字节
+//
+// 一帧的所有消息合成一次 ioctl(I2C_RDWR)（消息间为重复起始，不释放总线），每帧一次系统调用
+// 脏区总字节数不少于整屏时改为整屏突发：一条 0~127 列 / 0~7 页窗口命令 + 一条 1025 字节数据
+// 整屏突发约 1034 字节（含地址字节），每字节 9 个时钟，理论上限约为：
+//   400kHz：23.3ms/帧，约 43 帧/秒    1MHz：9.3ms/帧，约 107 帧/秒（SSD1306 标称 400kHz，1MHz 属超频）
+// 实际值受适配器驱动开销影响，初始化后的第一帧会打印实测耗时
+// 适配器不支持 I2C_RDWR（仅 SMBus）时退回逐条 write()
+#define OLED_FRAME_BYTES (OLED_WIDTH * OLED_HEIGHT / 8)
+#define OLED_WINDOW_BYTES 7                                      // 0x00 + 0x21 c0 c1 + 0x22 p0 p1
+#define OLED_FULL_BYTES (OLED_WINDOW_BYTES + 1 + OLED_FRAME_BYTES) // 整屏突发的总字节数
+#define OLED_MAX_MSGS 16                                         // 8 页 × (窗口 + 数据)
+#define OLED_RETRY_MIN_MS 100                                    // 发送失败后首次重发间隔
+#define OLED_RETRY_MAX_MS 5000                                   // 重发间隔上限
+
+static uint8_t oled_shadow[OLED_FRAME_BYTES]; // 屏幕上当前的内容（i2c_mutex 保护）
+static int shadow_valid = 0; // 0 时下一帧整屏发送（初始化后 / 发送失败后）
+
+// 一帧待发送的消息（i2c_mutex 保护）
+typedef struct
 {
-    if (i2c_fd < 0)
-        return;
+    struct i2c_msg msgs[OLED_MAX_MSGS];
+    int count;
+    uint8_t buf[8 * (OLED_WINDOW_BYTES + 1 + OLED_WIDTH)]; // 逐页发送的最坏情况，大于整屏突发
+    size_t used;
+} oled_batch_t;
+
+static uint8_t *batch_add(oled_batch_t *b, size_t len)
+{
+    uint8_t *p = b->buf + b->used;
+    b->msgs[b->count].addr = OLED_ADDR;
+    b->msgs[b->count].flags = 0;
+    b->msgs[b->count].len = len;
+    b->msgs[b->count].buf = p;
+    b->count++;
+    b->used += len;
+    return p;
+}
+
+static void batch_window(oled_batch_t *b, int col0, int col1, int page0, int page1)
+{
+    uint8_t *p = batch_add(b, OLED_WINDOW_BYTES);
+    p[0] = 0x00;
+    p[1] = 0x21;
+    p[2] = col0;
+    p[3] = col1;
+    p[4] = 0x22;
+    p[5] = page0;
+    p[6] = page1;
+}
+
+static void batch_data(oled_batch_t *b, const uint8_t *data, size_t len)
+{
+    uint8_t *p = batch_add(b, len + 1);
+    p[0] = 0x40;
+    memcpy(p + 1, data, len);
+}
+
+static int batch_send(const oled_batch_t *b)
+{
+    if (b->count == 0)
+        return 0;
+    if (i2c_rdwr)
+    {
+        struct i2c_rdwr_ioctl_data xfer = {(struct i2c_msg *)b->msgs, b->count};
+        return ioctl(i2c_fd, I2C_RDWR, &xfer) == b->count ? 0 : -1;
+    }
+    for (int i = 0; i < b->count; i++)
+    {
+        if (write(i2c_fd, b->msgs[i].buf, b->msgs[i].len) != (ssize_t)b->msgs[i].len)
+            return -1;
+    }
+    return 0;
+}
+
+// 发送一帧的变化部分（显示线程调用；线程未运行时由刷新方在 frame_lock 下调用）
+static int oled_push(const uint8_t *frame)
+{
+    static oled_batch_t batch;
+    static int timed = 0; // 是否已打印整屏实测耗时
 
     pthread_mutex_lock(&i2c_mutex);
+    if (i2c_fd < 0)
+    {
+        pthread_mutex_unlock(&i2c_mutex);
+        return 0;
+    }
 
-    // 使用更大的数据块传输，减少I2C命令开销
+    // 1. 逐页找变化区间
+    int col0[8], col1[8];
+    size_t bytes = 0;
     for (int page = 0; page < 8; page++)
     {
-        // 设置页地址和列地址（一次写入）
-        uint8_t cmd[3] = {0x00, 0xB0 + page, 0x00};
-        write(i2c_fd, cmd, 3);
-        write(i2c_fd, (uint8_t[]){0x00, 0x10}, 2); // 高列地址
-
-        // 发送整页数据（128字节），减少分块次数
-        uint8_t data[129] = {0x40};
-        memcpy(&data[1], &oled_buffer[page * 128], 128);
-        write(i2c_fd, data, 129);
+        const uint8_t *row = &frame[page * OLED_WIDTH];
+        const uint8_t *old = &oled_shadow[page * OLED_WIDTH];
+        col0[page] = 0;
+        col1[page] = OLED_WIDTH - 1;
+        if (shadow_valid)
+        {
+            while (col0[page] < OLED_WIDTH && row[col0[page]] == old[col0[page]])
+                col0[page]++;
+            if (col0[page] == OLED_WIDTH)
+            {
+                col0[page] = -1; // 本页无变化
+                continue;
+            }
+            while (row[col1[page]] == old[col1[page]])
+                col1[page]--;
+        }
+        bytes += OLED_WINDOW_BYTES + 1 + (col1[page] - col0[page] + 1);
+    }
+    if (bytes == 0)
+    {
+        pthread_mutex_unlock(&i2c_mutex);
+        return 0;
+    }
+
+    // 2. 组装消息：整屏突发或逐页区间
+    batch.count = 0;
+    batch.used = 0;
+    int full = bytes >= OLED_FULL_BYTES;
+    if (full)
+    {
+        batch_window(&batch, 0, OLED_WIDTH - 1, 0, 7);
+        batch_data(&batch, frame, OLED_FRAME_BYTES);
+    }
+    else
+    {
+        for (int page = 0; page < 8; page++)
+        {
+            if (col0[page] < 0)
+                continue;
+            batch_window(&batch, col0[page], col1[page], page, page);
+            batch_data(&batch, &frame[page * OLED_WIDTH + col0[page]], col1[page] - col0[page] + 1);
+        }
+    }
+
+    // 3. 一次发送
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int ok = batch_send(&batch) == 0;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (ok && full && !timed)
+    {
+        double ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+        printf("[OLED] Full frame %zu bytes in %.1f ms (%s, max %.0f fps)\n",
+               batch.used, ms, i2c_rdwr ? "I2C_RDWR" : "write", ms > 0 ? 1000 / ms : 0);
+        timed = 1;
     }
 
+    // 发送失败时屏幕内容不确定，下一帧整屏重发
+    if (ok)
+        memcpy(oled_shadow, frame, sizeof(oled_shadow));
+    shadow_valid = ok;
     pthread_mutex_unlock(&i2c_mutex);
+    return ok ? 0 : -1;
+}
+
+// 计算 ms 毫秒后的绝对时间（pthread_cond_timedwait 使用 CLOCK_REALTIME）
+static void deadline_after(struct timespec *ts, int ms)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (long)(ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000)
+    {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static void *oled_display_thread(void *arg)
+{
+    (void)arg;
+    uint8_t frame[sizeof(oled_front)];
+
+    int backoff_ms = 0; // 非 0 时上次发送失败，到期后重发最后一帧
+    pthread_mutex_lock(&frame_lock);
+    while (1)
+    {
+        int retry = 0;
+        struct timespec deadline;
+        if (backoff_ms)
+            deadline_after(&deadline, backoff_ms);
+        while (display_running && frame_sent == frame_seq && !retry)
+        {
+            if (!backoff_ms)
+                pthread_cond_wait(&frame_cond, &frame_lock);
+            else if (pthread_cond_timedwait(&frame_cond, &frame_lock, &deadline) != 0)
+                retry = 1;
+        }
+        // 退出前先把最后一帧发完
+        if (frame_sent == frame_seq && !retry)
+            break;
+
+        unsigned seq = frame_seq;
+        memcpy(frame, oled_front, sizeof(frame));
+        pthread_mutex_unlock(&frame_lock);
+
+        // 画面静止时不会再有新帧，失败后按退避间隔重发，直到屏幕恢复
+        int ok = oled_push(frame) == 0;
+        if (ok)
+            backoff_ms = 0;
+        else
+            backoff_ms = backoff_ms ? (backoff_ms * 2 > OLED_RETRY_MAX_MS ? OLED_RETRY_MAX_MS : backoff_ms * 2)
+                                    : OLED_RETRY_MIN_MS;
+
+        pthread_mutex_lock(&frame_lock);
+        frame_sent = seq;
+        frame_failed = !ok;
+        pthread_cond_broadcast(&frame_cond);
+    }
+    pthread_mutex_unlock(&frame_lock);
+    return NULL;
+}
+
+// 通知显示线程发送新帧；显示线程未运行时直接在调用线程同步发送（frame_lock 下调用）
+static void oled_publish_locked(void)
+{
+    if (display_running)
+    {
+        pthread_cond_broadcast(&frame_cond);
+        return;
+    }
+    frame_failed = oled_push(oled_front) != 0;
+    frame_sent = frame_seq;
+}
+
+// 发布后台缓冲为新的一帧，不等待 I2C；与已发布的帧相同时不唤醒显示线程
+// 同步发送模式下没有线程重试，上次发送失败时即使画面相同也重新发送
+void hal_oled_refresh(void)
+{
+    pthread_mutex_lock(&frame_lock);
+    if (frame_depth == 0 && ((!display_running && frame_failed) ||
+                             memcmp(oled_front, oled_buffer, sizeof(oled_front)) != 0))
+    {
+        memcpy(oled_front, oled_buffer, sizeof(oled_front));
+        frame_seq++;
+        oled_publish_locked();
+    }
+    pthread_mutex_unlock(&frame_lock);
+}
+
+void hal_oled_begin_frame(void)
+{
+    pthread_mutex_lock(&frame_lock);
+    frame_depth++;
+    pthread_mutex_unlock(&frame_lock);
+}
+
+void hal_oled_end_frame(void)
+{
+    pthread_mutex_lock(&frame_lock);
+    if (frame_depth > 0)
+        frame_depth--;
+    pthread_mutex_unlock(&frame_lock);
+    hal_oled_refresh();
+}
+
+int hal_oled_flush(int timeout_ms)
+{
+    struct timespec deadline;
+    deadline_after(&deadline, timeout_ms);
+
+    int ret = 0;
+    pthread_mutex_lock(&frame_lock);
+    unsigned target = frame_seq;
+    while (display_running && (int)(frame_sent - target) < 0)
+    {
+        if (pthread_cond_timedwait(&frame_cond, &frame_lock, &deadline) != 0)
+        {
+            ret = -1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&frame_lock);
+    return ret;
 }
 
 void hal_oled_line(int x0, int y0, int x1, int y1)
@@ -331,6 +626,15 @@ void hal_oled_draw_large_string(int x0, int y0, const char *str) {
 
 void hal_oled_cleanup(void)
 {
+    // 停止显示线程（已发布的最后一帧会先发完）
+    pthread_mutex_lock(&frame_lock);
+    int running = display_running;
+    display_running = 0;
+    pthread_cond_broadcast(&frame_cond);
+    pthread_mutex_unlock(&frame_lock);
+    if (running)
+        pthread_join(display_tid, NULL);
+
     pthread_mutex_lock(&i2c_mutex);
     if (i2c_fd >= 0)
     {
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "menu.h"
 #include "hal_oled.h"
 #include "hal_dht11.h"
@@ -24,6 +25,8 @@ menu_item_t *menu_current = NULL;
 static int menu_cursor = 0;
 int menu_list_active = 0;
 static int dashboard_last_cursor = 0;
+// 菜单状态锁：按键线程的事件处理与主循环的绘制互斥，绘制只写内存缓冲，持锁期间不会等待 I2C
+static pthread_mutex_t menu_lock = PTHREAD_MUTEX_INITIALIZER;
 
 void menu_init(void)
 {
@@ -35,6 +38,7 @@ void menu_init(void)
     menu_add_child(menu_root, page_network_create_menu());
     menu_add_child(menu_root, page_tools_create_menu());
     menu_add_child(menu_root, page_advanced_analysis_create_menu());
+    menu_add_child(menu_root, page_forecast_create_menu());
     menu_current = menu_root;
     menu_cursor = 0;
     dashboard_last_cursor = 0;
@@ -75,7 +79,7 @@ void menu_add_child(menu_item_t *parent, menu_item_t *child)
     parent->child_count++;
 }
 
-void menu_handle_event(event_t ev)
+static void handle_event_locked(event_t ev)
 {
     // 1. 优先让屏保处理事件
     if (screensaver_handle_event(ev))
@@ -186,17 +190,21 @@ static void draw_single_icon(void)
     hal_oled_string(text_x, base_y + ICON_SIZE + 5, item->name);
 }
 
-void menu_render(void)
+void menu_handle_event(event_t ev)
+{
+    pthread_mutex_lock(&menu_lock);
+    handle_event_locked(ev);
+    pthread_mutex_unlock(&menu_lock);
+}
+
+static void render_locked(void)
 {
     // 1. 调用screensaver_draw更新屏保状态（必要步骤）
     screensaver_draw();
 
     // 2. 如果屏保激活，直接返回（已绘制屏保内容）
     if (screensaver_is_active())
-    {
-        hal_oled_refresh();
         return;
-    }
 
     // 3. 非屏保状态：绘制菜单
     if (!menu_current)
@@ -239,7 +247,16 @@ void menu_render(void)
             menu_current->draw_func();
         }
     }
-    hal_oled_refresh();
+}
+
+// 绘制一帧：页面内部的 refresh 被合并，整帧画完后只交换一次
+void menu_render(void)
+{
+    pthread_mutex_lock(&menu_lock);
+    hal_oled_begin_frame();
+    render_locked();
+    hal_oled_end_frame();
+    pthread_mutex_unlock(&menu_lock);
 }
 
 menu_item_t *menu_get_current(void)
@@ -1,12 +1,13 @@
 #include "menu.h"
 #include "hal_oled.h"
-#include "cpp/advanced_analysis.h"
+#include "analysis_worker.h"
 #include <stdio.h>
 #include <string.h>
 #include <font.h>
 #include <stdlib.h>
 
 static int analysis_ready = 0;
+static unsigned analysis_ticket = 0; // 后台任务票据，0 表示未提交
 static int analysis_page = 0;
 static int total_pages = 0;
 static char report_buffer[2048] = {0};
@@ -60,7 +61,8 @@ static void update_display_lines(void)
     }
 }
 
-static void perform_analysis(void)
+// 读取后台任务发布的报告
+static void load_analysis_result(int ok)
 {
     memset(report_buffer, 0, sizeof(report_buffer));
     memset(display_lines, 0, sizeof(display_lines));
@@ -75,7 +77,7 @@ static void perform_analysis(void)
     }
     line_count = 0;
 
-    if (perform_advanced_analysis(report_buffer, sizeof(report_buffer)) == 0)
+    if (ok && analysis_get_report(report_buffer, sizeof(report_buffer)) == 0)
     {
         parse_report_lines(report_buffer);
         update_display_lines();
@@ -92,12 +94,25 @@ static void page_advanced_analysis_draw(void)
 {
     if (!analysis_ready)
     {
-        hal_oled_clear();
-        hal_oled_string(0, 0, "Advanced Analysis");
-        hal_oled_line(0, 10, 127, 10);
-        hal_oled_string(10, 30, "Analyzing...");
-        hal_oled_refresh();
-        perform_analysis();
+        // 提交（或合并到进行中的）后台分析，绘制线程只轮询状态
+        if (!analysis_ticket)
+            analysis_ticket = analysis_submit(ANALYSIS_JOB_REPORT);
+
+        int progress = 0;
+        analysis_state_t state = analysis_poll(ANALYSIS_JOB_REPORT, analysis_ticket, &progress);
+        if (state != ANALYSIS_DONE && state != ANALYSIS_FAILED)
+        {
+            char msg[24];
+            snprintf(msg, sizeof(msg), "Analyzing... %d%%", progress);
+            hal_oled_clear();
+            hal_oled_string(0, 0, "Advanced Analysis");
+            hal_oled_line(0, 10, 127, 10);
+            hal_oled_string(10, 30, msg);
+            hal_oled_refresh();
+            return;
+        }
+        analysis_ticket = 0;
+        load_analysis_result(state == ANALYSIS_DONE);
     }
 
     hal_oled_clear();
@@ -163,6 +178,7 @@ static void page_advanced_analysis_handle_event(event_t ev)
         }
         line_count = 0;
         analysis_ready = 0;
+        analysis_ticket = 0;
         analysis_page = 0;
         menu_back();
         break;
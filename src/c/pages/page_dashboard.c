@@ -133,8 +133,7 @@ static void draw_local(void)
 void page_dashboard_draw(void)
 {
     hal_oled_clear();
-    draw_local(); // 只画本地页面
-    hal_oled_refresh();
+    draw_local(); // 只画本地页面；由 menu_render 统一交换
 }
 
 void page_dashboard_handle_event(event_t ev)
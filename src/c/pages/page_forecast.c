@@ -0,0 +1,135 @@
+#include "menu.h"
+#include "hal_oled.h"
+#include "analysis_worker.h"
+#include <stdio.h>
+#include <string.h>
+
+#define LINES_PER_PAGE 5
+#define FORECAST_LINES (STATS_FORECAST_HORIZON + 1) // 首行误差 + 每小时一行
+
+static int forecast_ready = 0;       // 0 未加载，1 已加载，-1 无结果
+static unsigned forecast_ticket = 0; // 后台任务票据，0 表示未提交
+static int forecast_page = 0;
+static char lines[FORECAST_LINES][24];
+static int line_count = 0;
+
+static int total_pages(void)
+{
+    int pages = (line_count + LINES_PER_PAGE - 1) / LINES_PER_PAGE;
+    return pages > 0 ? pages : 1;
+}
+
+// 读取后台任务发布的预测，整理成显示行
+static void load_forecast_result(int ok)
+{
+    stats_forecast_t f;
+    memset(lines, 0, sizeof(lines));
+    line_count = 0;
+    forecast_page = 0;
+
+    if (!ok || analysis_get_forecast(&f) != 0)
+    {
+        strcpy(lines[0], "Not enough data");
+        line_count = 1;
+        forecast_ready = -1;
+        return;
+    }
+
+    snprintf(lines[line_count++], sizeof(lines[0]), "Err T%.2f H%.1f%s",
+             f.temp_rmse, f.humi_rmse, f.exo_used ? " +Out" : "");
+    for (int i = 0; i < STATS_FORECAST_HORIZON; i++)
+    {
+        // 最宽 21 列（128 / 6），如 "+24h 23:00 -10.5C100%"
+        snprintf(lines[line_count++], sizeof(lines[0]), "%+3dh %02d:00%6.1fC%3.0f%%",
+                 i + 1, (f.origin_hour + i + 1) % 24, f.temp[i], f.humi[i]);
+    }
+    forecast_ready = 1;
+}
+
+static void page_forecast_draw(void)
+{
+    if (!forecast_ready)
+    {
+        // 提交（或合并到进行中的）后台预测，绘制线程只轮询状态
+        if (!forecast_ticket)
+            forecast_ticket = analysis_submit(ANALYSIS_JOB_FORECAST);
+
+        int progress = 0;
+        analysis_state_t state = analysis_poll(ANALYSIS_JOB_FORECAST, forecast_ticket, &progress);
+        if (state != ANALYSIS_DONE && state != ANALYSIS_FAILED)
+        {
+            char msg[24];
+            snprintf(msg, sizeof(msg), "Forecasting... %d%%", progress);
+            hal_oled_clear();
+            hal_oled_string(0, 0, "Forecast");
+            hal_oled_line(0, 10, 127, 10);
+            hal_oled_string(10, 30, msg);
+            hal_oled_refresh();
+            return;
+        }
+        forecast_ticket = 0;
+        load_forecast_result(state == ANALYSIS_DONE);
+    }
+
+    hal_oled_clear();
+    hal_oled_string(0, 0, "Forecast");
+    hal_oled_line(0, 10, 127, 10);
+
+    // 页码指示
+    char page_indicator[16];
+    snprintf(page_indicator, sizeof(page_indicator), "%d/%d", forecast_page + 1, total_pages());
+    hal_oled_string(128 - strlen(page_indicator) * 6, 0, page_indicator);
+
+    int y = 14;
+    for (int i = forecast_page * LINES_PER_PAGE; i < line_count && i < (forecast_page + 1) * LINES_PER_PAGE; i++)
+    {
+        hal_oled_string(0, y, lines[i]);
+        y += 10;
+    }
+
+    hal_oled_refresh();
+}
+
+static void page_forecast_handle_event(event_t ev)
+{
+    switch (ev)
+    {
+    case EV_UP:
+        if (forecast_page > 0)
+            forecast_page--;
+        break;
+    case EV_DOWN:
+        if (forecast_page < total_pages() - 1)
+            forecast_page++;
+        break;
+    case EV_ENTER:
+        // 重新预测
+        forecast_ready = 0;
+        forecast_ticket = 0;
+        break;
+    case EV_BACK:
+        forecast_ready = 0;
+        forecast_ticket = 0;
+        forecast_page = 0;
+        menu_back();
+        break;
+    default:
+        break;
+    }
+}
+
+void page_forecast_init(void)
+{
+    static int init = 0;
+    if (init)
+        return;
+    page_register("Forecast", page_forecast_draw, page_forecast_handle_event);
+    init = 1;
+}
+
+menu_item_t *page_forecast_create_menu(void)
+{
+    page_forecast_init();
+    extern const unsigned char icon_data_analyzer_28x28[]; // 与分析页共用图标
+    return menu_create("Forecast", page_forecast_draw, icon_data_analyzer_28x28);
+}
@@ -5,7 +5,6 @@
 #include <pthread.h>
 #include <dirent.h>
 #include <sys/stat.h>
-#include <sys/mount.h>
 #include <errno.h>
 #include <math.h>
 #include "hal_oled.h"
@@ -13,13 +12,15 @@
 #include "menu.h"
 #include "font.h"
 #include "db_helper.h"
+#include "analysis_worker.h"
+#include "export_job.h"
 #include "mqtt_client.h"
 
 #define OLED_WIDTH 128
 #define CHAR_WIDTH 6
 #define EXPORT_LIST_MAX 8
 #define PREVIEW_ROWS 4
-#define USB_MOUNT_POINT "/mnt/usb"
+#define PREVIEW_CACHE_ROWS (PREVIEW_ROWS * 5) // 当前页及上下各两页
 #define CONTROL_TOPIC "device/control"
 
 typedef enum
@@ -49,6 +50,7 @@ static char popup_title[32] = {0};
 static char popup_line1[128] = {0};
 static char popup_line2[128] = {0};
 static char popup_line3[300] = {0};
+static const char *popup_footer = "BACK: Exit";
 
 static int export_sel_idx = 0;
 static int export_disp_cnt = 0;
@@ -56,30 +58,33 @@ static db_table_info_t export_tables[EXPORT_LIST_MAX];
 static int export_first_enter = 1;
 
 static int export_view_mode = 0;
-static int export_preview_offset = 0;
+static int export_popup_stage = 0;             // 0 选择格式，1 导出进度/结果
+static export_format_t export_fmt = EXPORT_XLSX;
 static int export_preview_sel_idx = 0;
 static int export_preview_dirty = 1;
-static db_preview_row_t export_preview_data[PREVIEW_ROWS];
-static int export_preview_count = 0;
-
-typedef struct
-{
-    int count;
-    double temp_mean, temp_std, temp_min, temp_max;
-    double humi_mean, humi_std, humi_min, humi_max;
-    double corr_pearson;
-    double thi_mean;
-    int temp_anom_3sigma, humi_anom_3sigma;
-    double temp_trend_per_day;
-    double humi_trend_per_day; // 新增
-    char comfort_grade[16];
-    char comfort_suggestion[32];
-} analysis_result_t;
+static db_preview_row_t export_preview_cache[PREVIEW_CACHE_ROWS]; // 按 id 倒序的连续窗口
+static int export_preview_cached = 0;                             // 缓存行数
+static int export_preview_pos = 0;                                // 当前页首行在缓存中的下标
+static int export_preview_at_newest = 0;                          // 缓存首行即最新一行
+static int export_preview_at_oldest = 0;                          // 缓存末行即最早一行
+static unsigned export_preview_gen = 0;                           // 缓存重置次数，丢弃重置前发起的读取
+static int export_preview_follow = 0;                             // 在顶部按上键：新读到的行直接显示在顶部
+
+// 表列表与预览缓存只由后台读取线程填充：绘制与按键只在 export_data_lock 下读写缓存，
+// 数据库查询既不进入渲染路径也不进入按键路径；查询期间不持有 export_data_lock
+#define FETCH_PREVIEW 0x1 // 补齐预览预取余量
+#define FETCH_TABLES 0x2  // 读取表列表
+#define FETCH_NEWER 0x4   // 即使已在最新处也再查一次更新的行（预览期间新写入的数据）
+static pthread_mutex_t export_data_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t export_fetch_cond = PTHREAD_COND_INITIALIZER;
+static int export_fetch_pending = 0; // 待执行的 FETCH_* 请求（export_data_lock 保护）
+static int export_tables_loaded = 0; // 表列表已读取完成
 
 static int analysis_page = 0;        // 当前页码 (0-based)
 static int analysis_total_pages = 4; // 固定4页
-static analysis_result_t analysis_res = {0};
+static stats_result_t analysis_res = {0};
 static int analysis_ready = 0;             // 0未分析，1成功，-1失败
+static unsigned analysis_ticket = 0;       // 后台任务票据，0 表示未提交
 static char analysis_display_lines[4][24]; // 每页最多4行，每行最多20字符
 
 extern menu_item_t *menu_current;
@@ -205,8 +210,62 @@ static void set_system_mode(system_mode_t mode)
 }
 
 // ====================== 导出弹窗 ======================
+// 先选择格式，再轮询后台导出任务的进度；导出线程负责挂载、写文件与卸载，界面不阻塞
+static void export_popup_fill(void)
+{
+    const char *desc = export_preview_sel_idx < export_disp_cnt ? export_tables[export_preview_sel_idx].desc : "";
+    static const char *fmt_names[EXPORT_FORMAT_COUNT] = {"Excel (.xlsx)", "CSV (.csv)", "CSV gzip (.csv.gz)"};
+
+    if (export_popup_stage == 0)
+    {
+        strcpy(popup_title, "Export Format");
+        snprintf(popup_line1, sizeof(popup_line1), "%s", desc);
+        snprintf(popup_line2, sizeof(popup_line2), "> %s", fmt_names[export_fmt]);
+        strcpy(popup_line3, "UP/DOWN: Format");
+        popup_footer = "ENT:Start BACK:Ret";
+        return;
+    }
+
+    export_status_t st;
+    export_job_get_status(&st);
+    popup_footer = st.state == EXPORT_RUNNING ? "BACK: Cancel" : "BACK: Exit";
+    snprintf(popup_line1, sizeof(popup_line1), "%s", desc);
+    switch (st.state)
+    {
+    case EXPORT_RUNNING:
+        strcpy(popup_title, "Exporting...");
+        if (st.total > 0)
+            snprintf(popup_line2, sizeof(popup_line2), "%d/%d %d%%", st.rows, st.total,
+                     st.rows >= st.total ? 99 : st.rows * 100 / st.total);
+        else
+            snprintf(popup_line2, sizeof(popup_line2), "%d rows", st.rows);
+        popup_line3[0] = 0;
+        break;
+    case EXPORT_DONE:
+        strcpy(popup_title, "Export Done");
+        snprintf(popup_line2, sizeof(popup_line2), "%d rows %s", st.rows, st.to_usb ? "to USB" : "Local");
+        snprintf(popup_line3, sizeof(popup_line3), "%s", st.path);
+        break;
+    case EXPORT_CANCELLED:
+        strcpy(popup_title, "Export Cancelled");
+        snprintf(popup_line2, sizeof(popup_line2), "Stopped at %d rows", st.rows);
+        popup_line3[0] = 0;
+        break;
+    default:
+        strcpy(popup_title, "Export Failed");
+        snprintf(popup_line2, sizeof(popup_line2), "Error: %s", st.msg);
+        if (st.hint[0])
+            snprintf(popup_line3, sizeof(popup_line3), "%s", st.hint);
+        else
+            strcpy(popup_line3, st.to_usb ? "USB write failed" : "Local write failed");
+        break;
+    }
+}
+
 static void page_export_popup_draw(void)
 {
+    export_popup_fill();
+
     hal_oled_clear();
     hal_oled_string(0, 0, popup_title);
     hal_oled_line(0, 10, 127, 10);
@@ -216,14 +275,45 @@ static void page_export_popup_draw(void)
         hal_oled_string(0, 34, popup_line2);
     if (popup_line3[0])
         hal_oled_string(0, 48, popup_line3);
-    hal_oled_string(0, 56, "BACK: Exit");
+    hal_oled_string(0, 56, popup_footer);
     hal_oled_refresh();
 }
 
 static void page_export_popup_handle_event(event_t ev)
 {
+    if (export_popup_stage == 0)
+    {
+        switch (ev)
+        {
+        case EV_UP:
+            export_fmt = (export_fmt + EXPORT_FORMAT_COUNT - 1) % EXPORT_FORMAT_COUNT;
+            break;
+        case EV_DOWN:
+            export_fmt = (export_fmt + 1) % EXPORT_FORMAT_COUNT;
+            break;
+        case EV_ENTER:
+            // 已有导出在运行时直接显示其进度
+            export_job_start(export_tables[export_preview_sel_idx].name,
+                             export_tables[export_preview_sel_idx].count,
+                             !export_tables[export_preview_sel_idx].approx, export_fmt);
+            export_popup_stage = 1;
+            break;
+        case EV_BACK:
+            menu_back(); // 回到预览
+            break;
+        }
+        return;
+    }
+
     if (ev == EV_BACK)
     {
+        export_status_t st;
+        export_job_get_status(&st);
+        if (st.state == EXPORT_RUNNING)
+        {
+            export_job_cancel(); // 等导出线程清理完毕后再退出
+            return;
+        }
         export_view_mode = 0;
         export_first_enter = 1;
         menu_back();
@@ -332,59 +422,31 @@ static void page_restart_ui_handle_event(event_t ev)
     }
 }
 
-// ====================== USB 检测与挂载 ======================
-static void safe_umount(const char *path)
-{
-    if (access(path, F_OK) == 0)
-    {
-        if (umount(path) != 0)
-        {
-            umount2(path, MNT_FORCE);
-        }
-    }
-}
-
-static int find_usb_mountpoint(char *out, int out_len)
-{
-    if (access("/mnt/usb", W_OK) == 0)
-    {
-        strncpy(out, "/mnt/usb", out_len - 1);
-        out[out_len - 1] = '\0';
-        return 0;
-    }
-    system("sudo mkdir -p /mnt/usb");
-    system("sudo mount /dev/sdb1 /mnt/usb 2>/dev/null");
-    if (access("/mnt/usb", W_OK) == 0)
-    {
-        strncpy(out, "/mnt/usb", out_len - 1);
-        out[out_len - 1] = '\0';
-        return 0;
-    }
-    system("sudo mount /dev/sdc1 /mnt/usb 2>/dev/null");
-    if (access("/mnt/usb", W_OK) == 0)
-    {
-        strncpy(out, "/mnt/usb", out_len - 1);
-        out[out_len - 1] = '\0';
-        return 0;
-    }
-    return -1;
-}
-
 // ====================== 导出列表 ======================
+static void export_request_fetch(int what); // 后台读取请求（export_data_lock 下调用）
+
 static void page_export_list_draw(void)
 {
+    pthread_mutex_lock(&export_data_lock);
     if (export_first_enter)
     {
-        export_disp_cnt = db_get_table_list(export_tables, EXPORT_LIST_MAX);
+        // 表列表由后台线程读取，这里只发请求
+        export_disp_cnt = 0;
+        export_tables_loaded = 0;
         export_sel_idx = 0;
         export_first_enter = 0;
+        export_request_fetch(FETCH_TABLES);
     }
 
     hal_oled_clear();
     hal_oled_string(0, 0, "Export Data");
     hal_oled_line(0, 10, 127, 10);
 
-    if (export_disp_cnt == 0)
+    if (!export_tables_loaded)
+    {
+        hal_oled_string(10, 30, "Loading...");
+    }
+    else if (export_disp_cnt == 0)
     {
         hal_oled_string(10, 30, "No tables");
     }
@@ -394,19 +456,21 @@ static void page_export_list_draw(void)
         for (int i = 0; i < export_disp_cnt && i < 4; i++)
         {
             char line[40];
-            snprintf(line, sizeof(line), "%s %s(%d)",
+            snprintf(line, sizeof(line), "%s %s(%s%d)",
                      (i == export_sel_idx) ? ">" : " ",
-                     export_tables[i].desc, export_tables[i].count);
+                     export_tables[i].desc, export_tables[i].approx ? "~" : "", export_tables[i].count);
             hal_oled_string(0, y, line);
             y += 10;
         }
     }
     hal_oled_string(0, 56, "ENT:View BACK:Ret");
     hal_oled_refresh();
+    pthread_mutex_unlock(&export_data_lock);
 }
 
 static void page_export_list_handle_event(event_t ev)
 {
+    pthread_mutex_lock(&export_data_lock); // export_disp_cnt 由后台线程写入
     switch (ev)
     {
     case EV_UP:
@@ -424,7 +488,6 @@ static void page_export_list_handle_event(event_t ev)
             break;
         export_preview_sel_idx = export_sel_idx;
         export_view_mode = 1;
-        export_preview_offset = 0;
         export_preview_dirty = 1;
         break;
     case EV_BACK:
@@ -432,18 +495,158 @@ static void page_export_list_handle_event(event_t ev)
         menu_back();
         break;
     }
+    pthread_mutex_unlock(&export_data_lock);
 }
 
 // ====================== 导出预览（已修改：不显示序号） ======================
+// 以上一页/下一页边界行的 id 为游标按键集取数，翻页代价与位置无关；
+// 当前页上下各预取一页，由后台读取线程完成，翻页直接命中缓存
+static const char *preview_table(void)
+{
+    return export_preview_sel_idx < export_disp_cnt ? export_tables[export_preview_sel_idx].name : NULL;
+}
+
+// 在缓存末尾追加一页更早的行，缓存满时丢弃最前面的行（export_data_lock 下调用）
+static void preview_merge_older(const db_preview_row_t *page, int n)
+{
+    if (n < PREVIEW_ROWS)
+        export_preview_at_oldest = 1;
+
+    int excess = export_preview_cached + n - PREVIEW_CACHE_ROWS;
+    if (excess > 0)
+    {
+        int drop = excess < export_preview_pos ? excess : export_preview_pos;
+        memmove(export_preview_cache, export_preview_cache + drop,
+                (export_preview_cached - drop) * sizeof(export_preview_cache[0]));
+        export_preview_cached -= drop;
+        export_preview_pos -= drop;
+        export_preview_at_newest = 0;
+        if (n > PREVIEW_CACHE_ROWS - export_preview_cached)
+            n = PREVIEW_CACHE_ROWS - export_preview_cached;
+    }
+    memcpy(export_preview_cache + export_preview_cached, page, n * sizeof(page[0]));
+    export_preview_cached += n;
+    // 翻到缓存末尾等待时发现已无更早的行，退回最后一页
+    if (export_preview_pos > 0 && export_preview_pos >= export_preview_cached)
+        export_preview_pos = export_preview_cached > PREVIEW_ROWS ? export_preview_cached - PREVIEW_ROWS : 0;
+}
+
+// 在缓存前端插入一页更新的行，缓存满时丢弃末尾的行（export_data_lock 下调用）
+static void preview_merge_newer(const db_preview_row_t *page, int n)
+{
+    if (n < PREVIEW_ROWS)
+        export_preview_at_newest = 1;
+
+    int fetched = n;
+    int excess = export_preview_cached + n - PREVIEW_CACHE_ROWS;
+    if (excess > 0)
+    {
+        int spare = export_preview_cached - (export_preview_pos + PREVIEW_ROWS);
+        int drop = excess < spare ? excess : (spare > 0 ? spare : 0);
+        export_preview_cached -= drop;
+        if (drop > 0)
+            export_preview_at_oldest = 0;
+        if (n > PREVIEW_CACHE_ROWS - export_preview_cached)
+            n = PREVIEW_CACHE_ROWS - export_preview_cached;
+    }
+    memmove(export_preview_cache + n, export_preview_cache, export_preview_cached * sizeof(export_preview_cache[0]));
+    // 放不下时保留紧邻游标（id 较小）的几行
+    memcpy(export_preview_cache, page + fetched - n, n * sizeof(page[0]));
+    export_preview_cached += n;
+    // 预取时保持当前页不动；用户在顶部请求刷新时直接显示最新的行
+    if (export_preview_follow)
+        export_preview_follow = 0;
+    else
+        export_preview_pos += n;
+}
+
+// 读取一页并合并到缓存；older=1 向更早方向，0 向更新方向
+// 仅由读取线程调用；查询在 export_data_lock 之外进行，期间缓存被重置则丢弃结果
+static void preview_fetch(int older)
+{
+    pthread_mutex_lock(&export_data_lock);
+    unsigned gen = export_preview_gen;
+    char table[sizeof(export_tables[0].name)] = {0};
+    if (preview_table())
+        snprintf(table, sizeof(table), "%s", preview_table());
+    int cursor = 0;
+    int skip = !table[0] || (older ? export_preview_at_oldest : (export_preview_cached == 0));
+    if (!skip)
+        cursor = older ? (export_preview_cached ? export_preview_cache[export_preview_cached - 1].id : 0)
+                       : export_preview_cache[0].id;
+    pthread_mutex_unlock(&export_data_lock);
+
+    if (!skip)
+    {
+        db_preview_row_t page[PREVIEW_ROWS];
+        int n = db_get_preview(table, cursor, !older, page, PREVIEW_ROWS);
+        if (n < 0)
+            n = 0;
+
+        pthread_mutex_lock(&export_data_lock);
+        if (gen == export_preview_gen)
+        {
+            if (older)
+                preview_merge_older(page, n);
+            else
+                preview_merge_newer(page, n);
+        }
+        pthread_mutex_unlock(&export_data_lock);
+    }
+}
+
+static void *export_fetch_thread(void *arg)
+{
+    (void)arg;
+    while (1)
+    {
+        pthread_mutex_lock(&export_data_lock);
+        while (!export_fetch_pending)
+            pthread_cond_wait(&export_fetch_cond, &export_data_lock);
+        int what = export_fetch_pending;
+        export_fetch_pending = 0;
+        // 当前页上下各保持至少一页余量（首次进入时缓存为空，先读最新一页）
+        int older = (what & FETCH_PREVIEW) && !export_preview_at_oldest &&
+                    export_preview_cached - (export_preview_pos + PREVIEW_ROWS) < PREVIEW_ROWS;
+        int newer = ((what & FETCH_PREVIEW) && !export_preview_at_newest && export_preview_pos < PREVIEW_ROWS) ||
+                    (what & FETCH_NEWER);
+        pthread_mutex_unlock(&export_data_lock);
+
+        if (what & FETCH_TABLES)
+        {
+            db_table_info_t tables[EXPORT_LIST_MAX];
+            int n = db_get_table_list(tables, EXPORT_LIST_MAX);
+            pthread_mutex_lock(&export_data_lock);
+            memcpy(export_tables, tables, (n > 0 ? n : 0) * sizeof(tables[0]));
+            export_disp_cnt = n > 0 ? n : 0;
+            export_tables_loaded = 1;
+            pthread_mutex_unlock(&export_data_lock);
+        }
+        if (older)
+            preview_fetch(1);
+        if (newer)
+            preview_fetch(0);
+    }
+    return NULL;
+}
+
+static void export_request_fetch(int what)
+{
+    export_fetch_pending |= what;
+    pthread_cond_signal(&export_fetch_cond);
+}
+
 static void page_export_preview_draw(void)
 {
+    pthread_mutex_lock(&export_data_lock);
     if (export_preview_dirty)
     {
-        if (export_preview_sel_idx < export_disp_cnt)
-            export_preview_count = db_get_preview(
-                export_tables[export_preview_sel_idx].name,
-                export_preview_offset,
-                export_preview_data, PREVIEW_ROWS);
+        export_preview_cached = 0;
+        export_preview_pos = 0;
+        export_preview_at_newest = 1;
+        export_preview_at_oldest = 0;
+        export_preview_gen++;
+        export_preview_follow = 0;
         export_preview_dirty = 0;
     }
 
@@ -454,24 +657,31 @@ static void page_export_preview_draw(void)
     hal_oled_string(0, 0, title);
     hal_oled_line(0, 10, 127, 10);
 
-    if (export_preview_count == 0)
-        hal_oled_string(10, 30, "No data");
+    int count = export_preview_cached - export_preview_pos;
+    if (count > PREVIEW_ROWS)
+        count = PREVIEW_ROWS;
+    if (count <= 0)
+        hal_oled_string(10, 30, export_preview_at_oldest ? "No data" : "Loading...");
     else
     {
+        const db_preview_row_t *rows = export_preview_cache + export_preview_pos;
         int y = 14;
-        for (int i = 0; i < export_preview_count; i++)
+        for (int i = 0; i < count; i++)
         {
             char line[36];
             snprintf(line, sizeof(line), "%.1f %.1f %s",
-                     export_preview_data[i].temp,
-                     export_preview_data[i].humi,
-                     export_preview_data[i].ts);
+                     rows[i].temp,
+                     rows[i].humi,
+                     rows[i].ts);
             hal_oled_string(0, y, line);
             y += 10;
         }
     }
     hal_oled_string(0, 56, "ENT:Export BACK:Ret");
     hal_oled_refresh();
+
+    export_request_fetch(FETCH_PREVIEW);
+    pthread_mutex_unlock(&export_data_lock);
 }
 
 static void page_export_preview_handle_event(event_t ev)
@@ -479,85 +689,33 @@ static void page_export_preview_handle_event(event_t ev)
     switch (ev)
     {
     case EV_UP:
-        export_preview_offset = (export_preview_offset >= PREVIEW_ROWS) ? export_preview_offset - PREVIEW_ROWS : 0;
-        export_preview_dirty = 1;
+        // 只在缓存内移动；已在顶部时请求后台查一次更新的行，读到后显示在顶部
+        pthread_mutex_lock(&export_data_lock);
+        if (export_preview_pos == 0)
+        {
+            export_preview_follow = 1;
+            export_request_fetch(FETCH_NEWER);
+        }
+        export_preview_pos = (export_preview_pos >= PREVIEW_ROWS) ? export_preview_pos - PREVIEW_ROWS : 0;
+        export_request_fetch(FETCH_PREVIEW);
+        pthread_mutex_unlock(&export_data_lock);
         break;
     case EV_DOWN:
-        export_preview_offset += PREVIEW_ROWS;
-        export_preview_dirty = 1;
+        // 预取尚未补上时翻到缓存末尾，绘制显示 Loading... 直到后台读到
+        pthread_mutex_lock(&export_data_lock);
+        if (export_preview_pos + PREVIEW_ROWS < export_preview_cached)
+            export_preview_pos += PREVIEW_ROWS;
+        else if (!export_preview_at_oldest)
+            export_preview_pos = export_preview_cached;
+        export_request_fetch(FETCH_PREVIEW);
+        pthread_mutex_unlock(&export_data_lock);
         break;
     case EV_ENTER:
-    {
         if (export_preview_sel_idx >= export_disp_cnt)
             break;
-
-        const char *desc = export_tables[export_preview_sel_idx].desc;
-        const char *name = export_tables[export_preview_sel_idx].name;
-        char usb_path[256] = {0};
-        char dest[512] = {0};
-        char msg[64] = {0};
-        int to_usb = 0;
-
-        strcpy(popup_title, "Exporting...");
-        strcpy(popup_line1, desc);
-        strcpy(popup_line2, "Please wait...");
-        popup_line3[0] = 0;
+        export_popup_stage = 0;
         menu_current = export_popup_node;
-        hal_oled_refresh();
-
-        int mount_ret = find_usb_mountpoint(usb_path, sizeof(usb_path));
-        if (mount_ret == 0)
-        {
-            snprintf(dest, sizeof(dest), "%s/%s.xlsx", usb_path, name);
-            to_usb = 1;
-        }
-        else
-        {
-            snprintf(dest, sizeof(dest), "/mnt/msata/%s.xlsx", name);
-        }
-
-        int ret = db_export_xlsx(name, dest, msg, sizeof(msg));
-        if (ret == 0 && to_usb)
-        {
-            system("sync");
-            system("sync");
-        }
-
-        if (ret == 0 && to_usb)
-        {
-            strcpy(popup_title, "Export Done");
-            snprintf(popup_line1, sizeof(popup_line1), "%s", desc);
-            snprintf(popup_line2, sizeof(popup_line2), "Saved to USB");
-            snprintf(popup_line3, sizeof(popup_line3), "Path: %s", usb_path);
-        }
-        else if (ret == 0)
-        {
-            strcpy(popup_title, "Export Done");
-            snprintf(popup_line1, sizeof(popup_line1), "%s", desc);
-            snprintf(popup_line2, sizeof(popup_line2), "Saved Local");
-            strcpy(popup_line3, "/mnt/msata");
-        }
-        else
-        {
-            strcpy(popup_title, "Export Failed");
-            snprintf(popup_line1, sizeof(popup_line1), "%s", desc);
-            snprintf(popup_line2, sizeof(popup_line2), "Error: %s", msg);
-            strcpy(popup_line3, to_usb ? "USB write failed" : "Local write failed");
-        }
-        hal_oled_refresh();
-
-        usleep(2000000);
-
-        if (to_usb)
-        {
-            safe_umount(usb_path);
-        }
-
-        export_view_mode = 0;
-        export_first_enter = 1;
-        menu_back();
         break;
-    }
     case EV_BACK:
         export_view_mode = 0;
         export_first_enter = 1;
@@ -695,61 +853,6 @@ static void page_tools_list_handle_event(event_t ev)
 }
 
 // ====================== 数据分析辅助函数 ======================
-static int cmp_double(const void *a, const void *b)
-{
-    double da = *(const double *)a, db = *(const double *)b;
-    return (da > db) - (da < db);
-}
-
-static void calc_mean_std(const double *data, int n, double *mean, double *std)
-{
-    double sum = 0.0;
-    for (int i = 0; i < n; i++)
-        sum += data[i];
-    *mean = sum / n;
-    double var = 0.0;
-    for (int i = 0; i < n; i++)
-        var += (data[i] - *mean) * (data[i] - *mean);
-    *std = sqrt(var / n);
-}
-
-static double calc_pearson(const double *x, const double *y, int n)
-{
-    double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0, sum_y2 = 0;
-    for (int i = 0; i < n; i++)
-    {
-        sum_x += x[i];
-        sum_y += y[i];
-        sum_xy += x[i] * y[i];
-        sum_x2 += x[i] * x[i];
-        sum_y2 += y[i] * y[i];
-    }
-    double denom = (n * sum_x2 - sum_x * sum_x) * (n * sum_y2 - sum_y * sum_y);
-    if (denom <= 0)
-        return 0;
-    return (n * sum_xy - sum_x * sum_y) / sqrt(denom);
-}
-
-static double calc_trend_per_day(const double *y, const double *x_days, int n)
-{
-    if (n < 2)
-        return 0;
-
-    double sum_x = 0, sum_y = 0, sum_xy = 0, sum_x2 = 0;
-    for (int i = 0; i < n; i++)
-    {
-        sum_x += x_days[i];
-        sum_y += y[i];
-        sum_xy += x_days[i] * y[i];
-        sum_x2 += x_days[i] * x_days[i];
-    }
-
-    double denominator = n * sum_x2 - sum_x * sum_x;
-    if (fabs(denominator) < 1e-9)
-        return 0;
-
-    return (n * sum_xy - sum_x * sum_y) / denominator; // 直接返回 ℃/天
-}
 static void update_analysis_display(void)
 {
     memset(analysis_display_lines, 0, sizeof(analysis_display_lines));
@@ -766,7 +869,7 @@ static void update_analysis_display(void)
         snprintf(analysis_display_lines[0], 21, "H mean: %.1f", analysis_res.humi_mean);
         snprintf(analysis_display_lines[1], 21, "H std: %.2f", analysis_res.humi_std);
         snprintf(analysis_display_lines[2], 21, "H range: %.0f-%.0f", analysis_res.humi_min, analysis_res.humi_max);
-        snprintf(analysis_display_lines[3], 21, "Corr: %.3f", analysis_res.corr_pearson);
+        snprintf(analysis_display_lines[3], 21, "Corr: %.3f", analysis_res.temp_humi_corr);
         break;
     case 2: // 第3页：THI、舒适度等级、温度异常数、湿度异常数
         snprintf(analysis_display_lines[0], 21, "THI: %.1f", analysis_res.thi_mean);
@@ -785,107 +888,16 @@ static void update_analysis_display(void)
     }
 }
 
-static void perform_data_analysis(void)
+// 读取后台任务发布的结果（全部历史，与高级分析页、邮件日报共享同一窗口结果）
+static void load_data_analysis(int ok)
 {
-    double *temp = NULL, *humi = NULL, *days = NULL;
-    int data_count = 0;
-
-    if (db_get_sensor_analysis_data(&temp, &humi, &days, &data_count) != 0 || data_count == 0)
+    stats_result_t res;
+    if (!ok || analysis_get_summary(&res) != 0)
     {
         analysis_ready = -1;
         return;
     }
 
-    analysis_result_t res = {0};
-    res.count = data_count;
-
-    calc_mean_std(temp, data_count, &res.temp_mean, &res.temp_std);
-    calc_mean_std(humi, data_count, &res.humi_mean, &res.humi_std);
-
-    res.temp_min = temp[0];
-    res.temp_max = temp[0];
-    res.humi_min = humi[0];
-    res.humi_max = humi[0];
-    for (int i = 1; i < data_count; i++)
-    {
-        if (temp[i] < res.temp_min)
-            res.temp_min = temp[i];
-        if (temp[i] > res.temp_max)
-            res.temp_max = temp[i];
-        if (humi[i] < res.humi_min)
-            res.humi_min = humi[i];
-        if (humi[i] > res.humi_max)
-            res.humi_max = humi[i];
-    }
-
-    res.corr_pearson = calc_pearson(temp, humi, data_count);
-
-    double thi_sum = 0;
-    for (int i = 0; i < data_count; i++)
-    {
-        double thi = 0.8 * temp[i] + (0.01 * humi[i]) * (0.8 * temp[i] - 14.3) + 46.3;
-        thi_sum += thi;
-    }
-    res.thi_mean = thi_sum / data_count;
-
-    if (res.thi_mean < 55)
-    {
-        strcpy(res.comfort_grade, "Cold");
-        strcpy(res.comfort_suggestion, "Warm");
-    }
-    else if (res.thi_mean < 60)
-    {
-        strcpy(res.comfort_grade, "Cool");
-        strcpy(res.comfort_suggestion, "Add clothes");
-    }
-    else if (res.thi_mean < 65)
-    {
-        strcpy(res.comfort_grade, "Comfort");
-        strcpy(res.comfort_suggestion, "Good");
-    }
-    else if (res.thi_mean < 70)
-    {
-        strcpy(res.comfort_grade, "Warm");
-        strcpy(res.comfort_suggestion, "Ventilate");
-    }
-    else if (res.thi_mean < 75)
-    {
-        strcpy(res.comfort_grade, "Hot");
-        strcpy(res.comfort_suggestion, "Fan/AC");
-    }
-    else
-    {
-        strcpy(res.comfort_grade, "Muggy");
-        strcpy(res.comfort_suggestion, "Cool down");
-    }
-
-    // 3σ异常
-    double temp_std3 = 3 * res.temp_std;
-    double humi_std3 = 3 * res.humi_std;
-    int temp_anom = 0, humi_anom = 0;
-    for (int i = 0; i < data_count; i++)
-    {
-        if (fabs(temp[i] - res.temp_mean) > temp_std3)
-            temp_anom++;
-        if (fabs(humi[i] - res.humi_mean) > humi_std3)
-            humi_anom++;
-    }
-    res.temp_anom_3sigma = temp_anom;
-    res.humi_anom_3sigma = humi_anom;
-
-    // 趋势计算（直接使用天数）
-    res.temp_trend_per_day = calc_trend_per_day(temp, days, data_count);
-    res.humi_trend_per_day = calc_trend_per_day(humi, days, data_count);
-
-    // 调试输出（可选，编译后查看控制台）
-    printf("DEBUG: Data count=%d, days range=%.2f to %.2f\n", data_count, days[0], days[data_count - 1]);
-    printf("DEBUG: Temp trend=%.4f C/day, Humi trend=%.4f %%/day\n",
-           res.temp_trend_per_day, res.humi_trend_per_day);
-
-    free(temp);
-    free(humi);
-    free(days);
-
     analysis_res = res;
     analysis_page = 0;
     update_analysis_display();
@@ -897,12 +909,24 @@ static void page_data_analysis_draw(void)
 {
     if (!analysis_ready)
     {
-        hal_oled_clear();
-        hal_oled_string(0, 0, "Data Analysis");
-        hal_oled_line(0, 10, 127, 10);
-        hal_oled_string(10, 30, "Loading...");
-        hal_oled_refresh();
-        perform_data_analysis();
+        if (!analysis_ticket)
+            analysis_ticket = analysis_submit(ANALYSIS_JOB_SUMMARY);
+
+        int progress = 0;
+        analysis_state_t state = analysis_poll(ANALYSIS_JOB_SUMMARY, analysis_ticket, &progress);
+        if (state != ANALYSIS_DONE && state != ANALYSIS_FAILED)
+        {
+            char msg[24];
+            snprintf(msg, sizeof(msg), "Loading... %d%%", progress);
+            hal_oled_clear();
+            hal_oled_string(0, 0, "Data Analysis");
+            hal_oled_line(0, 10, 127, 10);
+            hal_oled_string(10, 30, msg);
+            hal_oled_refresh();
+            return;
+        }
+        analysis_ticket = 0;
+        load_data_analysis(state == ANALYSIS_DONE);
         if (analysis_ready != 1)
         {
             hal_oled_clear();
@@ -956,6 +980,7 @@ static void page_data_analysis_handle_event(event_t ev)
         break;
     case EV_BACK:
         analysis_ready = 0;
+        analysis_ticket = 0;
         analysis_page = 0;
         menu_back();
         break;
@@ -981,6 +1006,12 @@ void page_tools_init(void)
     page_register("Export Popup", page_export_popup_draw, page_export_popup_handle_event);
     page_register("Data Analysis", page_data_analysis_draw, page_data_analysis_handle_event);
 
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, export_fetch_thread, NULL) == 0)
+        pthread_detach(thread);
+    else
+        fprintf(stderr, "[TOOLS] Failed to create export fetch thread\n");
+
     init = 1;
 }
 
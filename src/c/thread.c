@@ -24,8 +24,11 @@
 #include "menu.h"
 #include "hal_oled.h"
 #include "db_helper.h" // 新增
+#include "db_ingest.h"
 #include "hal_echo.h"
 #include "email_report.h"
+#include "analysis_worker.h"
+#include "anomaly_detector.h"
 /* ==================== 全局配置 & 常量定义 ==================== */
 // 天气API配置
 #define DEFAULT_LATITUDE "34.62"
@@ -39,6 +42,17 @@
 static int g_threads_running = 0;
 // 发布频率（毫秒），统一控制所有MQTT发布间隔
 #define PUBLISH_INTERVAL_MS 100
+// 传感器数据入库间隔（秒），经写入队列攒批落库，不阻塞发布循环
+#define SENSOR_SAVE_INTERVAL_S 10
+// 异常检测采样间隔（毫秒）：驱动每次读取都返回滤波后的保持值，按 DHT11 的 1Hz 采样率送检，
+// 避免同一测量被重复计入窗口
+#define ANOMALY_SAMPLE_MS 1000
+// 异常提示（默认关闭）：ANOMALY_ALERT_LED 为异常期间常亮的 LED 编号（0 红 / 1 绿 / 2 蓝，-1 关闭），
+// 三路 LED 都可由 MQTT 控制，异常解除时恢复为提示前的状态；蜂鸣器在异常开始时短响（0 关闭）
+#define ANOMALY_ALERT_LED -1
+#define ANOMALY_ALERT_BEEP_MS 0
+// 预测刷新并发布到 MQTT 的间隔（秒），与预测的小时步长一致
+#define FORECAST_PUBLISH_S 3600
 
 // 天气图标声明
 extern const unsigned char icon_weather_clear[];
@@ -366,6 +380,41 @@ void *mqtt_thread(void *arg)
     return NULL;
 }
 
+// 在线异常检测：温度/湿度各一个检测器，仅在发布线程中访问
+static anomaly_detector_t anomaly_temp, anomaly_humi;
+
+static void anomaly_feed(anomaly_detector_t *d, const char *channel, double x)
+{
+    anomaly_score_t s;
+    if (!anomaly_update(d, x, &s))
+        return;
+
+    // 状态变化立即发布（开始/解除各一条）
+    mqtt_safe_publish("sensor/anomaly", "Ch:%s,State:%d,Val:%.1f,Z:%.1f,RZ:%.1f",
+                      channel, s.active, s.value, s.z_ewma, s.z_robust);
+    printf("[ANOMALY] %s %s: %.1f (z=%.1f, robust z=%.1f)\n",
+           channel, s.active ? "detected" : "cleared", s.value, s.z_ewma, s.z_robust);
+
+#if ANOMALY_ALERT_LED >= 0
+    static int alert_on = 0, led_before = 0;
+    int any = anomaly_temp.active || anomaly_humi.active;
+    if (any && !alert_on)
+    {
+        led_before = hal_led_get(ANOMALY_ALERT_LED);
+        hal_led_set(ANOMALY_ALERT_LED, 1);
+    }
+    else if (!any && alert_on)
+    {
+        hal_led_set(ANOMALY_ALERT_LED, led_before);
+    }
+    alert_on = any;
+#endif
+#if ANOMALY_ALERT_BEEP_MS > 0
+    if (s.active)
+        hal_beep(ANOMALY_ALERT_BEEP_MS);
+#endif
+}
+
 // 统一数据发布线程（合并sensor/system/network发布逻辑）
 void *data_publish_thread(void *arg)
 {
@@ -373,25 +422,46 @@ void *data_publish_thread(void *arg)
     printf("[DATA-PUB] Thread started (merged sensor/system/network)\n");
 
     system_monitor_start(); // 初始化系统监控
+    anomaly_init(&anomaly_temp, 0.1); // DHT11 分辨率 0.1
+    anomaly_init(&anomaly_humi, 0.1);
 
     while (g_threads_running)
     {
-        // 1. 发布传感器数据（DHT11）
         // 1. 发布传感器数据（DHT11）
         float temp, hum;
         if (hal_dht11_read(&temp, &hum) == 0)
         {
             mqtt_safe_publish("sensor/dht11", "Temp:%.1f,Humi:%.1f", temp, hum);
 
-            /* 新增：每分钟存一次数据库 */
+            // 每个采样周期送检一次，异常在当前样本即发布
+            static struct timespec last_check = {0, 0};
+            struct timespec mono;
+            clock_gettime(CLOCK_MONOTONIC, &mono);
+            if ((mono.tv_sec - last_check.tv_sec) * 1000 + (mono.tv_nsec - last_check.tv_nsec) / 1000000 >= ANOMALY_SAMPLE_MS)
+            {
+                anomaly_feed(&anomaly_temp, "temp", temp);
+                anomaly_feed(&anomaly_humi, "humi", hum);
+                last_check = mono;
+            }
+
+            /* 每 SENSOR_SAVE_INTERVAL_S 秒入队一次，由写线程批量入库 */
             static time_t last_db_save = 0;
             time_t now = time(NULL);
-            if (now - last_db_save >= 60 * 30)
+            if (now - last_db_save >= SENSOR_SAVE_INTERVAL_S)
             {
-                db_save_dht11(temp, hum); // 一行同时存
+                db_ingest_sensor(temp, hum);
                 last_db_save = now;
             }
         }
+        // 每小时在后台刷新一次预测，完成后由分析线程发布
+        static time_t last_forecast = 0;
+        time_t now_s = time(NULL);
+        if (now_s - last_forecast >= FORECAST_PUBLISH_S)
+        {
+            analysis_submit(ANALYSIS_JOB_FORECAST);
+            last_forecast = now_s;
+        }
+
         // float distance = 0.0f;
         // if (hal_hcsr04_read_distance(&distance) == 0)
         // {
@@ -525,7 +595,7 @@ void *weather_worker_thread(void *arg)
                     strncpy(loc, weather_address, sizeof(loc) - 1);
                     pthread_mutex_unlock(&weather_mutex);
 
-                    db_save_weather(temp, humi, loc, desc);
+                    db_ingest_weather(temp, humi, loc, desc);
                     last_update_time = now; // 更新定时器
                     printf("[WEATHER] Auto refresh and saved (4h interval)\n");
                 }
@@ -584,6 +654,8 @@ void threads_init(void)
     g_threads_running = 1;
     network_monitor_init();
     db_init();
+    db_ingest_init();
+    analysis_worker_init();
     // 创建优化后的线程（从6个减少到4个）
     pthread_t mqtt_t, publish_t, btn_t, weather_t;
     pthread_t email_t;
@@ -605,6 +677,8 @@ void threads_stop(void)
     printf("[THREAD] Stopping all threads...\n");
     g_threads_running = 0;
     sleep(1); // 等待线程完成收尾工作
+    if (db_ingest_flush(3000) != 0)
+        printf("[THREAD] Ingest queue not fully flushed\n");
     printf("[THREAD] All threads stopped\n");
 }
 
@@ -6,6 +6,9 @@
 #include <numeric>
 #include <map>
 #include "c_api_wrapper.h"
+#include "stats_engine.h"
+#include "quantile.h"
+#include "periodicity.h"
 
 // ==================== 数据结构 ====================
 typedef struct
@@ -14,6 +17,7 @@ typedef struct
     int sensor_count;
     double temp_mean, temp_std, temp_min, temp_max, temp_median;
     double humi_mean, humi_std, humi_min, humi_max, humi_median;
+    double temp_p5, temp_p95, humi_p5, humi_p95;
     double temp_skewness, temp_kurtosis;
     double humi_skewness, humi_kurtosis;
     double temp_range, humi_range;
@@ -23,6 +27,7 @@ typedef struct
     int weather_count;
     double weather_temp_mean, weather_temp_std, weather_temp_min, weather_temp_max;
     double weather_humi_mean, weather_humi_std, weather_humi_min, weather_humi_max;
+    double weather_temp_median, weather_temp_p95;
 
     // 趋势分析
     double temp_trend, humi_trend;
@@ -38,6 +43,7 @@ typedef struct
     double avg_temp_diff, avg_humi_diff;
     double temp_diff_mean, temp_diff_std; // 添加这两个字段
     double temp_diff_max, temp_diff_min;
+    double temp_diff_p5, temp_diff_p50, temp_diff_p95;
 
     // 异常检测
     int temp_anomalies_3sigma, humi_anomalies_3sigma;
@@ -56,8 +62,10 @@ typedef struct
     char comfort_level[32];
 
     // 周期性分析
-    double diurnal_temp_amplitude; // 日温差幅度
+    double diurnal_temp_amplitude; // 日温差幅度（每日小时均值极差的平均）
     double diurnal_humi_amplitude;
+    int temp_peak_hour, temp_trough_hour;
+    double resid_temp_score, resid_humi_score; // 最新一小时的分解残差分数
 
     // 综合评分
     double overall_score;
@@ -65,148 +73,28 @@ typedef struct
     char suggestions[512];
 } analysis_result_t;
 
-// ==================== 基础统计 ====================
-static double calc_mean(const double *data, int n)
-{
-    if (n <= 0)
-        return 0;
-    double sum = 0;
-    for (int i = 0; i < n; i++)
-        sum += data[i];
-    return sum / n;
-}
-
-static double calc_median(std::vector<double> data)
-{
-    if (data.empty())
-        return 0;
-    std::sort(data.begin(), data.end());
-    size_t n = data.size();
-    return n % 2 ? data[n / 2] : (data[n / 2 - 1] + data[n / 2]) / 2.0;
-}
-
-static double calc_std(const double *data, int n, double mean)
-{
-    if (n <= 1)
-        return 0;
-    double sum = 0;
-    for (int i = 0; i < n; i++)
-        sum += (data[i] - mean) * (data[i] - mean);
-    return sqrt(sum / (n - 1));
-}
-
-static double calc_skewness(const double *data, int n, double mean, double std)
-{
-    if (n < 3 || std == 0)
-        return 0;
-    double sum = 0;
-    for (int i = 0; i < n; i++)
-    {
-        double z = (data[i] - mean) / std;
-        sum += z * z * z;
-    }
-    return sum / n;
-}
-
-static double calc_kurtosis(const double *data, int n, double mean, double std)
-{
-    if (n < 4 || std == 0)
-        return 0;
-    double sum = 0;
-    for (int i = 0; i < n; i++)
-    {
-        double z = (data[i] - mean) / std;
-        sum += z * z * z * z;
-    }
-    return sum / n - 3.0;
-}
-
-static double calc_pearson(const double *x, const double *y, int n)
-{
-    if (n < 2)
-        return 0;
-    double mx = calc_mean(x, n);
-    double my = calc_mean(y, n);
-    double num = 0, dx = 0, dy = 0;
-    for (int i = 0; i < n; i++)
-    {
-        num += (x[i] - mx) * (y[i] - my);
-        dx += (x[i] - mx) * (x[i] - mx);
-        dy += (y[i] - my) * (y[i] - my);
-    }
-    return dx * dy != 0 ? num / sqrt(dx * dy) : 0;
-}
-
-static double calc_spearman(const double *x, const double *y, int n)
-{
-    if (n < 2)
-        return 0;
-    std::vector<double> sx(x, x + n), sy(y, y + n);
-    std::sort(sx.begin(), sx.end());
-    std::sort(sy.begin(), sy.end());
-
-    std::vector<double> rx(n), ry(n);
-    for (int i = 0; i < n; i++)
-    {
-        rx[i] = std::lower_bound(sx.begin(), sx.end(), x[i]) - sx.begin() + 1;
-        ry[i] = std::lower_bound(sy.begin(), sy.end(), y[i]) - sy.begin() + 1;
-    }
-    return calc_pearson(rx.data(), ry.data(), n);
-}
-
-static double calc_trend(const double *y, int n)
-{
-    if (n < 2)
-        return 0;
-    double sx = 0, sy = 0, sxy = 0, sx2 = 0;
-    for (int i = 0; i < n; i++)
-    {
-        double xi = i;
-        sx += xi;
-        sy += y[i];
-        sxy += xi * y[i];
-        sx2 += xi * xi;
-    }
-    double denom = n * sx2 - sx * sx;
-    return denom != 0 ? (n * sxy - sx * sy) / denom : 0;
-}
-
-static double calc_acceleration(const double *y, int n)
-{
-    // 二阶趋势（加速度）
-    if (n < 3)
-        return 0;
-    std::vector<double> y_smooth;
-    for (int i = 1; i < n - 1; i++)
-    {
-        y_smooth.push_back((y[i - 1] + y[i] + y[i + 1]) / 3.0);
-    }
-    return calc_trend(y_smooth.data(), y_smooth.size());
-}
+// 天气约每小时一条，与相邻小时桶中点的距离不超过 1.5 小时即可插值
+#define WEATHER_ALIGN_TOL_S 5400
 
+// ==================== 基础统计 ====================
 static double calc_cv(double mean, double std)
 {
     return mean != 0 ? (std / mean) * 100 : 0;
 }
 
-static double calc_heat_index(double temp, double humi)
-{
-    // 简化版热指数
-    if (temp < 27)
-        return temp;
-    double hi = -42.379 + 2.04901523 * temp + 10.14333127 * humi - 0.22475541 * temp * humi - 0.00683783 * temp * temp - 0.05481717 * humi * humi + 0.00122874 * temp * temp * humi + 0.00085282 * temp * humi * humi - 0.00000199 * temp * temp * humi * humi;
-    return hi;
-}
-
 // ==================== 主分析函数 ====================
 extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
 {
     analysis_result_t res = {0};
 
-    // 1. 加载传感器数据
-    double *sensor_temp = NULL, *sensor_humi = NULL, *days = NULL;
-    int sensor_count = 0;
-    if (db_get_sensor_analysis_data(&sensor_temp, &sensor_humi, &days, &sensor_count) != 0 || sensor_count == 0)
+    // 1. 全部历史的传感器统计（增量缓存，与数据分析页/邮件共享）
+    time_t now = time(NULL);
+    stats_result_t sr;
+    if (stats_window(0, now, &sr) != 0)
+        sr.count = 0;
+
+    int sensor_count = sr.count;
+    if (sensor_count == 0)
     {
         snprintf(buffer, buf_size, "No sensor data");
         return -1;
@@ -214,106 +102,97 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
     res.sensor_count = sensor_count;
 
     // 2. 加载天气数据（全部数据）
-    time_t now = time(NULL);
-    time_t start_ts = 0;
-    double *weather_temp = NULL, *weather_humi = NULL;
-    char **weather_desc = NULL;
-    int weather_count = 0;
-    db_get_weather_data_range(start_ts, now, &weather_temp, &weather_humi, &weather_desc, &weather_count);
+    series_t *weather = db_load_weather_range(0, now, DB_RES_RAW);
+    int weather_count = weather ? weather->count : 0;
+    const double *weather_temp = weather ? weather->temp : NULL;
+    const double *weather_humi = weather ? weather->humi : NULL;
     res.weather_count = weather_count;
 
-    // ========== 3. 传感器统计分析 ==========
-    res.temp_mean = calc_mean(sensor_temp, sensor_count);
-    res.temp_std = calc_std(sensor_temp, sensor_count, res.temp_mean);
-    res.humi_mean = calc_mean(sensor_humi, sensor_count);
-    res.humi_std = calc_std(sensor_humi, sensor_count, res.humi_mean);
+    // ========== 3. 传感器统计分析（来自统一统计库） ==========
+    res.temp_mean = sr.temp_mean;
+    res.temp_std = sr.temp_std;
+    res.humi_mean = sr.humi_mean;
+    res.humi_std = sr.humi_std;
 
-    // 中位数
-    std::vector<double> temp_vec(sensor_temp, sensor_temp + sensor_count);
-    std::vector<double> humi_vec(sensor_humi, sensor_humi + sensor_count);
-    res.temp_median = calc_median(temp_vec);
-    res.humi_median = calc_median(humi_vec);
+    // 中位数与 p5/p95
+    res.temp_median = sr.temp_median;
+    res.humi_median = sr.humi_median;
+    res.temp_p5 = sr.temp_p5;
+    res.temp_p95 = sr.temp_p95;
+    res.humi_p5 = sr.humi_p5;
+    res.humi_p95 = sr.humi_p95;
 
     // 极值
-    res.temp_min = sensor_temp[0];
-    res.temp_max = sensor_temp[0];
-    res.humi_min = sensor_humi[0];
-    res.humi_max = sensor_humi[0];
-    for (int i = 1; i < sensor_count; i++)
-    {
-        if (sensor_temp[i] < res.temp_min)
-            res.temp_min = sensor_temp[i];
-        if (sensor_temp[i] > res.temp_max)
-            res.temp_max = sensor_temp[i];
-        if (sensor_humi[i] < res.humi_min)
-            res.humi_min = sensor_humi[i];
-        if (sensor_humi[i] > res.humi_max)
-            res.humi_max = sensor_humi[i];
-    }
+    res.temp_min = sr.temp_min;
+    res.temp_max = sr.temp_max;
+    res.humi_min = sr.humi_min;
+    res.humi_max = sr.humi_max;
     res.temp_range = res.temp_max - res.temp_min;
     res.humi_range = res.humi_max - res.humi_min;
 
     // 偏度和峰度
-    res.temp_skewness = calc_skewness(sensor_temp, sensor_count, res.temp_mean, res.temp_std);
-    res.temp_kurtosis = calc_kurtosis(sensor_temp, sensor_count, res.temp_mean, res.temp_std);
-    res.humi_skewness = calc_skewness(sensor_humi, sensor_count, res.humi_mean, res.humi_std);
-    res.humi_kurtosis = calc_kurtosis(sensor_humi, sensor_count, res.humi_mean, res.humi_std);
+    res.temp_skewness = sr.temp_skewness;
+    res.temp_kurtosis = sr.temp_kurtosis;
+    res.humi_skewness = sr.humi_skewness;
+    res.humi_kurtosis = sr.humi_kurtosis;
 
     // 变异系数
     res.temp_cv = calc_cv(res.temp_mean, res.temp_std);
     res.humi_cv = calc_cv(res.humi_mean, res.humi_std);
 
     // 传感器温湿度相关性
-    res.temp_humi_corr_pearson = calc_pearson(sensor_temp, sensor_humi, sensor_count);
+    res.temp_humi_corr_pearson = sr.temp_humi_corr;
 
-    // 趋势和加速度
-    res.temp_trend = calc_trend(sensor_temp, sensor_count);
-    res.humi_trend = calc_trend(sensor_humi, sensor_count);
-    res.temp_acceleration = calc_acceleration(sensor_temp, sensor_count);
-    res.humi_acceleration = calc_acceleration(sensor_humi, sensor_count);
+    // 趋势（按天）和加速度
+    res.temp_trend = sr.temp_trend_per_day;
+    res.humi_trend = sr.humi_trend_per_day;
+    res.temp_acceleration = sr.temp_acceleration;
+    res.humi_acceleration = sr.humi_acceleration;
 
     // ========== 4. 天气统计分析 ==========
     if (weather_count > 0)
     {
-        res.weather_temp_mean = calc_mean(weather_temp, weather_count);
-        res.weather_temp_std = calc_std(weather_temp, weather_count, res.weather_temp_mean);
-        res.weather_humi_mean = calc_mean(weather_humi, weather_count);
-        res.weather_humi_std = calc_std(weather_humi, weather_count, res.weather_humi_mean);
-
-        res.weather_temp_min = weather_temp[0];
-        res.weather_temp_max = weather_temp[0];
-        res.weather_humi_min = weather_humi[0];
-        res.weather_humi_max = weather_humi[0];
-        for (int i = 1; i < weather_count; i++)
+        // 天气类别按字典项判断一次，逐行只查表
+        std::vector<int *> kind(weather->dict_count, nullptr);
+        for (int c = 0; c < weather->dict_count; c++)
         {
-            if (weather_temp[i] < res.weather_temp_min)
-                res.weather_temp_min = weather_temp[i];
-            if (weather_temp[i] > res.weather_temp_max)
-                res.weather_temp_max = weather_temp[i];
-            if (weather_humi[i] < res.weather_humi_min)
-                res.weather_humi_min = weather_humi[i];
-            if (weather_humi[i] > res.weather_humi_max)
-                res.weather_humi_max = weather_humi[i];
+            const char *d = weather->dict[c];
+            if (!d)
+                continue;
+            if (strstr(d, "Rain"))
+                kind[c] = &res.rainy_days;
+            else if (strstr(d, "Clear"))
+                kind[c] = &res.clear_days;
+            else if (strstr(d, "Cloudy"))
+                kind[c] = &res.cloudy_days;
+            else if (strstr(d, "Fog"))
+                kind[c] = &res.foggy_days;
         }
 
-        res.weather_temp_trend = calc_trend(weather_temp, weather_count);
-        res.weather_humi_trend = calc_trend(weather_humi, weather_count);
-
-        // 天气统计
+        stats::Moments wt, wh;
+        stats::CoMoments wt_trend, wh_trend;
         for (int i = 0; i < weather_count; i++)
         {
-            if (weather_desc[i])
-            {
-                if (strstr(weather_desc[i], "Rain"))
-                    res.rainy_days++;
-                else if (strstr(weather_desc[i], "Clear"))
-                    res.clear_days++;
-                else if (strstr(weather_desc[i], "Cloudy"))
-                    res.cloudy_days++;
-                else if (strstr(weather_desc[i], "Fog"))
-                    res.foggy_days++;
-            }
+            wt.add(weather_temp[i]);
+            wh.add(weather_humi[i]);
+            wt_trend.add(i, weather_temp[i]);
+            wh_trend.add(i, weather_humi[i]);
+
+            // 天气统计
+            if (kind[weather->desc[i]])
+                (*kind[weather->desc[i]])++;
         }
+
+        res.weather_temp_mean = wt.mean();
+        res.weather_temp_std = wt.stddev();
+        res.weather_humi_mean = wh.mean();
+        res.weather_humi_std = wh.stddev();
+        res.weather_temp_min = wt.min();
+        res.weather_temp_max = wt.max();
+        res.weather_humi_min = wh.min();
+        res.weather_humi_max = wh.max();
+        res.weather_temp_trend = wt_trend.slope();
+        res.weather_humi_trend = wh_trend.slope();
     }
 
     // ========== 5. 室内外对比 ==========
@@ -322,109 +201,107 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
         res.avg_temp_diff = res.temp_mean - res.weather_temp_mean;
         res.avg_humi_diff = res.humi_mean - res.weather_humi_mean;
 
-        // 温差标准差
-        std::vector<double> temp_diffs;
-        int min_count = sensor_count < weather_count ? sensor_count : weather_count;
-        for (int i = 0; i < min_count; i++)
+        // 温差统计与相关性：以天气时刻为准，把传感器小时均值（桶中点）按时间插值后配对
+        // 小时汇总覆盖全部历史只需数千行，连接为一次线性归并
+        series_t *sensor = db_load_sensor_range(0, now, DB_RES_HOUR);
+        series_t *w_pair = NULL, *s_pair = NULL;
+        int pairs = 0;
+        if (sensor)
+        {
+            for (int i = 0; i < sensor->count; i++)
+                sensor->ts[i] += DB_RES_HOUR / 2;
+            pairs = series_asof_join(weather, sensor, WEATHER_ALIGN_TOL_S, SERIES_ASOF_LINEAR, &w_pair, &s_pair);
+            if (pairs < 0)
+                pairs = 0;
+        }
+        stats::Moments diff;
+        stats::StreamingQuantiles diff_q;
+        stats::CoMoments temp_pair, humi_pair;
+        for (int i = 0; i < pairs; i++)
         {
-            temp_diffs.push_back(sensor_temp[i] - weather_temp[i]);
+            diff.add(s_pair->temp[i] - w_pair->temp[i]);
+            diff_q.add(s_pair->temp[i] - w_pair->temp[i]);
+            temp_pair.add(s_pair->temp[i], w_pair->temp[i]);
+            humi_pair.add(s_pair->humi[i], w_pair->humi[i]);
         }
-        res.temp_diff_mean = calc_mean(temp_diffs.data(), temp_diffs.size());
-        res.temp_diff_std = calc_std(temp_diffs.data(), temp_diffs.size(), res.temp_diff_mean);
+        res.temp_diff_mean = diff.mean();
+        res.temp_diff_std = diff.stddev();
+        res.temp_diff_p5 = diff_q.p5();
+        res.temp_diff_p50 = diff_q.p50();
+        res.temp_diff_p95 = diff_q.p95();
 
         // 相关性
-        res.temp_corr_pearson = calc_pearson(sensor_temp, weather_temp, min_count);
-        res.temp_corr_spearman = calc_spearman(sensor_temp, weather_temp, min_count);
-        res.humi_corr_pearson = calc_pearson(sensor_humi, weather_humi, min_count);
-        res.humi_corr_spearman = calc_spearman(sensor_humi, weather_humi, min_count);
+        res.temp_corr_pearson = temp_pair.pearson();
+        res.humi_corr_pearson = humi_pair.pearson();
+        if (pairs > 0)
+        {
+            res.temp_corr_spearman = stats::spearman(s_pair->temp, w_pair->temp, pairs);
+            res.humi_corr_spearman = stats::spearman(s_pair->humi, w_pair->humi, pairs);
+        }
+        series_release(w_pair);
+        series_release(s_pair);
+        series_release(sensor);
     }
 
-    // ========== 6. 异常检测 ==========
-    double temp_3sigma = 3 * res.temp_std;
-    double humi_3sigma = 3 * res.humi_std;
-    for (int i = 0; i < sensor_count; i++)
+    // 天气温度分位数：就地选择会打乱顺序，须放在按序号配对之后
+    if (weather_count > 0)
     {
-        if (fabs(sensor_temp[i] - res.temp_mean) > temp_3sigma)
-            res.temp_anomalies_3sigma++;
-        if (fabs(sensor_humi[i] - res.humi_mean) > humi_3sigma)
-            res.humi_anomalies_3sigma++;
+        const double qs[2] = {0.5, 0.95};
+        double qv[2];
+        stats::quantiles_select(weather->temp, weather_count, qs, 2, qv); // 结果只在本函数内持有
+        res.weather_temp_median = qv[0];
+        res.weather_temp_p95 = qv[1];
     }
+
+    // ========== 6. 异常检测 ==========
+    res.temp_anomalies_3sigma = sr.temp_anom_3sigma;
+    res.humi_anomalies_3sigma = sr.humi_anom_3sigma;
     res.temp_anomaly_ratio = (double)res.temp_anomalies_3sigma / sensor_count * 100;
     res.humi_anomaly_ratio = (double)res.humi_anomalies_3sigma / sensor_count * 100;
 
     // ========== 7. 极端事件 ==========
-    for (int i = 0; i < sensor_count; i++)
-    {
-        if (sensor_temp[i] > 35.0)
-            res.hot_days++;
-        if (sensor_temp[i] < 0.0)
-            res.cold_days++;
-        if (sensor_humi[i] > 80.0)
-            res.high_humi_days++;
-        if (sensor_humi[i] < 30.0)
-            res.low_humi_days++;
-    }
+    res.hot_days = sr.hot;
+    res.cold_days = sr.cold;
+    res.high_humi_days = sr.high_humi;
+    res.low_humi_days = sr.low_humi;
     res.extreme_temp_events = res.hot_days + res.cold_days;
     res.extreme_humi_events = res.high_humi_days + res.low_humi_days;
 
     // ========== 8. 舒适度分析 ==========
-    double thi_sum = 0, thi_min = 100, thi_max = -100;
-    double hi_sum = 0;
-    for (int i = 0; i < sensor_count; i++)
-    {
-        double thi = 0.8 * sensor_temp[i] + (0.01 * sensor_humi[i]) * (0.8 * sensor_temp[i] - 14.3) + 46.3;
-        thi_sum += thi;
-        if (thi < thi_min)
-            thi_min = thi;
-        if (thi > thi_max)
-            thi_max = thi;
-
-        double hi = calc_heat_index(sensor_temp[i], sensor_humi[i]);
-        hi_sum += hi;
-    }
-    res.thi_mean = thi_sum / sensor_count;
-    res.thi_min = thi_min;
-    res.thi_max = thi_max;
-    res.thi_std = calc_std(&thi_sum, 1, res.thi_mean); // 简化
-    res.heat_index_mean = hi_sum / sensor_count;
+    res.thi_mean = sr.thi_mean;
+    res.thi_min = sr.thi_min;
+    res.thi_max = sr.thi_max;
+    res.thi_std = sr.thi_std;
+    res.heat_index_mean = sr.heat_index_mean;
 
     // 舒适度等级
-    if (res.thi_mean < 55)
-    {
-        strcpy(res.grade, "Cold");
-        strcpy(res.comfort_level, "Uncomfortable");
-    }
-    else if (res.thi_mean < 60)
-    {
-        strcpy(res.grade, "Cool");
-        strcpy(res.comfort_level, "Slightly Cool");
-    }
-    else if (res.thi_mean < 65)
-    {
-        strcpy(res.grade, "Comfort");
-        strcpy(res.comfort_level, "Comfortable");
-    }
-    else if (res.thi_mean < 70)
-    {
-        strcpy(res.grade, "Warm");
-        strcpy(res.comfort_level, "Slightly Warm");
-    }
-    else if (res.thi_mean < 75)
+    snprintf(res.grade, sizeof(res.grade), "%s", sr.comfort_grade);
+    snprintf(res.comfort_level, sizeof(res.comfort_level), "%s", sr.comfort_level);
+
+    // ========== 9. 周期性分析 ==========
+    // 趋势/日周期/周分量分解；尚无定稿日时退回全局极差与滑动平均加速度
+    stats_periodic_t per;
+    res.temp_peak_hour = res.temp_trough_hour = -1;
+    if (stats_periodic(&per) == 0 && per.days > 0)
     {
-        strcpy(res.grade, "Hot");
-        strcpy(res.comfort_level, "Uncomfortable");
+        res.diurnal_temp_amplitude = per.temp_amp_mean;
+        res.diurnal_humi_amplitude = per.humi_amp_mean;
+        res.temp_peak_hour = per.temp_peak_hour;
+        res.temp_trough_hour = per.temp_trough_hour;
+        res.resid_temp_score = per.score_temp;
+        res.resid_humi_score = per.score_humi;
+        if (per.days >= stats::Periodicity::TREND_KEEP)
+        {
+            res.temp_acceleration = per.trend_temp_accel;
+            res.humi_acceleration = per.trend_humi_accel;
+        }
     }
     else
     {
-        strcpy(res.grade, "Muggy");
-        strcpy(res.comfort_level, "Very Uncomfortable");
+        res.diurnal_temp_amplitude = res.temp_max - res.temp_min;
+        res.diurnal_humi_amplitude = res.humi_max - res.humi_min;
     }
 
-    // ========== 9. 周期性分析 ==========
-    // 计算日温差幅度（简化：取最高温-最低温）
-    res.diurnal_temp_amplitude = res.temp_max - res.temp_min;
-    res.diurnal_humi_amplitude = res.humi_max - res.humi_min;
-
     // ========== 10. 综合评分 ==========
     double score = 100;
     // 温度扣分
@@ -466,6 +343,10 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
                     "Skew:H%.2f CV:T%.1f%%\n", res.humi_skewness, res.temp_cv);
     off += snprintf(buffer + off, buf_size - off,
                     "CV:H%.1f%%\n", res.humi_cv);
+    off += snprintf(buffer + off, buf_size - off,
+                    "P5/95:T%.1f/%.1f\n", res.temp_p5, res.temp_p95);
+    off += snprintf(buffer + off, buf_size - off,
+                    "P5/95:H%.0f/%.0f\n", res.humi_p5, res.humi_p95);
 
     off += snprintf(buffer + off, buf_size - off,
                     "[2]Trend\n");
@@ -484,6 +365,8 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
                         "N:%-4d T:%.1f+-%.1f\n", weather_count, res.weather_temp_mean, res.weather_temp_std);
         off += snprintf(buffer + off, buf_size - off,
                         "H:%.1f+-%.1f%% [%.0f-%.0f]\n", res.weather_humi_mean, res.weather_humi_std, res.weather_humi_min, res.weather_humi_max);
+        off += snprintf(buffer + off, buf_size - off,
+                        "Med:T%.1f P95:%.1f\n", res.weather_temp_median, res.weather_temp_p95);
         off += snprintf(buffer + off, buf_size - off,
                         "Rain:%-3d Clear:%-3d\n", res.rainy_days, res.clear_days);
         off += snprintf(buffer + off, buf_size - off,
@@ -496,6 +379,8 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
                         "[4]In-Out Comp\n");
         off += snprintf(buffer + off, buf_size - off,
                         "Td:%+.1fC Hd:%+.1f%%\n", res.temp_diff_mean, res.avg_humi_diff);
+        off += snprintf(buffer + off, buf_size - off,
+                        "TdQ:%+.1f/%+.1f/%+.1f\n", res.temp_diff_p5, res.temp_diff_p50, res.temp_diff_p95);
         off += snprintf(buffer + off, buf_size - off,
                         "Tcorr:%.3f(P) %.3f(S)\n", res.temp_corr_pearson, res.temp_corr_spearman);
         off += snprintf(buffer + off, buf_size - off,
@@ -506,6 +391,8 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
                     "[5]Anomaly\n");
     off += snprintf(buffer + off, buf_size - off,
                     "T:%d(%.1f%%) H:%d(%.1f%%)\n", res.temp_anomalies_3sigma, res.temp_anomaly_ratio, res.humi_anomalies_3sigma, res.humi_anomaly_ratio);
+    off += snprintf(buffer + off, buf_size - off,
+                    "Resid:T%+.1fs H%+.1fs\n", res.resid_temp_score, res.resid_humi_score);
 
     off += snprintf(buffer + off, buf_size - off,
                     "[6]Extreme\n");
@@ -526,6 +413,9 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
                     "Grade:%s\n", res.grade);
     off += snprintf(buffer + off, buf_size - off,
                     "Amp:T%.1f H%.1f%%\n", res.diurnal_temp_amplitude, res.diurnal_humi_amplitude);
+    if (res.temp_peak_hour >= 0)
+        off += snprintf(buffer + off, buf_size - off,
+                        "Pk:%02dh Tr:%02dh\n", res.temp_peak_hour, res.temp_trough_hour);
 
     off += snprintf(buffer + off, buf_size - off,
                     "[8]Score\n");
@@ -571,15 +461,7 @@ extern "C" int perform_advanced_analysis(char *buffer, int buf_size)
                         "Take action!\n");
     }
 
-    // 清理内存
-    free(sensor_temp);
-    free(sensor_humi);
-    free(days);
-    free(weather_temp);
-    free(weather_humi);
-    for (int i = 0; i < weather_count; i++)
-        free(weather_desc[i]);
-    free(weather_desc);
+    series_release(weather);
 
     return 0;
 }
\ No newline at end of file
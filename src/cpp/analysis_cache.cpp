@@ -0,0 +1,329 @@
+#include <cstdio>
+#include <cstddef>
+#include <ctime>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include "c_api_wrapper.h"
+#include "analysis_cache.h"
+
+#define CACHE_MAGIC 0x31434341 // "ACC1"
+#define CACHE_VERSION 3
+
+namespace stats
+{
+
+static_assert(std::is_trivially_copyable<DayStats>::value, "day stats must be POD-serializable");
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t day_size; // 结构体布局变化时自动失效重建
+    int32_t watermark;
+    uint32_t day_count;
+} cache_header_t;
+
+// 文件布局：头 + day_count 条定长记录（int32 日期编号 + DayStats），记录顺序不要求有序
+#define CACHE_RECORD_BYTES (sizeof(int32_t) + sizeof(DayStats))
+
+static off_t record_offset(uint32_t slot)
+{
+    return (off_t)sizeof(cache_header_t) + (off_t)slot * (off_t)CACHE_RECORD_BYTES;
+}
+
+static bool pwrite_all(int fd, const void *buf, size_t len, off_t off)
+{
+    return pwrite(fd, buf, len, off) == (ssize_t)len;
+}
+
+void DayStats::merge(const DayStats &later)
+{
+    acc.merge(later.acc);
+    temp_hist.merge(later.temp_hist);
+    humi_hist.merge(later.humi_hist);
+    hours.merge(later.hours);
+}
+
+AnalysisCache &AnalysisCache::instance()
+{
+    static AnalysisCache cache;
+    return cache;
+}
+
+int32_t AnalysisCache::local_day(double ts)
+{
+    time_t t = (time_t)ts;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return (int32_t)((t + tm.tm_gmtoff) / 86400);
+}
+
+int32_t AnalysisCache::local_hour(double ts)
+{
+    time_t t = (time_t)ts;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return (int32_t)((t + tm.tm_gmtoff) / 3600);
+}
+
+// ts 所在本地日期的 [零点, 次日零点)
+static void day_bounds(double ts, double *start, double *end)
+{
+    time_t t = (time_t)ts;
+    struct tm tm;
+    localtime_r(&t, &tm);
+    tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    *start = (double)mktime(&tm);
+    tm.tm_mday++;
+    tm.tm_isdst = -1;
+    *end = (double)mktime(&tm);
+}
+
+void AnalysisCache::reset()
+{
+    watermark_ = 0;
+    days_.clear();
+    slots_.clear();
+    dirty_.clear();
+    rewrite_ = true;
+    periodicity_.reset();
+    forecaster_.reset();
+}
+
+bool AnalysisCache::load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+
+    cache_header_t hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+              hdr.magic == CACHE_MAGIC &&
+              hdr.version == CACHE_VERSION &&
+              hdr.day_size == sizeof(DayStats);
+
+    for (uint32_t i = 0; ok && i < hdr.day_count; i++)
+    {
+        int32_t day;
+        DayStats day_stats;
+        ok = fread(&day, sizeof(day), 1, fp) == 1 && fread(&day_stats, sizeof(day_stats), 1, fp) == 1 &&
+             slots_.emplace(day, i).second;
+        if (ok)
+            days_[day] = day_stats;
+    }
+    fclose(fp);
+
+    if (!ok)
+    {
+        fprintf(stderr, "[CACHE] %s invalid, rebuilding\n", path);
+        reset();
+        return false;
+    }
+
+    watermark_ = hdr.watermark;
+    rewrite_ = false;
+    printf("[CACHE] Loaded %u days, watermark id=%d\n", hdr.day_count, watermark_);
+    return true;
+}
+
+bool AnalysisCache::save_all(const char *path)
+{
+    char tmp_path[256];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp)
+    {
+        fprintf(stderr, "[CACHE] Cannot write %s\n", tmp_path);
+        return false;
+    }
+
+    cache_header_t hdr = {CACHE_MAGIC, CACHE_VERSION, (uint32_t)sizeof(DayStats),
+                          watermark_, (uint32_t)days_.size()};
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    std::map<int32_t, uint32_t> slots;
+    for (auto it = days_.begin(); ok && it != days_.end(); ++it)
+    {
+        ok = fwrite(&it->first, sizeof(it->first), 1, fp) == 1 &&
+             fwrite(&it->second, sizeof(it->second), 1, fp) == 1;
+        slots.emplace(it->first, (uint32_t)slots.size());
+    }
+    // 先落盘再替换，否则断电后 rename 可能指向未写完的数据
+    ok = ok && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+
+    if (fclose(fp) != 0 || !ok)
+    {
+        remove(tmp_path);
+        return false;
+    }
+    // 原子替换，断电时不会留下半写的缓存
+    if (rename(tmp_path, path) != 0)
+        return false;
+
+    slots_.swap(slots);
+    dirty_.clear();
+    rewrite_ = false;
+    return true;
+}
+
+bool AnalysisCache::save(const char *path)
+{
+    if (rewrite_)
+        return save_all(path);
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0)
+        return save_all(path);
+
+    // 1. 先把魔数清零：中途断电时文件在下次加载时判为无效并重建，不会与水位线错配
+    // 2. 只改写变化的日子，新的日子追加在末尾
+    // 3. 最后写入带新水位线的完整文件头
+    uint32_t count = (uint32_t)slots_.size();
+    uint32_t invalid = 0;
+    bool ok = pwrite_all(fd, &invalid, sizeof(invalid), offsetof(cache_header_t, magic)) && fdatasync(fd) == 0;
+    for (auto it = dirty_.begin(); ok && it != dirty_.end(); ++it)
+    {
+        auto slot = slots_.find(*it);
+        off_t off = record_offset(slot != slots_.end() ? slot->second : count);
+        const DayStats &day_stats = days_[*it];
+        ok = pwrite_all(fd, &*it, sizeof(int32_t), off) &&
+             pwrite_all(fd, &day_stats, sizeof(day_stats), off + (off_t)sizeof(int32_t));
+        if (ok && slot == slots_.end())
+            slots_.emplace(*it, count++);
+    }
+    cache_header_t hdr = {CACHE_MAGIC, CACHE_VERSION, (uint32_t)sizeof(DayStats), watermark_, count};
+    ok = ok && fdatasync(fd) == 0 && pwrite_all(fd, &hdr, sizeof(hdr), 0) && fdatasync(fd) == 0;
+    close(fd);
+
+    if (!ok)
+    {
+        // 文件已无效，下次整体重写
+        fprintf(stderr, "[CACHE] Incremental write to %s failed\n", path);
+        rewrite_ = true;
+        return false;
+    }
+    dirty_.clear();
+    return true;
+}
+
+void AnalysisCache::fold(const double *ts, const double *temp, const double *humi, int n)
+{
+    // 趋势横坐标取绝对天数，各天累加器可直接合并
+    double days[DB_STREAM_CHUNK];
+    int i = 0;
+    while (i < n)
+    {
+        // 按本地日期切成连续段，整段交给分块 SIMD 内核
+        int32_t day = local_day(ts[i]);
+        double day_start, day_end;
+        day_bounds(ts[i], &day_start, &day_end);
+        DayStats &day_stats = days_[day];
+        dirty_.insert(day);
+        // 已定稿的日子收到迟到数据，分解需要重建
+        if (day <= periodicity_.finalized())
+            periodicity_.reset();
+        int j = i;
+        while (j < n && ts[j] >= day_start && ts[j] < day_end)
+        {
+            days[j] = ts[j] / 86400.0;
+            day_stats.temp_hist.add(temp[j]);
+            day_stats.humi_hist.add(humi[j]);
+            // 夏令时切换日按实际经过的小时分箱，截断到 0~23
+            int hour = (int)((ts[j] - day_start) / 3600);
+            day_stats.hours.add(hour, temp[j], humi[j]);
+            // 迟到数据落在已喂入预测的小时
+            if (day * 24 + hour <= forecaster_.fed())
+                forecaster_.reset();
+            j++;
+        }
+        day_stats.acc.add_block(temp + i, humi + i, days + i, j - i);
+        i = j;
+    }
+}
+
+int AnalysisCache::refresh()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if (!loaded_)
+    {
+        load(ANALYSIS_CACHE_PATH);
+        loaded_ = true;
+    }
+
+    int max_id = db_get_sensor_max_id();
+    if (max_id < 0)
+        return -1;
+    if (max_id < watermark_)
+    {
+        // 表被清空或重建，水位线失效
+        printf("[CACHE] sensor_data shrank (max id %d < %d), rebuilding\n", max_id, watermark_);
+        reset();
+    }
+
+    // 流式逐块折叠，内存占用与新增行数无关
+    int32_t before = watermark_;
+    int total = 0;
+    if (watermark_ < max_id)
+    {
+        db_chunk_cb fold_chunk = [](const db_chunk_t *chunk, void *user) -> int {
+            AnalysisCache *self = static_cast<AnalysisCache *>(user);
+            self->fold(chunk->ts, chunk->temp, chunk->humi, chunk->count);
+            self->watermark_ = chunk->id[chunk->count - 1];
+            return 0;
+        };
+        total = db_stream_sensor_rows_after(watermark_, fold_chunk, this);
+    }
+
+    if (watermark_ != before)
+    {
+        printf("[CACHE] Folded %d new rows, watermark id=%d\n", total, watermark_);
+        save(ANALYSIS_CACHE_PATH);
+    }
+    // 读取中途失败时已折叠的块仍有效，水位线停在最后一块
+    if (total < 0)
+        return days_.empty() ? -1 : 0;
+    return total;
+}
+
+DayStats AnalysisCache::range(int32_t day_from, int32_t day_to)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    DayStats sum;
+    for (auto it = days_.lower_bound(day_from); it != days_.end() && it->first <= day_to; ++it)
+        sum.merge(it->second);
+    return sum;
+}
+
+int32_t AnalysisCache::watermark()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return watermark_;
+}
+
+void AnalysisCache::periodic(stats_periodic_t *out)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    int32_t today = local_day((double)time(NULL));
+    periodicity_.update(days_, today - 1);
+    periodicity_.summarize(days_, today, out);
+}
+
+int32_t AnalysisCache::forecast_fed()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return forecaster_.fed();
+}
+
+void AnalysisCache::forecast(time_t now, const series_t *outdoor, stats_forecast_t *out)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    time_t settled = now - FORECAST_SETTLE_S;
+    forecaster_.update(days_, local_hour((double)settled) - 1, outdoor);
+    forecaster_.predict(out);
+    out->origin_ts = (long)(settled - settled % 3600);
+}
+
+} // namespace stats
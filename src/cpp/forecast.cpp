@@ -0,0 +1,196 @@
+#include <cmath>
+#include "forecast.h"
+#include "analysis_cache.h"
+
+// 平滑系数：水平跟随约 5 小时，趋势很慢，季节项每天更新一次
+#define HW_ALPHA 0.2
+#define HW_BETA 0.01
+#define HW_GAMMA 0.15
+#define HW_PHI 0.95       // 趋势阻尼，远期预测回到水平 + 季节
+#define HW_MSE_ALPHA 0.02 // 一步误差均方的平滑系数
+#define EXO_FORGET 0.995  // 外生回归的遗忘因子（约 200 小时记忆）
+#define EXO_RIDGE 1.0     // 回归分母的正则项，样本很少时增益收缩到 0
+
+namespace stats
+{
+
+// ==================== HoltWinters ====================
+
+void HoltWinters::update(int hour, double y)
+{
+    steps_++;
+    if (steps_ <= 24)
+    {
+        // 初始化阶段：季节项先记原值，水平取均值，满一天后统一去均值
+        season_[hour] = y;
+        seen_[hour] = true;
+        level_ = (level_ * n_ + y) / (n_ + 1);
+        n_++;
+        if (steps_ == 24)
+        {
+            for (int k = 0; k < 24; k++)
+                season_[k] = seen_[k] ? season_[k] - level_ : 0;
+        }
+        return;
+    }
+
+    double e = y - (level_ + HW_PHI * trend_ + season_[hour]);
+    mse_ = mse_ == 0 ? e * e : mse_ + HW_MSE_ALPHA * (e * e - mse_);
+
+    double level = HW_ALPHA * (y - season_[hour]) + (1 - HW_ALPHA) * (level_ + HW_PHI * trend_);
+    trend_ = HW_BETA * (level - level_) + (1 - HW_BETA) * HW_PHI * trend_;
+    level_ = level;
+    season_[hour] = HW_GAMMA * (y - level_) + (1 - HW_GAMMA) * season_[hour];
+    n_++;
+}
+
+void HoltWinters::skip()
+{
+    steps_++;
+    if (steps_ < 24)
+        return;
+    if (steps_ == 24)
+    {
+        for (int k = 0; k < 24; k++)
+            season_[k] = seen_[k] ? season_[k] - level_ : 0;
+        return;
+    }
+    level_ += HW_PHI * trend_;
+    trend_ *= HW_PHI;
+}
+
+double HoltWinters::forecast(int steps, int hour) const
+{
+    double damp = 0, phi = 1;
+    for (int i = 0; i < steps; i++)
+    {
+        phi *= HW_PHI;
+        damp += phi;
+    }
+    return level_ + damp * trend_ + season_[hour];
+}
+
+double HoltWinters::rmse() const
+{
+    return sqrt(mse_);
+}
+
+// ==================== Forecaster ====================
+
+Forecaster::Exo::Exo() : last_u(NAN)
+{
+}
+
+double Forecaster::Exo::gain() const
+{
+    return sxy / (sxx + EXO_RIDGE);
+}
+
+double Forecaster::Exo::rho() const
+{
+    if (s00 <= 0)
+        return 0;
+    double r = s01 / s00;
+    return r < 0 ? 0 : (r > 1 ? 1 : r);
+}
+
+void Forecaster::reset()
+{
+    *this = Forecaster();
+}
+
+void Forecaster::step(HoltWinters &model, Exo &exo, int hour, bool has_y, double y, bool has_o, double o)
+{
+    double x = exo.last_u;
+    if (has_y)
+    {
+        if (std::isnan(x))
+        {
+            model.update(hour, y);
+        }
+        else
+        {
+            // 残差对上一小时室外异常回归；模型本身学习扣除外生项后的部分
+            double k = exo.gain();
+            if (model.ready())
+            {
+                double r = y - model.forecast(1, hour);
+                exo.sxx = EXO_FORGET * exo.sxx + x * x;
+                exo.sxy = EXO_FORGET * exo.sxy + x * r;
+            }
+            model.update(hour, y - k * x);
+        }
+    }
+    else
+    {
+        model.skip();
+    }
+
+    if (!has_o)
+    {
+        exo.outdoor.skip();
+        exo.last_u = NAN;
+        return;
+    }
+    double u = exo.outdoor.ready() ? o - exo.outdoor.baseline(hour) : NAN;
+    if (!std::isnan(u) && !std::isnan(exo.last_u))
+    {
+        exo.s00 = EXO_FORGET * exo.s00 + exo.last_u * exo.last_u;
+        exo.s01 = EXO_FORGET * exo.s01 + exo.last_u * u;
+    }
+    exo.outdoor.update(hour, o);
+    exo.last_u = u;
+}
+
+void Forecaster::update(const std::map<int32_t, DayStats> &days, int32_t last_hour, const series_t *outdoor)
+{
+    if (last_hour <= fed_ || (fed_ == INT32_MIN && days.empty()))
+        return;
+
+    int32_t h = fed_ == INT32_MIN ? days.begin()->first * 24 : fed_ + 1;
+    auto day_it = days.lower_bound(h / 24);
+    int j = 0, n = outdoor ? outdoor->count : 0;
+    for (; h <= last_hour; h++)
+    {
+        int32_t day = h / 24;
+        int hour = h % 24;
+        while (day_it != days.end() && day_it->first < day)
+            ++day_it;
+        const HourBins *bins = day_it != days.end() && day_it->first == day ? &day_it->second.hours : nullptr;
+        bool has_y = bins && bins->count[hour] > 0;
+        double c = has_y ? bins->count[hour] : 1;
+
+        // 室外小时桶按本地小时编号对齐
+        while (j < n && AnalysisCache::local_hour(outdoor->ts[j]) < h)
+            j++;
+        bool has_o = j < n && AnalysisCache::local_hour(outdoor->ts[j]) == h;
+
+        step(temp_, exo_temp_, hour, has_y, has_y ? bins->temp_sum[hour] / c : 0, has_o, has_o ? outdoor->temp[j] : 0);
+        step(humi_, exo_humi_, hour, has_y, has_y ? bins->humi_sum[hour] / c : 0, has_o, has_o ? outdoor->humi[j] : 0);
+    }
+    fed_ = last_hour;
+}
+
+void Forecaster::predict(stats_forecast_t *out) const
+{
+    out->ready = fed_ != INT32_MIN && temp_.ready() && humi_.ready();
+    out->origin_hour = fed_ == INT32_MIN ? 0 : fed_ % 24;
+    out->temp_rmse = temp_.rmse();
+    out->humi_rmse = humi_.rmse();
+    out->temp_exo = exo_temp_.gain();
+    out->humi_exo = exo_humi_.gain();
+    out->exo_used = !std::isnan(exo_temp_.last_u) && !std::isnan(exo_humi_.last_u);
+
+    double ut = out->exo_used ? exo_temp_.last_u : 0, uh = out->exo_used ? exo_humi_.last_u : 0;
+    double rt = exo_temp_.rho(), rh = exo_humi_.rho();
+    for (int i = 0; i < STATS_FORECAST_HORIZON; i++)
+    {
+        int hour = (out->origin_hour + i + 1) % 24;
+        out->temp[i] = temp_.forecast(i + 1, hour) + out->temp_exo * ut;
+        out->humi[i] = humi_.forecast(i + 1, hour) + out->humi_exo * uh;
+        ut *= rt;
+        uh *= rh;
+    }
+}
+
+} // namespace stats
@@ -0,0 +1,259 @@
+#include <cstring>
+#include "periodicity.h"
+#include "analysis_cache.h"
+
+namespace stats
+{
+
+void HourBins::add(int hour, double temp, double humi)
+{
+    if (hour < 0)
+        hour = 0;
+    else if (hour > 23)
+        hour = 23;
+    temp_sum[hour] += temp;
+    humi_sum[hour] += humi;
+    count[hour]++;
+}
+
+void HourBins::merge(const HourBins &o)
+{
+    for (int h = 0; h < 24; h++)
+    {
+        temp_sum[h] += o.temp_sum[h];
+        humi_sum[h] += o.humi_sum[h];
+        count[h] += o.count[h];
+    }
+}
+
+int HourBins::hours() const
+{
+    int n = 0;
+    for (int h = 0; h < 24; h++)
+        n += count[h] > 0;
+    return n;
+}
+
+bool HourBins::day_mean(double *temp, double *humi) const
+{
+    double t = 0, u = 0;
+    int n = 0;
+    for (int h = 0; h < 24; h++)
+    {
+        if (count[h] == 0)
+            continue;
+        t += temp_sum[h] / count[h];
+        u += humi_sum[h] / count[h];
+        n++;
+    }
+    if (n == 0)
+        return false;
+    *temp = t / n;
+    *humi = u / n;
+    return true;
+}
+
+bool HourBins::amplitude(double *temp, double *humi) const
+{
+    if (hours() < PERIODIC_MIN_HOURS)
+        return false;
+    double t_lo = 1e9, t_hi = -1e9, h_lo = 1e9, h_hi = -1e9;
+    for (int h = 0; h < 24; h++)
+    {
+        if (count[h] == 0)
+            continue;
+        double t = temp_sum[h] / count[h], u = humi_sum[h] / count[h];
+        t_lo = t < t_lo ? t : t_lo;
+        t_hi = t > t_hi ? t : t_hi;
+        h_lo = u < h_lo ? u : h_lo;
+        h_hi = u > h_hi ? u : h_hi;
+    }
+    *temp = t_hi - t_lo;
+    *humi = h_hi - h_lo;
+    return true;
+}
+
+void Periodicity::reset()
+{
+    *this = Periodicity();
+}
+
+// [day-3, day+3]（不超过 last_day）内各日日均值的平均
+bool Periodicity::trend_at(const std::map<int32_t, DayStats> &days, int32_t day, int32_t last_day,
+                           double *temp, double *humi) const
+{
+    double t = 0, u = 0;
+    int n = 0;
+    int32_t to = day + TREND_HALF < last_day ? day + TREND_HALF : last_day;
+    for (auto it = days.lower_bound(day - TREND_HALF); it != days.end() && it->first <= to; ++it)
+    {
+        double dt, dh;
+        if (it->second.hours.day_mean(&dt, &dh))
+        {
+            t += dt;
+            u += dh;
+            n++;
+        }
+    }
+    if (n == 0)
+        return false;
+    *temp = t / n;
+    *humi = u / n;
+    return true;
+}
+
+// 小时 h 的日周期分量：去趋势小时均值减去 24 小时的平均
+double Periodicity::diurnal(const double *sum, int h) const
+{
+    if (s_count_[h] == 0)
+        return 0;
+    double mean = 0;
+    int n = 0;
+    for (int k = 0; k < 24; k++)
+    {
+        if (s_count_[k] == 0)
+            continue;
+        mean += sum[k] / s_count_[k];
+        n++;
+    }
+    return sum[h] / s_count_[h] - mean / n;
+}
+
+void Periodicity::finalize_day(const std::map<int32_t, DayStats> &days, int32_t day)
+{
+    const HourBins &bins = days.at(day).hours;
+    double trend_t, trend_h, mean_t, mean_h;
+    if (!bins.day_mean(&mean_t, &mean_h) || !trend_at(days, day, day + TREND_HALF, &trend_t, &trend_h))
+        return;
+
+    int dow = weekday(day);
+    for (int h = 0; h < 24; h++)
+    {
+        if (bins.count[h] == 0)
+            continue;
+        s_temp_[h] += bins.temp_sum[h] / bins.count[h] - trend_t;
+        s_humi_[h] += bins.humi_sum[h] / bins.count[h] - trend_h;
+        s_count_[h]++;
+    }
+    w_temp_[dow] += mean_t - trend_t;
+    w_humi_[dow] += mean_h - trend_h;
+    w_count_[dow]++;
+
+    double amp_t, amp_h;
+    if (bins.amplitude(&amp_t, &amp_h))
+    {
+        amp_temp_.add(amp_t);
+        amp_humi_.add(amp_h);
+    }
+
+    // 残差按定稿时的分量计算，此后不再回改
+    double wt = w_temp_[dow] / w_count_[dow], wh = w_humi_[dow] / w_count_[dow];
+    for (int h = 0; h < 24; h++)
+    {
+        if (bins.count[h] == 0)
+            continue;
+        resid_temp_.add(bins.temp_sum[h] / bins.count[h] - trend_t - diurnal(s_temp_, h) - wt);
+        resid_humi_.add(bins.humi_sum[h] / bins.count[h] - trend_h - diurnal(s_humi_, h) - wh);
+    }
+
+    trend_day_[trend_head_] = day;
+    trend_temp_[trend_head_] = trend_t;
+    trend_humi_[trend_head_] = trend_h;
+    trend_head_ = (trend_head_ + 1) % TREND_KEEP;
+    if (trend_n_ < TREND_KEEP)
+        trend_n_++;
+    days_++;
+}
+
+void Periodicity::update(const std::map<int32_t, DayStats> &days, int32_t complete_day)
+{
+    int32_t last = complete_day - TREND_HALF;
+    if (last <= finalized_)
+        return;
+    auto it = finalized_ == INT32_MIN ? days.begin() : days.upper_bound(finalized_);
+    for (; it != days.end() && it->first <= last; ++it)
+        finalize_day(days, it->first);
+    finalized_ = last;
+}
+
+void Periodicity::summarize(const std::map<int32_t, DayStats> &days, int32_t today, stats_periodic_t *out) const
+{
+    memset(out, 0, sizeof(*out));
+    out->days = days_;
+    out->temp_peak_hour = out->temp_trough_hour = -1;
+    out->temp_amp_mean = amp_temp_.mean();
+    out->humi_amp_mean = amp_humi_.mean();
+    out->resid_temp_std = resid_temp_.stddev();
+    out->resid_humi_std = resid_humi_.stddev();
+
+    auto last = days.find(today - 1);
+    if (last != days.end())
+        last->second.hours.amplitude(&out->temp_amp_last, &out->humi_amp_last);
+
+    for (int h = 0; h < 24; h++)
+    {
+        out->diurnal_temp[h] = diurnal(s_temp_, h);
+        out->diurnal_humi[h] = diurnal(s_humi_, h);
+        if (s_count_[h] == 0)
+            continue;
+        if (out->temp_peak_hour < 0 || out->diurnal_temp[h] > out->diurnal_temp[out->temp_peak_hour])
+            out->temp_peak_hour = h;
+        if (out->temp_trough_hour < 0 || out->diurnal_temp[h] < out->diurnal_temp[out->temp_trough_hour])
+            out->temp_trough_hour = h;
+    }
+    for (int d = 0; d < 7; d++)
+    {
+        out->weekly_temp[d] = w_count_[d] ? w_temp_[d] / w_count_[d] : 0;
+        out->weekly_humi[d] = w_count_[d] ? w_humi_[d] / w_count_[d] : 0;
+    }
+
+    // 趋势斜率：最近 7 个与之前 7 个定稿趋势值各做一次回归
+    CoMoments recent_t, recent_h, prev_t, prev_h;
+    for (int i = 0; i < trend_n_; i++)
+    {
+        int k = (trend_head_ - 1 - i + TREND_KEEP) % TREND_KEEP;
+        CoMoments &ct = i < TREND_KEEP / 2 ? recent_t : prev_t;
+        CoMoments &ch = i < TREND_KEEP / 2 ? recent_h : prev_h;
+        ct.add(trend_day_[k], trend_temp_[k]);
+        ch.add(trend_day_[k], trend_humi_[k]);
+    }
+    out->trend_temp_slope = recent_t.slope();
+    out->trend_humi_slope = recent_h.slope();
+    if (prev_t.count() >= 2)
+    {
+        out->trend_temp_accel = (recent_t.slope() - prev_t.slope()) / (TREND_KEEP / 2);
+        out->trend_humi_accel = (recent_h.slope() - prev_h.slope()) / (TREND_KEEP / 2);
+    }
+
+    // 最近 7 个完整日的趋势水平，作为当前时刻的趋势
+    if (!trend_at(days, today - 1 - TREND_HALF, today - 1, &out->trend_temp, &out->trend_humi))
+        return;
+
+    // 最新一小时的残差分数：优先今天，今天尚无数据时取昨天
+    for (int32_t day = today; day >= today - 1; day--)
+    {
+        auto it = days.find(day);
+        if (it == days.end())
+            continue;
+        const HourBins &bins = it->second.hours;
+        int h = 23;
+        while (h >= 0 && bins.count[h] == 0)
+            h--;
+        if (h < 0)
+            continue;
+
+        int dow = weekday(day);
+        double wt = w_count_[dow] ? w_temp_[dow] / w_count_[dow] : 0;
+        double wh = w_count_[dow] ? w_humi_[dow] / w_count_[dow] : 0;
+        double rt = bins.temp_sum[h] / bins.count[h] - out->trend_temp - diurnal(s_temp_, h) - wt;
+        double rh = bins.humi_sum[h] / bins.count[h] - out->trend_humi - diurnal(s_humi_, h) - wh;
+        // 残差样本不足两天时分数无意义
+        if (resid_temp_.count() >= 48 && out->resid_temp_std > 0)
+            out->score_temp = rt / out->resid_temp_std;
+        if (resid_humi_.count() >= 48 && out->resid_humi_std > 0)
+            out->score_humi = rh / out->resid_humi_std;
+        break;
+    }
+}
+
+} // namespace stats
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "stats_engine.h"
+#include "quantile.h"
+
+namespace stats
+{
+
+// ==================== 精确分位数 ====================
+double quantile_select(double *data, int n, double q)
+{
+    double v;
+    quantiles_select(data, n, &q, 1, &v);
+    return v;
+}
+
+void quantiles_select(double *data, int n, const double *qs, int nq, double *out)
+{
+    int lo = 0;
+    for (int j = 0; j < nq; j++)
+    {
+        if (n <= 0)
+        {
+            out[j] = 0;
+            continue;
+        }
+        double pos = qs[j] * (n - 1);
+        int k = (int)pos;
+        if (k < lo)
+            k = lo;
+        if (k > n - 1)
+            k = n - 1;
+
+        // [lo, n) 之前的元素已不大于 data[lo]，只需在右侧继续划分
+        std::nth_element(data + lo, data + k, data + n);
+        double v = data[k];
+        double frac = pos - k;
+        if (frac > 0 && k + 1 < n)
+        {
+            // 划分后右侧最小值即第 k+1 小
+            double next = *std::min_element(data + k + 1, data + n);
+            v += (next - v) * frac;
+        }
+        out[j] = v;
+        lo = k;
+    }
+}
+
+// ==================== 秩 ====================
+void tie_ranks(const double *x, int n, double *ranks)
+{
+    std::vector<int> idx(n);
+    std::iota(idx.begin(), idx.end(), 0);
+    std::sort(idx.begin(), idx.end(), [x](int a, int b) { return x[a] < x[b]; });
+
+    int i = 0;
+    while (i < n)
+    {
+        int j = i + 1;
+        while (j < n && x[idx[j]] == x[idx[i]])
+            j++;
+        // 名次 i+1..j 的平均
+        double r = (i + 1 + j) / 2.0;
+        for (int k = i; k < j; k++)
+            ranks[idx[k]] = r;
+        i = j;
+    }
+}
+
+double spearman(const double *x, const double *y, int n)
+{
+    if (n < 2)
+        return 0;
+    std::vector<double> rx(n), ry(n);
+    tie_ranks(x, n, rx.data());
+    tie_ranks(y, n, ry.data());
+
+    CoMoments c;
+    for (int i = 0; i < n; i++)
+        c.add(rx[i], ry[i]);
+    return c.pearson();
+}
+
+// ==================== P² ====================
+P2Quantile::P2Quantile(double p) : p_(p)
+{
+    for (int i = 0; i < 5; i++)
+        q_[i] = pos_[i] = want_[i] = dn_[i] = 0;
+}
+
+void P2Quantile::add(double x)
+{
+    if (n_ < 5)
+    {
+        q_[n_++] = x;
+        if (n_ == 5)
+        {
+            std::sort(q_, q_ + 5);
+            for (int i = 0; i < 5; i++)
+                pos_[i] = i + 1;
+            want_[0] = 1;
+            want_[1] = 1 + 2 * p_;
+            want_[2] = 1 + 4 * p_;
+            want_[3] = 3 + 2 * p_;
+            want_[4] = 5;
+            dn_[0] = 0;
+            dn_[1] = p_ / 2;
+            dn_[2] = p_;
+            dn_[3] = (1 + p_) / 2;
+            dn_[4] = 1;
+        }
+        return;
+    }
+
+    // 定位 x 所在区间并更新端点
+    int k;
+    if (x < q_[0])
+    {
+        q_[0] = x;
+        k = 0;
+    }
+    else if (x >= q_[4])
+    {
+        q_[4] = x;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (k < 3 && x >= q_[k + 1])
+            k++;
+    }
+
+    for (int i = k + 1; i < 5; i++)
+        pos_[i] += 1;
+    for (int i = 0; i < 5; i++)
+        want_[i] += dn_[i];
+    n_++;
+
+    // 调整中间三个标记
+    for (int i = 1; i <= 3; i++)
+    {
+        double d = want_[i] - pos_[i];
+        if ((d >= 1 && pos_[i + 1] - pos_[i] > 1) || (d <= -1 && pos_[i - 1] - pos_[i] < -1))
+        {
+            double s = d >= 0 ? 1 : -1;
+            double qp = parabolic(i, s);
+            if (q_[i - 1] < qp && qp < q_[i + 1])
+                q_[i] = qp;
+            else
+                q_[i] = linear(i, s);
+            pos_[i] += s;
+        }
+    }
+}
+
+double P2Quantile::parabolic(int i, double d) const
+{
+    return q_[i] + d / (pos_[i + 1] - pos_[i - 1]) *
+                       ((pos_[i] - pos_[i - 1] + d) * (q_[i + 1] - q_[i]) / (pos_[i + 1] - pos_[i]) +
+                        (pos_[i + 1] - pos_[i] - d) * (q_[i] - q_[i - 1]) / (pos_[i] - pos_[i - 1]));
+}
+
+double P2Quantile::linear(int i, double d) const
+{
+    int j = i + (int)d;
+    return q_[i] + d * (q_[j] - q_[i]) / (pos_[j] - pos_[i]);
+}
+
+double P2Quantile::value() const
+{
+    if (n_ == 0)
+        return 0;
+    if (n_ < 5)
+    {
+        double tmp[5];
+        std::copy(q_, q_ + n_, tmp);
+        return quantile_select(tmp, (int)n_, p_);
+    }
+    return q_[2];
+}
+
+StreamingQuantiles::StreamingQuantiles()
+    : q_{P2Quantile(0.05), P2Quantile(0.5), P2Quantile(0.95), P2Quantile(0.99)}
+{
+}
+
+void StreamingQuantiles::add(double x)
+{
+    for (int i = 0; i < COUNT; i++)
+        q_[i].add(x);
+}
+
+} // namespace stats
@@ -0,0 +1,186 @@
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include "stats_engine.h"
+#include "c_api_wrapper.h"
+#include "analysis_cache.h"
+
+// 窗口结果缓存条数（全部历史 + 邮件日报 + 少量临时窗口）
+#define STATS_WINDOW_SLOTS 4
+
+namespace
+{
+
+typedef struct
+{
+    bool valid;
+    int32_t day_from, day_to;
+    int32_t watermark;
+    stats_result_t result;
+} window_slot_t;
+
+std::mutex window_lock;
+window_slot_t window_slots[STATS_WINDOW_SLOTS];
+int window_next = 0;
+
+void fill_result(const stats::DayStats &d, stats_result_t *out)
+{
+    const stats::SensorAccumulator &acc = d.acc;
+    memset(out, 0, sizeof(*out));
+    out->count = (int)acc.temp.count();
+    if (out->count == 0)
+        return;
+
+    out->temp_mean = acc.temp.mean();
+    out->temp_std = acc.temp.stddev();
+    out->temp_min = acc.temp.min();
+    out->temp_max = acc.temp.max();
+    out->humi_mean = acc.humi.mean();
+    out->humi_std = acc.humi.stddev();
+    out->humi_min = acc.humi.min();
+    out->humi_max = acc.humi.max();
+
+    out->temp_median = d.temp_hist.quantile(0.5);
+    out->humi_median = d.humi_hist.quantile(0.5);
+    out->temp_p5 = d.temp_hist.quantile(0.05);
+    out->temp_p95 = d.temp_hist.quantile(0.95);
+    out->humi_p5 = d.humi_hist.quantile(0.05);
+    out->humi_p95 = d.humi_hist.quantile(0.95);
+
+    out->temp_skewness = acc.temp.skewness();
+    out->temp_kurtosis = acc.temp.kurtosis();
+    out->humi_skewness = acc.humi.skewness();
+    out->humi_kurtosis = acc.humi.kurtosis();
+    out->temp_humi_corr = acc.temp_humi.pearson();
+
+    out->temp_trend_per_day = acc.temp_trend.slope();
+    out->humi_trend_per_day = acc.humi_trend.slope();
+    out->temp_acceleration = acc.temp_accel.slope();
+    out->humi_acceleration = acc.humi_accel.slope();
+
+    out->thi_mean = acc.thi.mean();
+    out->thi_std = acc.thi.stddev();
+    out->thi_min = acc.thi.min();
+    out->thi_max = acc.thi.max();
+    out->heat_index_mean = acc.heat_index.mean();
+    stats_comfort(out->thi_mean, out);
+
+    // 3σ 阈值依赖最终均值/标准差，在直方图上计数，无需再遍历原始数据
+    double t3 = 3 * out->temp_std;
+    double h3 = 3 * out->humi_std;
+    out->temp_anom_3sigma = (int)d.temp_hist.count_outside(out->temp_mean - t3, out->temp_mean + t3);
+    out->humi_anom_3sigma = (int)d.humi_hist.count_outside(out->humi_mean - h3, out->humi_mean + h3);
+
+    out->hot = acc.hot;
+    out->cold = acc.cold;
+    out->high_humi = acc.high_humi;
+    out->low_humi = acc.low_humi;
+}
+
+} // namespace
+
+extern "C" int stats_window(time_t start_ts, time_t end_ts, stats_result_t *out)
+{
+    stats::AnalysisCache &cache = stats::AnalysisCache::instance();
+    if (cache.refresh() < 0)
+        return -1;
+
+    int32_t day_from = start_ts <= 0 ? INT32_MIN : stats::AnalysisCache::local_day((double)start_ts);
+    int32_t day_to = stats::AnalysisCache::local_day((double)end_ts);
+    int32_t watermark = cache.watermark();
+
+    std::lock_guard<std::mutex> guard(window_lock);
+    for (int i = 0; i < STATS_WINDOW_SLOTS; i++)
+    {
+        window_slot_t &slot = window_slots[i];
+        if (slot.valid && slot.day_from == day_from && slot.day_to == day_to && slot.watermark == watermark)
+        {
+            *out = slot.result;
+            return 0;
+        }
+    }
+
+    window_slot_t &slot = window_slots[window_next];
+    window_next = (window_next + 1) % STATS_WINDOW_SLOTS;
+    fill_result(cache.range(day_from, day_to), &slot.result);
+    slot.day_from = day_from;
+    slot.day_to = day_to;
+    slot.watermark = watermark;
+    slot.valid = true;
+    *out = slot.result;
+    return 0;
+}
+
+extern "C" int stats_periodic(stats_periodic_t *out)
+{
+    stats::AnalysisCache &cache = stats::AnalysisCache::instance();
+    if (cache.refresh() < 0)
+        return -1;
+    cache.periodic(out);
+    return 0;
+}
+
+extern "C" int stats_forecast(stats_forecast_t *out)
+{
+    stats::AnalysisCache &cache = stats::AnalysisCache::instance();
+    if (cache.refresh() < 0)
+        return -1;
+
+    // 只读取尚未喂入的小时对应的室外数据；首次调用读取全部历史用于重放
+    time_t now = time(NULL);
+    int32_t fed = cache.forecast_fed();
+    time_t from = fed == INT32_MIN ? 0 : now - (time_t)(stats::AnalysisCache::local_hour((double)now) - fed + 1) * 3600;
+    series_t *outdoor = db_load_weather_range(from, now, DB_RES_HOUR);
+    cache.forecast(now, outdoor, out);
+    series_release(outdoor);
+    return 0;
+}
+
+extern "C" void stats_comfort(double thi_mean, stats_result_t *out)
+{
+    static const struct
+    {
+        double below;
+        const char *grade, *level, *suggestion;
+    } table[] = {
+        {55, "Cold", "Uncomfortable", "Warm"},
+        {60, "Cool", "Slightly Cool", "Add clothes"},
+        {65, "Comfort", "Comfortable", "Good"},
+        {70, "Warm", "Slightly Warm", "Ventilate"},
+        {75, "Hot", "Uncomfortable", "Fan/AC"},
+        {1e9, "Muggy", "Very Uncomfortable", "Cool down"},
+    };
+
+    size_t i = 0;
+    while (i + 1 < sizeof(table) / sizeof(table[0]) && thi_mean >= table[i].below)
+        i++;
+    snprintf(out->comfort_grade, sizeof(out->comfort_grade), "%s", table[i].grade);
+    snprintf(out->comfort_level, sizeof(out->comfort_level), "%s", table[i].level);
+    snprintf(out->comfort_suggestion, sizeof(out->comfort_suggestion), "%s", table[i].suggestion);
+}
+
+extern "C" const char *stats_kernel_name(void)
+{
+    return stats::block_kernel_name();
+}
+
+extern "C" void stats_summarize(const double *data, int n, stats_summary_t *out)
+{
+    stats::Moments m;
+    for (int i = 0; i < n; i++)
+        m.add(data[i]);
+    out->count = n;
+    out->mean = m.mean();
+    out->std = m.stddev();
+    out->min = m.min();
+    out->max = m.max();
+}
+
+extern "C" double stats_pearson(const double *x, const double *y, int n)
+{
+    stats::CoMoments c;
+    for (int i = 0; i < n; i++)
+        c.add(x[i], y[i]);
+    return c.pearson();
+}
@@ -0,0 +1,348 @@
+#include <cmath>
+#include "stats_engine.h"
+
+namespace stats
+{
+
+// ==================== Moments ====================
+void Moments::add(double x)
+{
+    int64_t n1 = n_;
+    n_++;
+    double n = (double)n_;
+    double delta = x - mean_;
+    double delta_n = delta / n;
+    double delta_n2 = delta_n * delta_n;
+    double term1 = delta * delta_n * n1;
+
+    mean_ += delta_n;
+    m4_ += term1 * delta_n2 * (n * n - 3 * n + 3) + 6 * delta_n2 * m2_ - 4 * delta_n * m3_;
+    m3_ += term1 * delta_n * (n - 2) - 3 * delta_n * m2_;
+    m2_ += term1;
+
+    if (n1 == 0)
+    {
+        min_ = max_ = x;
+    }
+    else
+    {
+        if (x < min_)
+            min_ = x;
+        if (x > max_)
+            max_ = x;
+    }
+}
+
+// Pébay 合并公式：两段独立累加的结果合成整体的中心矩
+void Moments::merge(const Moments &o)
+{
+    if (o.n_ == 0)
+        return;
+    if (n_ == 0)
+    {
+        *this = o;
+        return;
+    }
+
+    double na = (double)n_, nb = (double)o.n_;
+    double n = na + nb;
+    double delta = o.mean_ - mean_;
+    double d2 = delta * delta;
+    double d3 = d2 * delta;
+    double d4 = d2 * d2;
+
+    double m2 = m2_ + o.m2_ + d2 * na * nb / n;
+    double m3 = m3_ + o.m3_ + d3 * na * nb * (na - nb) / (n * n) + 3 * delta * (na * o.m2_ - nb * m2_) / n;
+    double m4 = m4_ + o.m4_ + d4 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n) + 6 * d2 * (na * na * o.m2_ + nb * nb * m2_) / (n * n) + 4 * delta * (na * o.m3_ - nb * m3_) / n;
+
+    mean_ += delta * nb / n;
+    m2_ = m2;
+    m3_ = m3;
+    m4_ = m4;
+    n_ += o.n_;
+    if (o.min_ < min_)
+        min_ = o.min_;
+    if (o.max_ > max_)
+        max_ = o.max_;
+}
+
+Moments Moments::from_sums(int64_t n, double shift, double s1, double s2, double s3, double s4, double min, double max)
+{
+    Moments m;
+    if (n <= 0)
+        return m;
+    double a = s1 / n;
+    double a2 = a * a;
+    m.n_ = n;
+    m.mean_ = shift + a;
+    m.m2_ = s2 - n * a2;
+    m.m3_ = s3 - 3 * a * s2 + 2 * n * a2 * a;
+    m.m4_ = s4 - 4 * a * s3 + 6 * a2 * s2 - 3 * n * a2 * a2;
+    if (m.m2_ < 0)
+        m.m2_ = 0;
+    m.min_ = min;
+    m.max_ = max;
+    return m;
+}
+
+double Moments::variance() const
+{
+    return n_ > 1 ? m2_ / (n_ - 1) : 0;
+}
+
+double Moments::stddev() const
+{
+    return sqrt(variance());
+}
+
+double Moments::skewness() const
+{
+    double s = stddev();
+    if (n_ < 3 || s == 0)
+        return 0;
+    return (m3_ / n_) / (s * s * s);
+}
+
+double Moments::kurtosis() const
+{
+    double s = stddev();
+    if (n_ < 4 || s == 0)
+        return 0;
+    return (m4_ / n_) / (s * s * s * s) - 3.0;
+}
+
+// ==================== CoMoments ====================
+void CoMoments::add(double x, double y)
+{
+    n_++;
+    double dx = x - mean_x_;
+    double dy = y - mean_y_;
+    mean_x_ += dx / n_;
+    mean_y_ += dy / n_;
+    m2_x_ += dx * (x - mean_x_);
+    m2_y_ += dy * (y - mean_y_);
+    c_xy_ += dx * (y - mean_y_);
+}
+
+void CoMoments::merge(const CoMoments &o, double x_offset)
+{
+    if (o.n_ == 0)
+        return;
+    if (n_ == 0)
+    {
+        *this = o;
+        mean_x_ += x_offset;
+        return;
+    }
+
+    double na = (double)n_, nb = (double)o.n_;
+    double n = na + nb;
+    double dx = o.mean_x_ + x_offset - mean_x_;
+    double dy = o.mean_y_ - mean_y_;
+    double w = na * nb / n;
+
+    m2_x_ += o.m2_x_ + dx * dx * w;
+    m2_y_ += o.m2_y_ + dy * dy * w;
+    c_xy_ += o.c_xy_ + dx * dy * w;
+    mean_x_ += dx * nb / n;
+    mean_y_ += dy * nb / n;
+    n_ += o.n_;
+}
+
+CoMoments CoMoments::from_sums(int64_t n, double cx, double cy, double sx, double sy, double sxx, double syy, double sxy)
+{
+    CoMoments c;
+    if (n <= 0)
+        return c;
+    c.n_ = n;
+    c.mean_x_ = cx + sx / n;
+    c.mean_y_ = cy + sy / n;
+    c.m2_x_ = sxx - sx * sx / n;
+    c.m2_y_ = syy - sy * sy / n;
+    c.c_xy_ = sxy - sx * sy / n;
+    if (c.m2_x_ < 0)
+        c.m2_x_ = 0;
+    if (c.m2_y_ < 0)
+        c.m2_y_ = 0;
+    return c;
+}
+
+double CoMoments::pearson() const
+{
+    if (n_ < 2)
+        return 0;
+    double d = m2_x_ * m2_y_;
+    return d != 0 ? c_xy_ / sqrt(d) : 0;
+}
+
+double CoMoments::slope() const
+{
+    if (n_ < 2 || m2_x_ == 0)
+        return 0;
+    return c_xy_ / m2_x_;
+}
+
+// ==================== SensorAccumulator ====================
+void SensorAccumulator::add(double t, double h, double x)
+{
+    int64_t i = temp.count();
+
+    temp.add(t);
+    humi.add(h);
+    thi.add(stats::thi(t, h));
+    heat_index.add(stats::heat_index(t, h));
+    temp_humi.add(t, h);
+    temp_trend.add(x, t);
+    humi_trend.add(x, h);
+
+    if (i < 2)
+    {
+        first_temp_[i] = t;
+        first_humi_[i] = h;
+    }
+
+    // 3点滑动平均：第 i 个样本产生平滑序列的第 i-2 个点
+    if (i >= 2)
+    {
+        temp_accel.add(i - 2, (prev_temp_[0] + prev_temp_[1] + t) / 3.0);
+        humi_accel.add(i - 2, (prev_humi_[0] + prev_humi_[1] + h) / 3.0);
+    }
+    prev_temp_[0] = prev_temp_[1];
+    prev_temp_[1] = t;
+    prev_humi_[0] = prev_humi_[1];
+    prev_humi_[1] = h;
+
+    if (t > 35.0)
+        hot++;
+    if (t < 0.0)
+        cold++;
+    if (h > 80.0)
+        high_humi++;
+    if (h < 30.0)
+        low_humi++;
+}
+
+SensorAccumulator SensorAccumulator::from_block(const block_sums_t &s, const double *temp, const double *humi)
+{
+    SensorAccumulator b;
+    int n = s.n;
+
+    b.temp = Moments::from_sums(n, s.shift_t, s.t.s1, s.t.s2, s.t.s3, s.t.s4, s.t.min, s.t.max);
+    b.humi = Moments::from_sums(n, s.shift_h, s.h.s1, s.h.s2, s.h.s3, s.h.s4, s.h.min, s.h.max);
+    b.thi = Moments::from_sums(n, s.shift_thi, s.thi.s1, s.thi.s2, s.thi.s3, s.thi.s4, s.thi.min, s.thi.max);
+    b.heat_index = Moments::from_sums(n, s.shift_hi, s.hi.s1, s.hi.s2, s.hi.s3, s.hi.s4, s.hi.min, s.hi.max);
+    b.temp_humi = CoMoments::from_sums(n, s.shift_t, s.shift_h, s.t.s1, s.h.s1, s.t.s2, s.h.s2, s.s_th);
+    b.temp_trend = CoMoments::from_sums(n, s.shift_x, s.shift_t, s.s_x, s.t.s1, s.s_xx, s.t.s2, s.s_xt);
+    b.humi_trend = CoMoments::from_sums(n, s.shift_x, s.shift_h, s.s_x, s.h.s1, s.s_xx, s.h.s2, s.s_xh);
+
+    // 平滑序列横坐标 k = 0..m-1，Σk 与 Σk² 取闭式
+    double m = n - 2;
+    double sk = m * (m - 1) / 2;
+    double skk = (m - 1) * m * (2 * m - 1) / 6;
+    b.temp_accel = CoMoments::from_sums(n - 2, 0, s.shift_t, sk, s.a_t, skk, s.a_tt, s.a_kt);
+    b.humi_accel = CoMoments::from_sums(n - 2, 0, s.shift_h, sk, s.a_h, skk, s.a_hh, s.a_kh);
+
+    b.hot = s.hot;
+    b.cold = s.cold;
+    b.high_humi = s.high_humi;
+    b.low_humi = s.low_humi;
+
+    b.first_temp_[0] = temp[0];
+    b.first_temp_[1] = temp[1];
+    b.first_humi_[0] = humi[0];
+    b.first_humi_[1] = humi[1];
+    b.prev_temp_[0] = temp[n - 2];
+    b.prev_temp_[1] = temp[n - 1];
+    b.prev_humi_[0] = humi[n - 2];
+    b.prev_humi_[1] = humi[n - 1];
+    return b;
+}
+
+void SensorAccumulator::add_block(const double *temp, const double *humi, const double *x, int n)
+{
+    block_kernel_t kernel = block_kernel();
+
+    for (int off = 0; off < n; off += STATS_BLOCK_SIZE)
+    {
+        int len = n - off < STATS_BLOCK_SIZE ? n - off : STATS_BLOCK_SIZE;
+        if (len < 3)
+        {
+            // 不足以构成滑动平均点，逐个追加
+            for (int i = off; i < off + len; i++)
+                add(temp[i], humi[i], x[i]);
+            continue;
+        }
+
+        block_sums_t sums;
+        kernel(temp + off, humi + off, x + off, len, &sums);
+        merge(from_block(sums, temp + off, humi + off));
+    }
+}
+
+void SensorAccumulator::merge(const SensorAccumulator &later)
+{
+    int64_t na = temp.count(), nb = later.temp.count();
+    if (nb == 0)
+        return;
+    if (na == 0)
+    {
+        *this = later;
+        return;
+    }
+
+    // 拼接前段末尾与后段开头（各至多2个样本），补齐跨越分段边界的滑动平均点
+    int tail = na < 2 ? (int)na : 2;
+    int head = nb < 2 ? (int)nb : 2;
+    double seq_t[4], seq_h[4];
+    for (int k = 0; k < tail; k++)
+    {
+        seq_t[k] = prev_temp_[2 - tail + k];
+        seq_h[k] = prev_humi_[2 - tail + k];
+    }
+    for (int k = 0; k < head; k++)
+    {
+        seq_t[tail + k] = later.first_temp_[k];
+        seq_h[tail + k] = later.first_humi_[k];
+    }
+    for (int p = 0; p < tail && p + 2 < tail + head; p++)
+    {
+        double x = (double)(na - tail + p);
+        temp_accel.add(x, (seq_t[p] + seq_t[p + 1] + seq_t[p + 2]) / 3.0);
+        humi_accel.add(x, (seq_h[p] + seq_h[p + 1] + seq_h[p + 2]) / 3.0);
+    }
+    temp_accel.merge(later.temp_accel, (double)na);
+    humi_accel.merge(later.humi_accel, (double)na);
+
+    temp.merge(later.temp);
+    humi.merge(later.humi);
+    thi.merge(later.thi);
+    heat_index.merge(later.heat_index);
+    temp_humi.merge(later.temp_humi);
+    temp_trend.merge(later.temp_trend);
+    humi_trend.merge(later.humi_trend);
+
+    hot += later.hot;
+    cold += later.cold;
+    high_humi += later.high_humi;
+    low_humi += later.low_humi;
+
+    if (na == 1)
+    {
+        first_temp_[1] = later.first_temp_[0];
+        first_humi_[1] = later.first_humi_[0];
+    }
+    if (nb == 1)
+    {
+        prev_temp_[0] = prev_temp_[1];
+        prev_humi_[0] = prev_humi_[1];
+    }
+    else
+    {
+        prev_temp_[0] = later.prev_temp_[0];
+        prev_humi_[0] = later.prev_humi_[0];
+    }
+    prev_temp_[1] = later.prev_temp_[1];
+    prev_humi_[1] = later.prev_humi_[1];
+}
+
+} // namespace stats
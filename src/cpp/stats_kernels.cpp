@@ -0,0 +1,413 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include "stats_engine.h"
+#include "stats_kernels.h"
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace stats
+{
+
+// ==================== 标量参考实现 ====================
+static void init_sums(const double *t, const double *h, const double *x, int n, block_sums_t *o)
+{
+    memset(o, 0, sizeof(*o));
+    o->n = n;
+    o->shift_t = t[0];
+    o->shift_h = h[0];
+    o->shift_thi = stats::thi(t[0], h[0]);
+    o->shift_hi = stats::heat_index(t[0], h[0]);
+    o->shift_x = x[0];
+    o->t.min = o->t.max = t[0];
+    o->h.min = o->h.max = h[0];
+    o->thi.min = o->thi.max = o->shift_thi;
+    o->hi.min = o->hi.max = o->shift_hi;
+}
+
+static inline void add_power(power_sums_t *p, double v, double shift)
+{
+    double d = v - shift;
+    double d2 = d * d;
+    p->s1 += d;
+    p->s2 += d2;
+    p->s3 += d2 * d;
+    p->s4 += d2 * d2;
+    if (v < p->min)
+        p->min = v;
+    if (v > p->max)
+        p->max = v;
+}
+
+// 处理下标 [from, n) 的剩余样本（SIMD 实现的尾部也复用这里）
+static void scalar_tail(const double *t, const double *h, const double *x, int from, int n, block_sums_t *o)
+{
+    for (int i = from; i < n; i++)
+    {
+        double dt = t[i] - o->shift_t;
+        double dh = h[i] - o->shift_h;
+        double dx = x[i] - o->shift_x;
+
+        add_power(&o->t, t[i], o->shift_t);
+        add_power(&o->h, h[i], o->shift_h);
+        add_power(&o->thi, stats::thi(t[i], h[i]), o->shift_thi);
+        add_power(&o->hi, stats::heat_index(t[i], h[i]), o->shift_hi);
+        o->s_th += dt * dh;
+
+        o->s_x += dx;
+        o->s_xx += dx * dx;
+        o->s_xt += dx * dt;
+        o->s_xh += dx * dh;
+
+        o->hot += t[i] > 35.0;
+        o->cold += t[i] < 0.0;
+        o->high_humi += h[i] > 80.0;
+        o->low_humi += h[i] < 30.0;
+    }
+}
+
+static void scalar_accel_tail(const double *t, const double *h, int from, int n, block_sums_t *o)
+{
+    for (int k = from; k < n - 2; k++)
+    {
+        double ut = (t[k] + t[k + 1] + t[k + 2]) / 3.0 - o->shift_t;
+        double uh = (h[k] + h[k + 1] + h[k + 2]) / 3.0 - o->shift_h;
+        o->a_t += ut;
+        o->a_tt += ut * ut;
+        o->a_kt += k * ut;
+        o->a_h += uh;
+        o->a_hh += uh * uh;
+        o->a_kh += k * uh;
+    }
+}
+
+void block_sums_scalar(const double *t, const double *h, const double *x, int n, block_sums_t *out)
+{
+    init_sums(t, h, x, n, out);
+    scalar_tail(t, h, x, 0, n, out);
+    scalar_accel_tail(t, h, 0, n, out);
+}
+
+// ==================== SIMD 实现 ====================
+// 基于 GCC 向量扩展编写一次，W=2 在 aarch64 上生成 NEON、在 x86_64 上生成 SSE2，
+// W=4 在带 avx2 目标属性的入口中内联展开为 AVX2/FMA 指令
+template <int W>
+struct simd
+{
+    typedef double v __attribute__((vector_size(W * sizeof(double))));
+    typedef long long m __attribute__((vector_size(W * sizeof(long long))));
+};
+
+#define VLOAD(dst, p) __builtin_memcpy(&(dst), (p), sizeof(dst))
+
+template <int W>
+static inline __attribute__((always_inline)) double hsum(const typename simd<W>::v &a)
+{
+    double s = 0;
+    for (int j = 0; j < W; j++)
+        s += a[j];
+    return s;
+}
+
+template <int W>
+static inline __attribute__((always_inline)) void block_sums_simd(const double *t, const double *h, const double *x, int n, block_sums_t *o)
+{
+    typedef typename simd<W>::v V;
+    typedef typename simd<W>::m M;
+
+    init_sums(t, h, x, n, o);
+    int vend = n - n % W;
+
+    V zero = {};
+    V ct = zero + o->shift_t, ch = zero + o->shift_h, cx = zero + o->shift_x;
+    V cthi = zero + o->shift_thi, chi = zero + o->shift_hi;
+    V c35 = zero + 35.0, c0 = zero, c80 = zero + 80.0, c30 = zero + 30.0, c27 = zero + 27.0;
+
+    // ---- 第1趟：温湿度幂和、极值、交叉项、回归、极端事件计数 ----
+    {
+        V st1 = zero, st2 = zero, st3 = zero, st4 = zero;
+        V sh1 = zero, sh2 = zero, sh3 = zero, sh4 = zero;
+        V sth = zero, sx = zero, sxx = zero, sxt = zero, sxh = zero;
+        V mnt = ct, mxt = ct, mnh = ch, mxh = ch;
+        M hot = {}, cold = {}, hhi = {}, hlo = {};
+
+        for (int i = 0; i < vend; i += W)
+        {
+            V tv, hv, xv;
+            VLOAD(tv, t + i);
+            VLOAD(hv, h + i);
+            VLOAD(xv, x + i);
+
+            V dt = tv - ct, dh = hv - ch, dx = xv - cx;
+            V dt2 = dt * dt, dh2 = dh * dh;
+            st1 += dt;
+            st2 += dt2;
+            st3 += dt2 * dt;
+            st4 += dt2 * dt2;
+            sh1 += dh;
+            sh2 += dh2;
+            sh3 += dh2 * dh;
+            sh4 += dh2 * dh2;
+            sth += dt * dh;
+
+            sx += dx;
+            sxx += dx * dx;
+            sxt += dx * dt;
+            sxh += dx * dh;
+
+            mnt = tv < mnt ? tv : mnt;
+            mxt = tv > mxt ? tv : mxt;
+            mnh = hv < mnh ? hv : mnh;
+            mxh = hv > mxh ? hv : mxh;
+
+            // 比较结果为 -1/0 掩码
+            hot -= (M)(tv > c35);
+            cold -= (M)(tv < c0);
+            hhi -= (M)(hv > c80);
+            hlo -= (M)(hv < c30);
+        }
+
+        o->t.s1 = hsum<W>(st1);
+        o->t.s2 = hsum<W>(st2);
+        o->t.s3 = hsum<W>(st3);
+        o->t.s4 = hsum<W>(st4);
+        o->h.s1 = hsum<W>(sh1);
+        o->h.s2 = hsum<W>(sh2);
+        o->h.s3 = hsum<W>(sh3);
+        o->h.s4 = hsum<W>(sh4);
+        o->s_th = hsum<W>(sth);
+        o->s_x = hsum<W>(sx);
+        o->s_xx = hsum<W>(sxx);
+        o->s_xt = hsum<W>(sxt);
+        o->s_xh = hsum<W>(sxh);
+        for (int j = 0; j < W; j++)
+        {
+            if (mnt[j] < o->t.min)
+                o->t.min = mnt[j];
+            if (mxt[j] > o->t.max)
+                o->t.max = mxt[j];
+            if (mnh[j] < o->h.min)
+                o->h.min = mnh[j];
+            if (mxh[j] > o->h.max)
+                o->h.max = mxh[j];
+            o->hot += (int)hot[j];
+            o->cold += (int)cold[j];
+            o->high_humi += (int)hhi[j];
+            o->low_humi += (int)hlo[j];
+        }
+    }
+
+    // ---- 第2趟：THI 与热指数（与 stats::thi / stats::heat_index 相同的公式） ----
+    {
+        V sa1 = zero, sa2 = zero, sa3 = zero, sa4 = zero;
+        V sb1 = zero, sb2 = zero, sb3 = zero, sb4 = zero;
+        V mna = cthi, mxa = cthi, mnb = chi, mxb = chi;
+
+        for (int i = 0; i < vend; i += W)
+        {
+            V tv, hv;
+            VLOAD(tv, t + i);
+            VLOAD(hv, h + i);
+
+            V thi = 0.8 * tv + (0.01 * hv) * (0.8 * tv - 14.3) + 46.3;
+            V poly = -42.379 + 2.04901523 * tv + 10.14333127 * hv - 0.22475541 * tv * hv - 0.00683783 * tv * tv - 0.05481717 * hv * hv + 0.00122874 * tv * tv * hv + 0.00085282 * tv * hv * hv - 0.00000199 * tv * tv * hv * hv;
+            V hi = tv < c27 ? tv : poly;
+
+            V da = thi - cthi, db = hi - chi;
+            V da2 = da * da, db2 = db * db;
+            sa1 += da;
+            sa2 += da2;
+            sa3 += da2 * da;
+            sa4 += da2 * da2;
+            sb1 += db;
+            sb2 += db2;
+            sb3 += db2 * db;
+            sb4 += db2 * db2;
+
+            mna = thi < mna ? thi : mna;
+            mxa = thi > mxa ? thi : mxa;
+            mnb = hi < mnb ? hi : mnb;
+            mxb = hi > mxb ? hi : mxb;
+        }
+
+        o->thi.s1 = hsum<W>(sa1);
+        o->thi.s2 = hsum<W>(sa2);
+        o->thi.s3 = hsum<W>(sa3);
+        o->thi.s4 = hsum<W>(sa4);
+        o->hi.s1 = hsum<W>(sb1);
+        o->hi.s2 = hsum<W>(sb2);
+        o->hi.s3 = hsum<W>(sb3);
+        o->hi.s4 = hsum<W>(sb4);
+        for (int j = 0; j < W; j++)
+        {
+            if (mna[j] < o->thi.min)
+                o->thi.min = mna[j];
+            if (mxa[j] > o->thi.max)
+                o->thi.max = mxa[j];
+            if (mnb[j] < o->hi.min)
+                o->hi.min = mnb[j];
+            if (mxb[j] > o->hi.max)
+                o->hi.max = mxb[j];
+        }
+    }
+
+    // ---- 第3趟：3点滑动平均序列的回归和 ----
+    int m = n - 2;
+    int aend = m > 0 ? m - m % W : 0;
+    {
+        V at = zero, att = zero, akt = zero, ah = zero, ahh = zero, akh = zero;
+        V kv, step = zero + (double)W, third = zero + 1.0 / 3.0;
+        for (int j = 0; j < W; j++)
+            kv[j] = j;
+
+        for (int k = 0; k < aend; k += W)
+        {
+            V t0, t1, t2, h0, h1, h2;
+            VLOAD(t0, t + k);
+            VLOAD(t1, t + k + 1);
+            VLOAD(t2, t + k + 2);
+            VLOAD(h0, h + k);
+            VLOAD(h1, h + k + 1);
+            VLOAD(h2, h + k + 2);
+
+            V ut = (t0 + t1 + t2) * third - ct;
+            V uh = (h0 + h1 + h2) * third - ch;
+            at += ut;
+            att += ut * ut;
+            akt += kv * ut;
+            ah += uh;
+            ahh += uh * uh;
+            akh += kv * uh;
+            kv += step;
+        }
+
+        o->a_t = hsum<W>(at);
+        o->a_tt = hsum<W>(att);
+        o->a_kt = hsum<W>(akt);
+        o->a_h = hsum<W>(ah);
+        o->a_hh = hsum<W>(ahh);
+        o->a_kh = hsum<W>(akh);
+    }
+
+    scalar_tail(t, h, x, vend, n, o);
+    scalar_accel_tail(t, h, aend, n, o);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2,fma"))) static void block_sums_avx2(const double *t, const double *h, const double *x, int n, block_sums_t *out)
+{
+    block_sums_simd<4>(t, h, x, n, out);
+}
+
+static void block_sums_sse2(const double *t, const double *h, const double *x, int n, block_sums_t *out)
+{
+    block_sums_simd<2>(t, h, x, n, out);
+}
+#elif defined(__aarch64__)
+static void block_sums_neon(const double *t, const double *h, const double *x, int n, block_sums_t *out)
+{
+    block_sums_simd<2>(t, h, x, n, out);
+}
+#endif
+
+// ==================== 运行时选择 ====================
+typedef struct
+{
+    block_kernel_t fn;
+    const char *name;
+} kernel_choice_t;
+
+// 自检用固定数据块：长度不是向量宽度的倍数以覆盖尾部，跨越各阈值以覆盖计数分支
+#define SELF_CHECK_N 203
+
+static bool sums_close(double a, double b)
+{
+    return std::fabs(a - b) <= 1e-9 * (std::fabs(a) + std::fabs(b) + 1.0);
+}
+
+static bool power_close(const power_sums_t &a, const power_sums_t &b)
+{
+    return sums_close(a.s1, b.s1) && sums_close(a.s2, b.s2) &&
+           sums_close(a.s3, b.s3) && sums_close(a.s4, b.s4) &&
+           sums_close(a.min, b.min) && sums_close(a.max, b.max);
+}
+
+// SIMD 与标量实现的求和顺序不同（THI / 体感温度还可能用 FMA 计算），浮点结果按相对误差比较，计数必须完全一致
+static bool kernel_matches_scalar(block_kernel_t fn)
+{
+    double t[SELF_CHECK_N], h[SELF_CHECK_N], x[SELF_CHECK_N];
+    for (int i = 0; i < SELF_CHECK_N; i++)
+    {
+        t[i] = -5.0 + 45.0 * ((i * 37) % SELF_CHECK_N) / SELF_CHECK_N; // -5 ~ 40 ℃
+        h[i] = 20.0 + 70.0 * ((i * 61) % SELF_CHECK_N) / SELF_CHECK_N; // 20 ~ 90 %
+        x[i] = 19700.0 + i / 144.0;                                   // 10 分钟间隔的天数
+    }
+
+    block_sums_t ref, got;
+    block_sums_scalar(t, h, x, SELF_CHECK_N, &ref);
+    fn(t, h, x, SELF_CHECK_N, &got);
+
+    return got.n == ref.n &&
+           power_close(got.t, ref.t) && power_close(got.h, ref.h) &&
+           power_close(got.thi, ref.thi) && power_close(got.hi, ref.hi) &&
+           sums_close(got.s_th, ref.s_th) &&
+           sums_close(got.s_x, ref.s_x) && sums_close(got.s_xx, ref.s_xx) &&
+           sums_close(got.s_xt, ref.s_xt) && sums_close(got.s_xh, ref.s_xh) &&
+           sums_close(got.a_t, ref.a_t) && sums_close(got.a_tt, ref.a_tt) &&
+           sums_close(got.a_kt, ref.a_kt) && sums_close(got.a_h, ref.a_h) &&
+           sums_close(got.a_hh, ref.a_hh) && sums_close(got.a_kh, ref.a_kh) &&
+           got.hot == ref.hot && got.cold == ref.cold &&
+           got.high_humi == ref.high_humi && got.low_humi == ref.low_humi;
+}
+
+static kernel_choice_t detect_kernel(void)
+{
+    const char *env = getenv("STATS_SIMD");
+    if (env && strcmp(env, "off") == 0)
+        return {block_sums_scalar, "scalar"};
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return {block_sums_avx2, "avx2"};
+    return {block_sums_sse2, "sse2"};
+#elif defined(__aarch64__)
+    if (getauxval(AT_HWCAP) & HWCAP_ASIMD)
+        return {block_sums_neon, "neon"};
+#endif
+    return {block_sums_scalar, "scalar"};
+}
+
+// 首次使用时检测一次，SIMD 结果与标量参考实现不一致则退回标量
+static kernel_choice_t select_kernel(void)
+{
+    kernel_choice_t choice = detect_kernel();
+    if (choice.fn != block_sums_scalar && !kernel_matches_scalar(choice.fn))
+    {
+        fprintf(stderr, "[STATS] %s kernel failed self-check, using scalar\n", choice.name);
+        return {block_sums_scalar, "scalar"};
+    }
+    return choice;
+}
+
+static const kernel_choice_t &kernel_choice(void)
+{
+    static const kernel_choice_t choice = select_kernel();
+    return choice;
+}
+
+block_kernel_t block_kernel(void)
+{
+    return kernel_choice().fn;
+}
+
+const char *block_kernel_name(void)
+{
+    return kernel_choice().name;
+}
+
+} // namespace stats
@@ -77,10 +77,10 @@ static void show_shutdown_screen(void)
     hal_oled_refresh();
     usleep(SHUTDOWN_DISPLAY_DURATION_US);
 
-    // 清屏
+    // 清屏，等显示线程把最后一帧发出去
     hal_oled_clear();
     hal_oled_refresh();
-    usleep(100000);
+    hal_oled_flush(200);
 }
 
 /**
@@ -99,6 +99,7 @@ static void cleanup_resources(void)
     hal_gpio_cleanup();
     hal_system_cleanup();
     hal_hcsr04_cleanup();
+    hal_oled_cleanup();
 
     printf("系统已安全退出\n");
 }
@@ -131,6 +132,7 @@ int main(void)
     // 6. 主循环
     printf("进入主循环...\n");
     hello_from_cpp();
+    // 主循环只负责绘制并发布帧，I2C 发送在 OLED 显示线程中进行
     while (running)
     {
         menu_render();